@@ -0,0 +1,32 @@
+/**
+ * Batch mode. Many runs are solved in one process: the instances of a directory or the lines of a manifest.
+ * A pool of -jobs threads takes the runs in order. The instance of a run is loaded once, with all
+ * its precomputed data, and the runs on it work on copies of it (see copy_instance). Each thread opens one
+ * cplex environment at its first cplex run and reuses it for its next runs. The result of every run is
+ * written in one report, as CSV or as JSON lines, as soon as the run ends.
+ */
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "utility.h"
+
+// Status of the report rows of the runs which can't start: their instance can't be loaded or cplex can't be opened
+#define BATCH_RUN_ERROR -1
+
+/**
+ * Solves the runs of params.batch_path. A directory gives one run for each instance file
+ * (.tsp or .vrp, possibly .gz or .zst compressed) with the method and the seed of the command line. A manifest
+ * gives one run for each line "instance [method] [seed]": the fields are separated by blanks or commas, the
+ * missing ones are taken from the command line and the relative paths start from the directory of the manifest.
+ * Empty lines and lines starting with '#' are skipped. The other params of the command line hold for every run.
+ * When params.num_threads is not set each run uses an equal share of the cpus. The runs don't log anything
+ * when the report is written on the standard output. A run which fails doesn't stop the batch: its row has
+ * the status BATCH_RUN_ERROR when its instance can't be loaded, the cplex error code when cplex fails. A warm
+ * start tour is used only by the instances of its size.
+ *
+ * @param inst The instance pointer with the params of the command line. Its instance is not loaded
+ * @returns 0 when all the runs are solved, 1 otherwise
+ */
+int solve_batch(instance *inst);
+
+#endif
@@ -0,0 +1,46 @@
+/**
+ * Candidate neighbor lists. For each node they store its k nearest nodes and/or its neighbors in the
+ * Delaunay graph, sorted by distance, so the refinement heuristics can restrict their moves to promising
+ * neighbors instead of scanning every pair of nodes. The lists are built in about O(n log n).
+ */
+#ifndef CANDIDATES_H
+#define CANDIDATES_H
+
+#include "utility.h"
+
+/**
+ * Builds the candidate lists of the instance with the cand_k, cand_quadrant and cand_type params.
+ * The nearest neighbors are searched with the k-d tree of the instance. When it is not built (GEO and EXPLICIT
+ * instances, whose coordinates are not planar or missing) a brute force search is used. The Delaunay graph is built when
+ * the type needs it; if it can't be built only the nearest neighbors are used. Call it after build_kdtree.
+ *
+ * @param inst The instance pointer of the problem
+ * @returns 1 if the lists are built, 0 otherwise (i.e. when cand_k is 0 with the KNN type)
+ */
+int build_candidate_lists(instance *inst);
+
+/**
+ * Returns the candidate list of a node, sorted by increasing distance
+ *
+ * @param inst The instance pointer of the problem
+ * @param node The node whose neighbors are returned
+ * @param count Where the number of neighbors of the node is stored
+ * @returns the pointer to the first neighbor of the node
+ */
+static inline const neighbor *candidate_neighbors(const instance *inst, int node, int *count) {
+    *count = inst->cand.start[node + 1] - inst->cand.start[node];
+    return inst->cand.list + inst->cand.start[node];
+}
+
+/**
+ * Checks if the edge (i, j) is in the candidate lists of node i or node j.
+ * When the candidate lists are not built every edge is a candidate.
+ *
+ * @param inst The instance pointer of the problem
+ * @param i The node i index
+ * @param j The node j index
+ * @returns true if the edge is a candidate, false otherwise
+ */
+bool is_candidate_edge(const instance *inst, int i, int j);
+
+#endif
@@ -0,0 +1,42 @@
+/**
+ * Compressed instance files. The gzip and zstd streams are recognized by their magic numbers and
+ * decoded in memory, so the instance archive can be read without decompressing it to disk.
+ * gzip needs zlib (HAVE_ZLIB) and zstd needs libzstd (HAVE_ZSTD): both are optional at build time.
+ */
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <stddef.h>
+
+#include "utility.h"
+
+typedef enum {
+    COMPRESSION_NONE,
+    COMPRESSION_GZIP,
+    COMPRESSION_ZSTD
+} compression_type;
+
+/**
+ * Detects the compression of a buffer from its first bytes
+ *
+ * @param data The buffer
+ * @param len The number of bytes of the buffer
+ * @returns the compression of the buffer, COMPRESSION_NONE for plain text
+ */
+compression_type detect_compression(const char *data, size_t len);
+
+/**
+ * Decodes a compressed buffer. The stream is decoded in chunks into a buffer which is grown as
+ * needed, starting from the decoded size stored in the stream when it is available. Concatenated
+ * gzip members and zstd frames are decoded one after the other. It stops the program if the stream
+ * is corrupted or its compression is not supported by the build.
+ *
+ * @param data The compressed buffer
+ * @param len The number of bytes of the compressed buffer
+ * @param type The compression of the buffer, see detect_compression
+ * @param out_len Where the number of decoded bytes is stored
+ * @returns the decoded bytes, to be freed by the caller
+ */
+char *decompress_buffer(const char *data, size_t len, compression_type type, size_t *out_len);
+
+#endif
@@ -0,0 +1,34 @@
+/**
+ * Delaunay triangulation of the nodes. For 2D metric instances the Delaunay graph has about 3n edges
+ * and contains almost all the edges of the good tours, so it is used as a sparse candidate graph both
+ * by the local search heuristics (through the candidate lists) and by the CPLEX models (--sparse).
+ */
+#ifndef DELAUNAY_H
+#define DELAUNAY_H
+
+#include "utility.h"
+
+/**
+ * Builds the Delaunay graph of the nodes with the incremental Bowyer-Watson algorithm and stores
+ * it in inst->delaunay. The nodes are inserted in a biased randomized insertion order, rounds of doubling
+ * size each sorted along a Hilbert curve, and located by walking from the last created triangle, so the
+ * expected time is about O(n log n) on grids too. The edges of the convex
+ * hull are always added. Nodes with the same coordinates are connected to each other and share
+ * the neighbors. It is not built for GEO instances, whose coordinates are not planar, and for EXPLICIT ones.
+ *
+ * @param inst The instance pointer of the problem
+ * @returns 1 if the graph is built, 0 otherwise
+ */
+int build_delaunay(instance *inst);
+
+/**
+ * Checks if the edge (i, j) belongs to the graph
+ *
+ * @param graph The graph
+ * @param i The node i index
+ * @param j The node j index
+ * @returns true if the graph contains the edge, false otherwise
+ */
+bool sparse_graph_has_edge(const sparse_graph *graph, int i, int j);
+
+#endif
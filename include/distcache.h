@@ -0,0 +1,33 @@
+/**
+ * Memory bounded cache of distance rows, used when the instance is too big for the precomputed
+ * distance matrix. The rows of the nodes which are queried many times (e.g. the fixed endpoints
+ * of the 2-opt inner loop) are computed at once with the row kernels and kept in a fixed budget
+ * of memory, evicting the rows with the CLOCK policy. The cache sits behind calc_dist, so the
+ * heuristics use it without changes. The distances are exactly the same returned without the cache.
+ */
+#ifndef DIST_CACHE_H
+#define DIST_CACHE_H
+
+#include "utility.h"
+
+#define DIST_CACHE_ADMIT 8 // Misses of a node within an epoch of num_nodes misses needed to load its row
+
+/**
+ * Builds the distance row cache with the dist_cache_mem param when the distance matrix is not built,
+ * and installs it as the distance function of the instance. By default the cache is built only for
+ * the ATT and GEO weight types, whose distances are slower to compute than to read from memory.
+ * The copies of the instance don't use the cache, since it is not thread safe. Call it after init_dist_kernels.
+ *
+ * @param inst The instance pointer of the problem
+ * @returns 1 if the cache is built, 0 otherwise
+ */
+int build_dist_cache(instance *inst);
+
+/**
+ * Logs the hits, the misses and the rows loaded by the cache when the verbose level is at least 3
+ *
+ * @param inst The instance pointer of the problem
+ */
+void dist_cache_report(instance *inst);
+
+#endif
@@ -0,0 +1,51 @@
+/**
+ * Explicit edge weights. The EDGE_WEIGHT_SECTION of an EXPLICIT instance is parsed once into a
+ * binary distance file, which stores the packed upper triangular matrix used by calc_dist.
+ * The next runs memory map the file and skip the section, so the text matrix is not parsed again
+ * and the distances are read from the mapping without any copy.
+ */
+#ifndef DIST_FILE_H
+#define DIST_FILE_H
+
+#include <sys/stat.h>
+
+#include "utility.h"
+#include "tsplib.h"
+
+#define DIST_FILE_EXT ".dmat" // Appended to the instance file path to get the path of its distance file
+#define DIST_FILE_MAGIC "TSPDMAT1"
+
+/**
+ * Loads the explicit weights of the instance into inst->dist. If the distance file of the instance
+ * exists and it was written from the same instance file with the same cost type, it is mapped
+ * and the reader is moved after the EDGE_WEIGHT_SECTION. Otherwise the weights are read with
+ * the reader, written to the distance file and mapped. If the distance file can't be written
+ * the matrix is kept in memory. The weights are stored as int32 with integer costs (rounded to the
+ * nearest integer) and as double otherwise. Only the upper triangle is kept: for FULL_MATRIX the
+ * weights below the diagonal must be the same of the ones above it, an asymmetric matrix is an error.
+ * It is called by parse_instance at the EDGE_WEIGHT_SECTION.
+ *
+ * @param inst The instance pointer of the problem. The number of nodes and the weight format must be set
+ * @param reader The reader of the instance text, positioned at the first weight
+ * @param source The status of the instance file
+ */
+void load_edge_weights(instance *inst, tsplib_reader *reader, const struct stat *source);
+
+/**
+ * Maps the distance file of the instance into inst->dist without reading the instance file.
+ * It is used when the instance is loaded from its binary cache, see instcache.h.
+ *
+ * @param inst The instance pointer of the problem. The number of nodes and the weight format must be set
+ * @param source The status of the instance file
+ * @returns 1 if the distance file matches the instance and it is mapped, 0 otherwise
+ */
+int map_edge_weights(instance *inst, const struct stat *source);
+
+/**
+ * Releases the distance matrix, unmapping it when it is memory mapped
+ *
+ * @param inst The instance pointer of the problem
+ */
+void free_dist_matrix(instance *inst);
+
+#endif
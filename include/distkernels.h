@@ -0,0 +1,55 @@
+/**
+ * One-to-many distance kernels. They compute the distances from one node to a range of
+ * nodes at once using AVX2 or SSE4.1 instructions when the CPU supports them, falling back
+ * to scalar code otherwise. The instruction set is chosen at runtime in init_dist_kernels.
+ * The distances returned are exactly the same returned by calc_dist.
+ */
+#ifndef DIST_KERNELS_H
+#define DIST_KERNELS_H
+
+#include "utility.h"
+
+#define DIST_ROW_BLOCK 256 // Number of distances computed for each block in the reductions
+
+/**
+ * Prepares the data used by the distance kernels (i.e. the aligned copy of the coordinates)
+ * and chooses the best instruction set available. Call it after parse_instance.
+ *
+ * @param inst The instance pointer of the problem
+ */
+void init_dist_kernels(instance *inst);
+
+/**
+ * Computes the distances from node "from" to the nodes in the range [begin, end).
+ * The distance between from and node begin + k is stored in row[k].
+ *
+ * @param inst The instance pointer of the problem
+ * @param from The node where the distances are computed from
+ * @param begin The first node of the range
+ * @param end The node after the last node of the range
+ * @param row The array where the distances are stored. Its size must be at least end - begin
+ */
+void dist_row(instance *inst, int from, int begin, int end, double *row);
+
+/**
+ * Finds the nearest and the second nearest node to node "from" which are not skipped.
+ * When more nodes have the same distance, the one with the lowest index is chosen.
+ *
+ * @param inst The instance pointer of the problem
+ * @param from The node where the distances are computed from. It is always skipped
+ * @param skip An array of flags of size num_nodes. The nodes whose flag is not 0 are skipped. It can be NULL
+ * @param min_dist Where the distance of the nearest node is stored
+ * @param second_idx Where the index of the second nearest node is stored. -1 if it does not exist. It can be NULL
+ * @param second_dist Where the distance of the second nearest node is stored. It can be NULL
+ * @returns The index of the nearest node. -1 if every node is skipped
+ */
+int dist_row_argmin(instance *inst, int from, const int *skip, double *min_dist, int *second_idx, double *second_dist);
+
+/**
+ * The name of the instruction set used by the distance kernels
+ *
+ * @returns "AVX2", "SSE4.1" or "SCALAR"
+ */
+const char *dist_kernels_isa();
+
+#endif
@@ -126,6 +126,16 @@ static void calc_lat_lon(node p, double *lat, double *lon);
  */
 double calc_geo(node p1, node p2, int integer);
 
+/**
+ * Converts the coordinates of the nodes of a GEO instance into latitude and longitude in radians
+ * once, storing them in inst->geo, so the distances don't repeat the conversion for both endpoints.
+ * The distances computed are exactly the same of calc_geo. It does nothing for the other weight types.
+ * It is called by parse_instance.
+ *
+ * @param inst The instance pointer of the problem
+ */
+void precompute_geo_coords(instance *inst);
+
 /**
  * Calculating the distance based on the instance's weight_type
  *
@@ -136,4 +146,68 @@ double calc_geo(node p1, node p2, int integer);
  */ 
 double calc_dist(int i, int j, instance *inst);
 
+/**
+ * Chooses the distance function specialized for the instance's weight type and cost type,
+ * or the one reading the precomputed matrix when it is built, and stores it in inst->dist_fn.
+ * With integer costs it also sets the integer distance function inst->int_dist_fn.
+ * It is called by build_dist_matrix so the choice is made once before solving.
+ *
+ * @param inst The instance pointer of the problem
+ */
+void select_dist_func(instance *inst);
+
+/**
+ * Returns the specialized distance function of the instance, selecting it if it was not done yet.
+ * Hot loops should call the returned function directly instead of calc_dist.
+ *
+ * @param inst The instance pointer of the problem
+ * @returns the distance function of the instance
+ */
+dist_func get_dist_func(instance *inst);
+
+/**
+ * Checks if every distance of the instance is an integer: with the integer cost param
+ * or with the CEIL_2D weight type, whose distances are always rounded up
+ *
+ * @param inst The instance pointer of the problem
+ * @returns true if the costs are integers, false otherwise
+ */
+static inline bool has_integer_costs(const instance *inst) {
+    return inst->params.integer_cost || inst->weight_type == CEIL_2D;
+}
+
+/**
+ * Returns the distance function of the instance which returns integers, or NULL when the costs
+ * are not integers (see has_integer_costs). With the int32 matrix the entries are read without any
+ * conversion. The heuristics use it to compute the deltas of the moves and the tour costs in int64,
+ * so the comparisons are exact.
+ *
+ * @param inst The instance pointer of the problem
+ * @returns the integer distance function of the instance, NULL if the costs are not integers
+ */
+int_dist_func get_int_dist_func(instance *inst);
+
+/**
+ * Calculates the cost of a tour given as the list of its edges. With integer costs the
+ * distances are summed in int64.
+ *
+ * @param inst The instance pointer of the problem
+ * @param edges The num_nodes edges of the tour
+ * @returns the cost of the tour
+ */
+double calc_tour_cost(instance *inst, const edge *edges);
+
+/**
+ * Precomputes the distances between all the nodes in a packed upper triangular matrix
+ * which calc_dist reads instead of computing the distance from the coordinates.
+ * The element type is chosen by the dist_type param and the matrix is built only if
+ * its size doesn't exceed the dist_mem_limit param. It also selects the specialized distance
+ * function with select_dist_func. Call it after parse_instance. For the EXPLICIT instances the
+ * matrix loaded by parse_instance is always used.
+ *
+ * @param inst The instance pointer of the problem
+ * @returns 1 if the matrix is built, 0 otherwise
+ */
+int build_dist_matrix(instance *inst);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,48 @@
+/**
+ * Export of the tour found by the solvers. The tour is formatted in a large buffer which is written
+ * to the file with few system calls, so the export of tours with millions of nodes takes a fraction
+ * of a second. The formats are the TSPLIB .tour file, a binary successor array and a JSON object.
+ * The export can run in a background thread on a snapshot of the tour, so it overlaps with the
+ * rest of the program and it never counts in the time to solve.
+ * The results of the runs for the performance profiles are appended to a shared CSV file.
+ */
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#include "utility.h"
+
+#define EXPORT_DIR "../tour"                // Directory of the exported tours when the export path is not given
+#define EXPORT_BUFFER_SIZE (4 << 20)        // Bytes formatted before each write to the file
+#define EXPORT_BINARY_MAGIC "TSPSUCC1"
+#define PERF_CSV_HEADER "instance,method,time,objective,status,seed\n"
+
+/**
+ * Exports the tour of inst->solution.edges with the export params. The binary format is the header
+ * EXPORT_BINARY_MAGIC (8 bytes), the number of nodes (int32), the objective (double) and the time to
+ * solve (double), followed by the successor of each node (int32, 0-based). Nothing is exported for the
+ * performance profiles, when the format is EXPORT_NONE or when there is no tour. With the export_async
+ * param the tour is copied and written by a background thread: see wait_export_tour.
+ *
+ * @param inst The instance pointer of the problem
+ */
+void export_tour(instance *inst);
+
+/**
+ * Waits for the background export of the tour, if any. It is called by free_instance.
+ *
+ * @param inst The instance pointer of the problem
+ */
+void wait_export_tour(instance *inst);
+
+/**
+ * Appends the result of the run to the CSV file of the perf_csv param, writing PERF_CSV_HEADER first when
+ * the file is empty. The file is locked while the row is written, so parallel runs can share it.
+ * The rows are turned into the table of perfProf.py with its --rows option. It does nothing
+ * when the perf_csv param is not set.
+ *
+ * @param inst The instance pointer of the problem, with its solution and its time to solve
+ * @param status The status returned by the solver: 0 when it ends, the time limit or error code otherwise
+ */
+void export_perf_result(instance *inst, int status);
+
+#endif
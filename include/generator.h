@@ -0,0 +1,40 @@
+/**
+ * Generated instances. The instance is synthesized in memory from the params, so the heuristics can be
+ * benchmarked on instances of any size (from thousands to millions of nodes) without shipping them.
+ * The same params and seed always give the same instance. The nodes are distributed uniformly, in clusters
+ * or on a grid with any weight type, and the CVRP instances get random demands and a vehicle capacity.
+ * The instance can also be written as a TSPLIB file, together with its binary cache (see instcache.h).
+ */
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include "utility.h"
+
+#define GEN_SPACING 100.0       // Average distance between neighbor nodes of the uniform instances and step of the grid
+#define GEN_CLUSTER_SIZE 100    // Average number of nodes in a cluster
+#define GEN_MAX_DEMAND 100      // The demands of the customers are in [1, GEN_MAX_DEMAND]
+#define GEN_ROUTE_SIZE 20       // Average number of customers in a route when the capacity is chosen
+
+/**
+ * Generates the instance described by the gen_* params with the seed param. The coordinates are
+ * integers, in a square whose side grows as the square root of the number of nodes, so the density
+ * of the nodes doesn't depend on their number. The GEO instances get latitudes and longitudes in
+ * the TSPLIB DDD.MM format. The EXPLICIT instances get the rounded Euclidean distances of the
+ * nodes as weights: their matrix must fit the dist_mem_limit param. The CVRP instances have the
+ * depot in node 1, at the center of the square.
+ *
+ * @param inst The instance pointer of the problem
+ */
+void generate_instance(instance *inst);
+
+/**
+ * Writes the instance in a TSPLIB file. The EXPLICIT weights are written as UPPER_ROW with the nodes
+ * as display coordinates. When the inst_cache param is set the binary cache of the file is written too.
+ * It stops the program if the file can't be written.
+ *
+ * @param inst The instance pointer of the problem
+ * @param path The path of the TSPLIB file
+ */
+void write_tsplib(instance *inst, const char *path);
+
+#endif
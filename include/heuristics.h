@@ -2,6 +2,7 @@
 #define HEURISTICS_H
 
 #include "utility.h"
+#include "tour.h"
 
 #define WRONG_STARTING_NODE 1
 #define TIME_LIMIT_EXCEEDED 2
@@ -15,6 +16,16 @@
  */
 int greedy(instance *inst, int starting_node);
 
+/**
+ * Copies the warm start tour of the instance (see the -warmstart option) in the solution. The construction
+ * heuristics (HEU_greedy, HEU_Greedy_iter, HEU_extramileage, HEU_Grasp and HEU_Grasp_iter) return it
+ * instead of building a tour, so every method which starts from them starts from the warm start tour.
+ *
+ * @param inst The instance pointer of the problem
+ * @return 1 if the instance has a warm start tour, 0 otherwise
+ */
+int HEU_warm_start(instance *inst);
+
 /**
  * Applies a greedy algorithm to solve the instance which starts from starting node 0
  * 
@@ -48,7 +59,9 @@ int HEU_extramileage(instance *inst);
 //int HEU_2opt(instance *inst); //TO REMOVE??????
 
 /**
- * Applies a the 3-opt algorithm to solve the instance
+ * Applies the 3-opt algorithm on the candidate lists to the solution of the instance, see alg_3opt_cand.
+ * Like alg_2opt it MUST be executed after an initialization algorithm. When the candidate lists are not
+ * built it falls back to alg_2opt.
  * 
  * @param inst The instance pointer of the problem
  * @return The error code
@@ -81,6 +94,18 @@ int HEU_Grasp_iter(instance *inst, int time_lim);
  */
 int alg_2opt(instance *inst);
 
+/**
+ * Applies the 2-opt algorithm to a tour. The moves are the ones of alg_2opt, applied to the array
+ * representation of the tour, so each move costs at most n/2 swaps.
+ *
+ * @param inst The instance pointer of the problem
+ * @param t The tour, changed in place
+ * @param obj The cost of the tour, updated with the deltas of the moves
+ * @param time_limit The time limit in seconds. No limit when it is <= 0
+ * @return The error code
+ */
+int alg_2opt_tour(instance *inst, array_tour *t, double *obj, int time_limit);
+
 /**
  * Applies the GRASP algorithm from a starting node
  * 
@@ -129,4 +154,53 @@ int HEU_2opt_greedy_iter(instance *inst);
  * @return The error code
  */
 int HEU_2opt_extramileage(instance *inst);
+
+/**
+ * Applies the 3-opt algorithm using grasp initialization
+ * 
+ * @param inst The instance pointer of the problem
+ * @return The error code
+ */
+int HEU_3opt_grasp(instance *inst);
+
+/**
+ * Applies the 3-opt algorithm using iterative grasp initialization
+ * 
+ * @param inst The instance pointer of the problem
+ * @return The error code
+ */
+int HEU_3opt_grasp_iter(instance *inst);
+
+/**
+ * Applies the 3-opt algorithm using greedy initialization
+ * 
+ * @param inst The instance pointer of the problem
+ * @return The error code
+ */
+int HEU_3opt_greedy(instance *inst);
+
+/**
+ * Applies the 3-opt algorithm using iterative greedy initialization
+ * 
+ * @param inst The instance pointer of the problem
+ * @return The error code
+ */
+int HEU_3opt_greedy_iter(instance *inst);
+
+/**
+ * Applies the 3-opt algorithm using extra mileage initialization
+ * 
+ * @param inst The instance pointer of the problem
+ * @return The error code
+ */
+int HEU_3opt_extramileage(instance *inst);
+
+/**
+ * Applies the Lin-Kernighan style local search using greedy initialization, see alg_lk. When the
+ * candidate lists are not built the 2-opt algorithm is applied instead
+ * 
+ * @param inst The instance pointer of the problem
+ * @return The error code
+ */
+int HEU_LK(instance *inst);
 #endif
\ No newline at end of file
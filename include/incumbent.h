@@ -0,0 +1,61 @@
+/**
+ * Incumbent stream. Every time a method improves its incumbent, a record is appended to a file, a named
+ * pipe or an open file descriptor, so a front end can follow the progress of a run while it is solving.
+ * Each record is a JSON line: {"time":..,"obj":..,"bound":..,"final":..,"succ":[..]} where time is the
+ * number of seconds since the solver started, bound is null when the method has no lower bound and succ,
+ * written only with the stream_tour param, is the successor of each node (0-based).
+ * The records are queued and written by a background thread, so the solver never waits for the reader.
+ * When the reader is slower than the solver, the oldest queued records are dropped and only the newest
+ * queued tour is written.
+ */
+#ifndef INCUMBENT_H
+#define INCUMBENT_H
+
+#include "utility.h"
+
+#define STREAM_QUEUE_SIZE 256       // Records waiting to be written. When it is full the oldest one is dropped
+#define STREAM_CLOSE_TIMEOUT 5      // Seconds waited at the end of the run for the reader to take the last records
+#define STREAM_NO_BOUND (-CPX_INFBOUND) // The bound of the methods without a lower bound
+
+/**
+ * Opens the incumbent stream of the stream_path param and starts its writer thread. A path
+ * "fd:N" streams to the file descriptor N. The file or the pipe is opened by the writer thread,
+ * so the solver starts even when the reader of a named pipe is not there yet. It does nothing
+ * when the stream_path param is not set.
+ *
+ * @param inst The instance pointer of the problem
+ */
+void open_incumbent_stream(instance *inst);
+
+/**
+ * Appends a record if obj improves the objective of the last record. It is thread safe and it only
+ * copies the record (and the tour with the stream_tour param) into the queue.
+ *
+ * @param inst The instance pointer of the problem
+ * @param obj The objective of the new incumbent
+ * @param bound The lower bound of the method, STREAM_NO_BOUND when there is none
+ * @param edges The edges of the new incumbent: edges[k] goes from edges[k].i to its successor edges[k].j. It can be NULL
+ */
+void stream_incumbent(instance *inst, double obj, double bound, const edge *edges);
+
+/**
+ * Appends a record as stream_incumbent with the tour given as successors
+ *
+ * @param inst The instance pointer of the problem
+ * @param obj The objective of the new incumbent
+ * @param bound The lower bound of the method, STREAM_NO_BOUND when there is none
+ * @param succ The successor of each node of the new incumbent. It can be NULL
+ */
+void stream_incumbent_succ(instance *inst, double obj, double bound, const int *succ);
+
+/**
+ * Appends the final solution of the run (inst->solution), even if it doesn't improve the last record,
+ * and closes the stream after the writer thread has written the queued records. If the reader doesn't
+ * take them within STREAM_CLOSE_TIMEOUT seconds they are dropped.
+ *
+ * @param inst The instance pointer of the problem
+ * @param bound The final lower bound of the method, STREAM_NO_BOUND when there is none
+ */
+void close_incumbent_stream(instance *inst, double bound);
+
+#endif
@@ -0,0 +1,50 @@
+/**
+ * Binary instance cache. The parsed instance is stored in a compact binary file next to the instance
+ * file: a header followed by the coordinates as two arrays (x and y), the demands, the depot flags and
+ * the name. The next runs memory map the cache and copy the arrays into the nodes, so the text of the
+ * instance is not parsed again. The cache is valid only for the instance file with the same size,
+ * modification time and content hash.
+ */
+#ifndef INST_CACHE_H
+#define INST_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "utility.h"
+
+#define INST_CACHE_EXT ".icache" // Appended to the instance file path to get the path of its cache
+#define INST_CACHE_MAGIC "TSPINST1"
+
+/**
+ * Computes a 64-bit hash of a buffer. It is not a cryptographic hash: it only detects the changes
+ * of a file whose size and modification time are unchanged.
+ *
+ * @param data The buffer
+ * @param len The number of bytes of the buffer
+ * @returns the hash of the buffer
+ */
+uint64_t hash_bytes(const void *data, size_t len);
+
+/**
+ * Loads the instance from its cache if it matches the instance file. Otherwise the instance file is
+ * parsed with parse_tsplib and the cache is written for the next runs. If the cache can't be written
+ * the instance is loaded anyway. The weights of the EXPLICIT instances are not stored in the cache:
+ * they are mapped from their distance file, see distfile.h.
+ *
+ * @param inst The instance pointer of the problem
+ * @param path The path of the instance file
+ */
+void parse_tsplib_cached(instance *inst, const char *path);
+
+/**
+ * Writes the cache of an instance file from the instance already in memory, e.g. a generated instance
+ * just written as TSPLIB. The instance must be the one described by the file.
+ *
+ * @param inst The instance pointer of the problem
+ * @param path The path of the instance file
+ * @returns 1 if the cache is written, 0 otherwise
+ */
+int write_instance_cache(const instance *inst, const char *path);
+
+#endif
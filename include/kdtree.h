@@ -0,0 +1,68 @@
+/**
+ * 2-d tree over the coordinates of the nodes. It answers nearest neighbors queries ranked by the
+ * distance of the instance (calc_dist) in about logarithmic time and supports the removal of nodes,
+ * so the constructive heuristics can ask for the nearest not visited node. It is built only for
+ * planar metrics (every weight type except GEO and EXPLICIT).
+ */
+#ifndef KDTREE_H
+#define KDTREE_H
+
+#include "utility.h"
+
+// Nodes removed from the tree during a search session, e.g. the visited nodes of a greedy run.
+// The tree is read only so more filters can be used at the same time on the same tree
+typedef struct {
+    int *count;     // Number of nodes not removed in the subtree of each slot of the tree
+    bool *removed;  // Whether each node is removed
+} kdtree_filter;
+
+/**
+ * Builds the k-d tree of the instance in O(n log n) and stores it in inst->tree.
+ * Call it after build_dist_matrix, since the queries use the selected distance function.
+ *
+ * @param inst The instance pointer of the problem
+ * @returns 1 if the tree is built, 0 otherwise (i.e. for GEO and EXPLICIT instances)
+ */
+int build_kdtree(instance *inst);
+
+/**
+ * Finds the k nearest nodes to node "from" which are not removed by the filter.
+ * The nodes are ranked by their distance and then by their index, so the results are the same
+ * of a linear scan keeping the first minimum. Node "from" is never returned.
+ *
+ * @param inst The instance pointer of the problem. Its tree must be built
+ * @param filter The removed nodes. It can be NULL
+ * @param from The node whose neighbors are searched
+ * @param k The number of neighbors to find
+ * @param quadrant When >= 0 only the nodes in that quadrant around "from" are returned. Bit 0 of the quadrant
+ * is set for the nodes with x lower than the one of "from", bit 1 for the nodes with lower y
+ * @param best The array of at least k elements where the neighbors are stored sorted by distance
+ * @returns the number of neighbors found, at most k
+ */
+int kdtree_search(const instance *inst, const kdtree_filter *filter, int from, int k, int quadrant, neighbor *best);
+
+/**
+ * Creates a filter where no node is removed
+ *
+ * @param inst The instance pointer of the problem. Its tree must be built
+ * @param filter The filter to initialize
+ */
+void kdtree_filter_init(const instance *inst, kdtree_filter *filter);
+
+/**
+ * Removes a node from the filter in O(log n). Removing a node twice has no effect.
+ *
+ * @param inst The instance pointer of the problem. Its tree must be built
+ * @param filter The filter
+ * @param node The node to remove
+ */
+void kdtree_filter_remove(const instance *inst, kdtree_filter *filter, int node);
+
+/**
+ * Frees the memory used by the filter
+ *
+ * @param filter The filter
+ */
+void kdtree_filter_free(kdtree_filter *filter);
+
+#endif
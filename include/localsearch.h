@@ -0,0 +1,113 @@
+/**
+ * Local searches on the candidate lists. The moves of a node are tried only with its candidate neighbors,
+ * and only the nodes in a queue of active nodes are processed: a node leaves the queue when none of its
+ * moves improves the tour (its don't-look bit is set) and it is queued again only when a move changes one
+ * of its edges. A descent from a good tour costs about O(n k), and after a small perturbation only the
+ * endpoints of the perturbed edges need to be queued.
+ */
+#ifndef LOCAL_SEARCH_H
+#define LOCAL_SEARCH_H
+
+#include "utility.h"
+#include "tour.h"
+
+#define LS_TIME_CHECK 256 // Nodes processed between two checks of the time limit
+#define OROPT_MAX_LEN 3    // The longest segment moved by Or-opt
+
+/**
+ * Applies 2-opt restricted to the candidate lists. For each active node a and for both its edges (a, a1),
+ * the moves which add an edge (a, c) shorter than (a, a1) are tried, with c in the candidate list of a.
+ * The first improving move is applied and the four endpoints of its edges are queued again.
+ *
+ * @param inst The instance pointer of the problem. Its candidate lists must be built
+ * @param t The tour, changed in place
+ * @param obj The cost of the tour, updated with the deltas of the moves
+ * @param active The nodes queued at the start. NULL to queue every node
+ * @param num_active The number of nodes in active
+ * @param time_limit The time limit in seconds. No limit when it is <= 0
+ * @returns 0 when the tour is a local optimum, TIME_LIMIT_EXCEEDED when the time limit is reached
+ */
+int alg_2opt_cand(instance *inst, array_tour *t, double *obj, const int *active, int num_active, int time_limit);
+
+/**
+ * Applies Or-opt restricted to the candidate lists. For each active node a, the segments of 1 to OROPT_MAX_LEN
+ * nodes with a at one end are moved between a candidate neighbor c of a and one of the two tour neighbors of c,
+ * in the orientation which makes a adjacent to c. Only the moves which add an edge (a, c) shorter than the edge
+ * which connects a to the rest of the tour are tried. Each delta is computed in O(1) from the six edges of the move.
+ *
+ * @param inst The instance pointer of the problem. Its candidate lists must be built
+ * @param t The tour, changed in place
+ * @param obj The cost of the tour, updated with the deltas of the moves
+ * @param active The nodes queued at the start. NULL to queue every node
+ * @param num_active The number of nodes in active
+ * @param time_limit The time limit in seconds. No limit when it is <= 0
+ * @returns 0 when the tour is a local optimum, TIME_LIMIT_EXCEEDED when the time limit is reached
+ */
+int alg_oropt_cand(instance *inst, array_tour *t, double *obj, const int *active, int num_active, int time_limit);
+
+/**
+ * Applies 2-opt and Or-opt restricted to the candidate lists, sharing the queue of active nodes: the
+ * Or-opt moves of a node are tried only when none of its 2-opt moves improves the tour. The result is a
+ * local optimum for both neighborhoods.
+ *
+ * @param inst The instance pointer of the problem. Its candidate lists must be built
+ * @param t The tour, changed in place
+ * @param obj The cost of the tour, updated with the deltas of the moves
+ * @param active The nodes queued at the start. NULL to queue every node
+ * @param num_active The number of nodes in active
+ * @param time_limit The time limit in seconds. No limit when it is <= 0
+ * @returns 0 when the tour is a local optimum, TIME_LIMIT_EXCEEDED when the time limit is reached
+ */
+int alg_2opt_oropt(instance *inst, array_tour *t, double *obj, const int *active, int num_active, int time_limit);
+
+/**
+ * Applies 3-opt restricted to the candidate lists. For each active node t1 and for both its edges (t1, t2),
+ * the sequential moves add (t2, t3) and (t4, t5), with t3 and t5 in the candidate lists of t2 and t4, and
+ * close the tour with (t6, t1); a move is followed only while its partial gain is positive. When t4 is
+ * the predecessor of t3 the move may also be closed after two exchanges, so the 2-opt moves are included.
+ * When t4 is the successor of t3 the third exchange splits the path t2..t3 in two segments which swap
+ * places, with or without reversing them: these are the or3opt segment insertions.
+ *
+ * @param inst The instance pointer of the problem. Its candidate lists must be built
+ * @param t The tour, changed in place
+ * @param obj The cost of the tour, updated with the deltas of the moves
+ * @param active The nodes queued at the start. NULL to queue every node
+ * @param num_active The number of nodes in active
+ * @param time_limit The time limit in seconds. No limit when it is <= 0
+ * @returns 0 when the tour is a local optimum, TIME_LIMIT_EXCEEDED when the time limit is reached
+ */
+int alg_3opt_cand(instance *inst, array_tour *t, double *obj, const int *active, int num_active, int time_limit);
+
+/**
+ * Applies a Lin-Kernighan style variable-depth search on the candidate lists, with Or-opt for the segment
+ * insertions. A move from node t1 removes (t1, t2) and is built by steps: each one adds (t2, t3), with t3 in
+ * the candidate list of t2, removes (t4, t3), t4 = prev(t3), and reverses t2..t4, so t4 becomes the next t2
+ * and the tour can always be closed with (t1, t4). A step is taken only while the cost of the removed edges
+ * exceeds the cost of the added ones, and an added edge is never removed again. The first four steps try up
+ * to 5, 3, 2 and 2 alternatives with backtracking, so the sequential moves of up to five edges are searched
+ * before the deeper steps, which take only the best one, up to 50 steps. The move is closed where its gain
+ * is the best and the steps after it are undone.
+ *
+ * @param inst The instance pointer of the problem. Its candidate lists must be built
+ * @param t The tour, changed in place
+ * @param obj The cost of the tour, updated with the deltas of the moves
+ * @param active The nodes queued at the start. NULL to queue every node
+ * @param num_active The number of nodes in active
+ * @param time_limit The time limit in seconds. No limit when it is <= 0
+ * @returns 0 when the tour is a local optimum, TIME_LIMIT_EXCEEDED when the time limit is reached
+ */
+int alg_lk(instance *inst, array_tour *t, double *obj, const int *active, int num_active, int time_limit);
+
+/**
+ * Refines the solution of the instance with the local search of the refine param. The full 2-opt
+ * ignores the active nodes. The local searches on the candidate lists fall back to the full 2-opt
+ * when the lists are not built.
+ *
+ * @param inst The instance pointer of the problem
+ * @param active The nodes whose edges changed since the solution was a local optimum. NULL when every node may be improved
+ * @param num_active The number of nodes in active
+ * @returns The error code
+ */
+int refine_solution(instance *inst, const int *active, int num_active);
+
+#endif
@@ -0,0 +1,53 @@
+/**
+ * On-disk cache of the results of the runs. A result is stored in a binary file of the cache directory
+ * named after a hash of everything which determines the run: the coordinates, the demands and the
+ * weights of the instance, its weight type, the method and the params which change the tour it finds
+ * (i.e. the seed and the candidate lists), but not the time limit. The file has a header followed by
+ * the successor of each node. When the same run is requested again the stored tour is returned in a
+ * few milliseconds, without building the model. When the run asks for a longer time limit than the
+ * stored one, the stored tour is the warm start of the run, which then replaces it.
+ */
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <stdint.h>
+
+#include "utility.h"
+
+#define RESULT_CACHE_EXT ".result"
+#define RESULT_CACHE_MAGIC "TSPRES01"
+
+/**
+ * Computes the key of the run: the hash of the instance and of the params which determine its result.
+ * The instance must be loaded, since the weights of the EXPLICIT instances are read from the distance matrix.
+ *
+ * @param inst The instance pointer of the problem
+ * @returns the key of the run in the result cache
+ */
+uint64_t result_cache_key(const instance *inst);
+
+/**
+ * Looks for the result of the run in the cache directory of the result_cache param. When the stored run
+ * answers the request, i.e. it was solved to optimality or with a time limit which is not shorter than
+ * the requested one, its tour and objective are copied in the solution. Otherwise the stored tour becomes
+ * the warm start tour of the run, unless a warm start tour is already given. It does nothing when the
+ * result_cache param is not set.
+ *
+ * @param inst The instance pointer of the problem
+ * @returns 1 if the solution is taken from the cache, 0 if the problem must be solved
+ */
+int load_cached_result(instance *inst);
+
+/**
+ * Stores the solution of the run in the cache directory of the result_cache param. The stored result is
+ * replaced only when the new one is better or comes from a longer time limit. The file is written to a
+ * temporary file and renamed, so concurrent runs never read a partial result. It does nothing when the
+ * result_cache param is not set.
+ *
+ * @param inst The instance pointer of the problem
+ * @param status The status returned by the solver: 0 when it ends, the time limit or error code otherwise
+ * @param optimal 1 when cplex proved the tour optimal (CPXMIP_OPTIMAL or CPXMIP_OPTIMAL_TOL), 0 otherwise
+ */
+void store_cached_result(instance *inst, int status, int optimal);
+
+#endif
@@ -33,13 +33,31 @@ static void build_dir_model(instance *inst, CPXENVptr env, CPXLPptr lp);
 static void build_model(instance *inst, CPXENVptr env, CPXLPptr lp);
 
 /**
- * Solves the problem utilizing method using cplex
+ * Frees the columns of the sparse model, built by build_udir_model. It is called when the model is freed
+ *
+ * @param inst The instance pointer of the problem
+ */
+static void free_model_columns(instance *inst);
+
+/**
+ * Solves the problem utilizing method using cplex. The program stops when cplex fails
  *
  * @param inst The instance pointer of the problem
  * @returns An error code when occurs. 0 when no errors occur
  */ 
 int TSP_opt(instance *inst);
 
+/**
+ * Solves the problem utilizing method using cplex in an environment which is already open.
+ * The parameters of the environment are reset, so it can be reused by many runs.
+ *
+ * @param inst The instance pointer of the problem
+ * @param env The cplex's environment. It is not closed
+ * @returns 0 when the problem is solved, also when the time limit stops cplex with a tour. The cplex error
+ * code when cplex fails or ends without a tour (CPXERR_NO_SOLN): the error is not logged and the program goes on
+ */
+int TSP_opt_env(instance *inst, CPXENVptr env);
+
 /**
  * Solves the problem without the help of cplex
  *
@@ -48,6 +66,16 @@ int TSP_opt(instance *inst);
  */ 
 int TSP_heuc(instance *inst);
 
+/**
+ * Takes the solution from the result cache when it has the result of the same run, see resultcache.h.
+ * The solution is then exported and printed as the solved ones. When the cached run had a shorter time
+ * limit its tour becomes the warm start of the run.
+ *
+ * @param inst The instance pointer of the problem
+ * @returns 1 if the solution is taken from the cache, 0 if the problem must be solved
+ */
+int TSP_cached(instance *inst);
+
 /**
  * Prepares the best optimal solver found so far used in matheuritics methods.
  * It is used on heuristics solvers which needs the fastest optimal solver.
@@ -0,0 +1,140 @@
+/**
+ * Array representation of a tour for the refinement heuristics. The nodes are stored in visiting order
+ * with the position of each node, so the successor, the predecessor and the relative order of three nodes
+ * are found in O(1). A path is reversed by swapping the nodes of the shorter side of the tour: reversing
+ * the other side gives the same cycle visited backwards, which is recorded by the reversed flag, so the
+ * orientation seen through tour_next and tour_prev is always the one of the reversed path.
+ */
+#ifndef TOUR_H
+#define TOUR_H
+
+#include "utility.h"
+
+typedef struct {
+    int *order;     // The node at each position
+    int *pos;       // The position of each node in order
+    int n;          // The number of nodes
+    bool reversed;  // Whether the tour visits order from its end to its start
+} array_tour;
+
+/**
+ * Allocates the arrays of a tour of n nodes. The tour must be filled with tour_from_edges or tour_from_order.
+ *
+ * @param t The tour
+ * @param n The number of nodes
+ */
+void tour_init(array_tour *t, int n);
+
+/**
+ * Frees the arrays of the tour
+ *
+ * @param t The tour
+ */
+void tour_free(array_tour *t);
+
+/**
+ * Fills the tour from the successors of the nodes, starting from node 0
+ *
+ * @param t The tour
+ * @param edges The n edges of the tour: edges[k] goes from node edges[k].i to its successor edges[k].j
+ */
+void tour_from_edges(array_tour *t, const edge *edges);
+
+/**
+ * Fills the tour from the nodes in visiting order
+ *
+ * @param t The tour
+ * @param order The n nodes in visiting order
+ */
+void tour_from_order(array_tour *t, const int *order);
+
+/**
+ * Writes the tour as the successors of the nodes: edges[i] goes from node i to its successor
+ *
+ * @param t The tour
+ * @param edges Where the n edges are written
+ */
+void tour_to_edges(const array_tour *t, edge *edges);
+
+/**
+ * Writes the nodes in visiting order, starting from node 0
+ *
+ * @param t The tour
+ * @param order Where the n nodes are written
+ */
+void tour_to_order(const array_tour *t, int *order);
+
+/**
+ * Writes the successors of the nodes of a tour given in visiting order: edges[i] goes from node i to its successor
+ *
+ * @param order The n nodes in visiting order
+ * @param n The number of nodes
+ * @param edges Where the n edges are written
+ */
+void order_to_edges(const int *order, int n, edge *edges);
+
+/**
+ * Reverses the path of the tour which goes from node a to node b. Only the shorter side of the tour is
+ * moved, so it costs at most n/2 swaps.
+ *
+ * @param t The tour
+ * @param a The first node of the path
+ * @param b The last node of the path
+ */
+void tour_reverse(array_tour *t, int a, int b);
+
+/**
+ * Returns the successor of a node
+ *
+ * @param t The tour
+ * @param node The node
+ * @returns the node visited after node
+ */
+static inline int tour_next(const array_tour *t, int node) {
+    int p = t->pos[node];
+    if (t->reversed) { return t->order[p == 0 ? t->n - 1 : p - 1]; }
+    return t->order[p + 1 == t->n ? 0 : p + 1];
+}
+
+/**
+ * Returns the predecessor of a node
+ *
+ * @param t The tour
+ * @param node The node
+ * @returns the node visited before node
+ */
+static inline int tour_prev(const array_tour *t, int node) {
+    int p = t->pos[node];
+    if (t->reversed) { return t->order[p + 1 == t->n ? 0 : p + 1]; }
+    return t->order[p == 0 ? t->n - 1 : p - 1];
+}
+
+/**
+ * Checks if node b is visited on the path which goes from node a to node c (a and c included)
+ *
+ * @param t The tour
+ * @param a The first node of the path
+ * @param b The checked node
+ * @param c The last node of the path
+ * @returns true if b is on the path from a to c, false otherwise
+ */
+static inline bool tour_between(const array_tour *t, int a, int b, int c) {
+    int n = t->n;
+    int pa = t->pos[a], pb = t->pos[b], pc = t->pos[c];
+    if (t->reversed) { return (pa - pb + n) % n <= (pa - pc + n) % n; }
+    return (pb - pa + n) % n <= (pc - pa + n) % n;
+}
+
+/**
+ * Applies the 2-opt move which replaces the edges (a, next(a)) and (b, next(b)) with (a, b) and (next(a), next(b)),
+ * i.e. it reverses the path from next(a) to b
+ *
+ * @param t The tour
+ * @param a The first node of the first removed edge
+ * @param b The first node of the second removed edge
+ */
+static inline void tour_2opt_move(array_tour *t, int a, int b) {
+    tour_reverse(t, tour_next(t, a), b);
+}
+
+#endif
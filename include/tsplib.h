@@ -0,0 +1,62 @@
+/**
+ * TSPLIB instance parser. The file is memory mapped and scanned once: the keywords drive the
+ * active section and the numbers are parsed in place with a fast parser, so there is no limit
+ * on the length of the lines and no string is copied for the coordinates.
+ */
+#ifndef TSPLIB_H
+#define TSPLIB_H
+
+#include <stddef.h>
+#include <sys/stat.h>
+
+#include "utility.h"
+
+// Cursor over the text of an instance
+typedef struct {
+    const char *begin;  // The first character of the text
+    const char *cur;    // The next character to read
+    const char *end;    // The character after the last one
+} tsplib_reader;
+
+/**
+ * Reads the next number, skipping the blanks and the line breaks before it. The value is the same
+ * returned by strtod: the digits which fit the double mantissa are converted exactly with a single
+ * rounding and the other numbers are converted by strtod.
+ *
+ * @param reader The reader of the text
+ * @param value Where the number is stored
+ * @returns 1 if a number is read, 0 if the text ends or the next token is not a number (only the blanks before it are skipped)
+ */
+int tsplib_read_number(tsplib_reader *reader, double *value);
+
+/**
+ * Parses an instance from a text in the TSPLIB format. The sections are NODE_COORD_SECTION,
+ * EDGE_WEIGHT_SECTION, DISPLAY_DATA_SECTION, DEMAND_SECTION and DEPOT_SECTION. Unknown keywords are skipped.
+ * A gzip or zstd compressed text is decoded in memory before parsing, see compression.h.
+ *
+ * @param inst The instance pointer of the problem
+ * @param data The text of the instance, possibly compressed
+ * @param len The number of bytes of the data
+ * @param source The status of the instance file, used to validate the distance file of the EXPLICIT instances
+ */
+void parse_tsplib(instance *inst, const char *data, size_t len, const struct stat *source);
+
+/**
+ * Maps the instance file in memory and parses it with parse_tsplib
+ *
+ * @param inst The instance pointer of the problem
+ * @param path The path of the instance file
+ */
+void parse_tsplib_file(instance *inst, const char *path);
+
+/**
+ * Parses a tour file in the TSPLIB format, as the ones written by export_tour, into inst->warm_tour.
+ * The tour must visit every node of the instance once. It can be compressed as the instances. In a batch a tour
+ * whose DIMENSION is not the one of the instance is skipped, and warm_tour stays NULL.
+ *
+ * @param inst The instance pointer of the problem. The instance must be already parsed
+ * @param path The path of the tour file
+ */
+void parse_tour_file(instance *inst, const char *path);
+
+#endif
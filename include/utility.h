@@ -9,15 +9,16 @@
 #include <sys/time.h>
 #include <string.h>
 #include <stdbool.h>
+#include <setjmp.h>
 
-#define MALLOC(nnum,type) ( (type *) malloc (nnum * sizeof(type)) )
+#define MALLOC(nnum,type) ( (type *) malloc ((nnum) * sizeof(type)) )
 #define CALLOC(nnum,type) ( (type *) calloc (nnum, sizeof(type)) )
-#define REALLOC(ptr, nnum, type) ( realloc(ptr, nnum * sizeof(type)) )
+#define REALLOC(ptr, nnum, type) ( realloc(ptr, (nnum) * sizeof(type)) )
 #define MEMSET(ptr,defval,nnum,type) {                  \
     type *new_ptr = (type*) ptr;                        \
     type newval = (type) defval;                        \
     if (newval == ((type)0) || newval == ((type)-1)) {  \
-        memset(new_ptr, newval, nnum * sizeof(type));   \
+        memset(new_ptr, newval, (nnum) * sizeof(type)); \
     } else {                                            \
         for (int i = 0; i < nnum; i++) {                \
             new_ptr[i] = newval;                        \
@@ -31,15 +32,29 @@
 #define LOG_D(fmt, ...) // An empty macro
 #endif
 #define LOG_I(fmt, ...) {fprintf(stdout, "[INFO]  ");fprintf(stdout, fmt, ## __VA_ARGS__);fprintf(stdout, "\n");}
-#define LOG_E(fmt, ...) {fprintf(stderr, "[ERROR] ");fprintf(stderr, fmt, ## __VA_ARGS__);fprintf(stderr, "\n");fflush(NULL);exit(1);}
+#define LOG_E(fmt, ...) {fprintf(stderr, "[ERROR] ");fprintf(stderr, fmt, ## __VA_ARGS__);fprintf(stderr, "\n");fflush(NULL);exit_on_error();}
 #define FREE(ptr) free(ptr); ptr=NULL;
 #define LEN(arr) (sizeof(arr) / sizeof(*arr))
-#define URAND() ( ((double) random()) / RAND_MAX )
+#define URAND() ( ((double) next_random()) / RAND_MAX )
 
 
+// Where LOG_E jumps instead of ending the program. NULL in every thread but the batch ones loading an instance, see batch.h
+extern _Thread_local jmp_buf *error_jump;
+
+/**
+ * Ends the program after an error logged with LOG_E. When the calling thread has set error_jump the error
+ * jumps back there instead, so a batch reports the runs on an unreadable instance and goes on with the others
+ */
+_Noreturn void exit_on_error(void);
+
 // Constant that is useful for numerical errors
 #define EPS 1e-5
 #define DEFAULT_TIME_LIM 900 // 15 minutes
+#define DEFAULT_DIST_MEM_LIMIT 1024 // Max MB used by the precomputed distance matrix
+#define DEFAULT_DIST_CACHE_MEM 256 // Max MB used by the distance row cache when its size is chosen automatically
+#define DIST_MATRIX_ALIGNMENT 64 // Cache line size
+#define DEFAULT_CAND_K 10 // Number of neighbors stored in each candidate list
+#define DEFAULT_GEN_NODES 1000 // Number of nodes of the generated instances
 
 
 // ================ Weight types =====================
@@ -49,9 +64,21 @@ typedef enum {
     MAN_2D,     // weights are Manhattan distances in 2-D
     CEIL_2D,    // weights are Euclidean distances in 2-D rounded up
     GEO,        // weights are geographical distances
-    ATT         // special distance function for problems att48 and att532 (pseudo-Euclidean)
+    ATT,        // special distance function for problems att48 and att532 (pseudo-Euclidean)
+    EXPLICIT    // weights are listed explicitly in the EDGE_WEIGHT_SECTION
 } weight_type;
 
+// ================ Edge weight formats =================
+// Layouts of the explicit weights. The weights are read row by row. The column layouts (e.g. LOWER_COL)
+// are read as the transposed row layouts (e.g. UPPER_ROW)
+typedef enum {
+    FULL_MATRIX,    // the full n x n matrix
+    UPPER_ROW,      // the upper triangular matrix without the diagonal
+    LOWER_ROW,      // the lower triangular matrix without the diagonal
+    UPPER_DIAG_ROW, // the upper triangular matrix with the diagonal
+    LOWER_DIAG_ROW  // the lower triangular matrix with the diagonal
+} edge_weight_format;
+
 // =============== Solvers available ==================
 
 typedef enum {
@@ -77,6 +104,12 @@ typedef enum {
     SOLVE_2OPT_GREEDY,          // Uses 2opt algorithm with greedy initialization
     SOLVE_2OPT_GREEDY_ITER,     // Uses 2opt algorithm with iterative greedy initialization
     SOLVE_2OPT_EXTR_MIL,        // Uses 2opt algorithm with extra mileage initialization
+    SOLVE_3OPT_GRASP,           // Uses 3opt algorithm with grasp initialization
+    SOLVE_3OPT_GRASP_ITER,      // Uses 3opt algorithm with iterative grasp initialization
+    SOLVE_3OPT_GREEDY,          // Uses 3opt algorithm with greedy initialization
+    SOLVE_3OPT_GREEDY_ITER,     // Uses 3opt algorithm with iterative greedy initialization
+    SOLVE_3OPT_EXTR_MIL,        // Uses 3opt algorithm with extra mileage initialization
+    SOLVE_LK,                   // Uses the Lin-Kernighan style local search with greedy initialization
     SOLVE_VNS,                  // Uses the VNS local search algorithm
     SOLVE_TABU_STEP,            // Uses the Tabu search algorithm with step policy
     SOLVE_TABU_LIN,             // Uses the Tabu search algorithm with linear policy
@@ -93,16 +126,54 @@ typedef enum {
 #define SOLVER_DEFAULT_NAME "INCUMBENT CALLBACK"
 
 
-// Enum useful for the parser
+
+
+
+// ================ Distance matrix types =============
 typedef enum {
-    PARAM_SECTION,
-    NODE_COORD_SECTION,
-    EDGE_WEIGHT_SECTION,
-    DEMAND_SECTION,
-    DEPOT_SECTION
-} active_section;
+    DIST_MATRIX_OFF,    // Distances are always computed from the coordinates
+    DIST_MATRIX_AUTO,   // Integer entries with integer costs, double entries otherwise
+    DIST_MATRIX_DOUBLE, // Entries stored as double
+    DIST_MATRIX_FLOAT,  // Entries stored as float
+    DIST_MATRIX_INT     // Entries stored as int32. Valid only with integer costs
+} dist_matrix_type;
 
 
+// ================ Candidate lists types =============
+typedef enum {
+    CAND_KNN,       // The k nearest neighbors
+    CAND_DELAUNAY,  // The neighbors in the Delaunay graph
+    CAND_UNION      // The k nearest neighbors and the neighbors in the Delaunay graph
+} candidate_type;
+
+
+// ================ Refinement local searches =========
+typedef enum {
+    REFINE_2OPT,        // 2-opt on every pair of edges
+    REFINE_2OPT_CAND,   // 2-opt on the candidate lists with don't-look bits
+    REFINE_2OPT_OROPT,  // 2-opt and Or-opt on the candidate lists with don't-look bits
+    REFINE_LK           // Lin-Kernighan style moves and Or-opt on the candidate lists with don't-look bits
+} refine_type;
+
+
+// ================ Generated instances ==============
+typedef enum {
+    GEN_NONE,       // The instance is read from the file_path param
+    GEN_UNIFORM,    // Nodes uniformly distributed in a square
+    GEN_CLUSTERED,  // Nodes normally distributed around uniformly distributed centers
+    GEN_GRID        // Nodes on the points of a square grid
+} generator_type;
+
+
+// ================ Tour export formats ==============
+typedef enum {
+    EXPORT_AUTO,    // Chosen from the extension of the export path: BINARY for .succ, JSON for .json, TOUR otherwise
+    EXPORT_NONE,    // The tour is not exported
+    EXPORT_TOUR,    // TSPLIB .tour file
+    EXPORT_BINARY,  // Binary successor array, see export.h
+    EXPORT_JSON     // JSON object with the tour
+} export_format;
+
 
 // ================ Edge types =======================
 typedef enum {
@@ -131,6 +202,32 @@ typedef struct {
     int seed;           // Seed for random generation
     int perf_prof;      // Need to know wheter the computation is executed for performance profile
     int callback_2opt;  // Used in incubement callbacks for 2opt refinement
+    dist_matrix_type dist_type; // The element type of the precomputed distance matrix
+    long dist_mem_limit; // Max MB that the precomputed distance matrix can use
+    long dist_cache_mem; // Max MB that the distance row cache can use. 0 disables the cache, -1 means automatic
+    int cand_k;         // Number of neighbors in the candidate lists. 0 means no candidate lists
+    int cand_quadrant;  // 1 when the candidate lists are balanced between the four quadrants around each node
+    candidate_type cand_type; // Which neighbors are stored in the candidate lists
+    int sparse_model;   // 1 when the cplex models use only the edges of the candidate lists
+    refine_type refine; // The local search of the refinement heuristics, see localsearch.h
+    int inst_cache;     // 1 when the instance is loaded from its binary cache, see instcache.h
+    char *batch_path;   // Directory or manifest of the runs solved in batch mode. NULL for a single run, see batch.h
+    char *batch_output; // Path of the batch report. NULL to write it on the standard output
+    int batch_jobs;     // Number of runs solved concurrently in batch mode
+    int batch;          // 1 when the instance is solved by a run of a batch, which reports the result
+    char *warmstart_path; // Path of the tour used as starting solution. NULL when the methods build their own
+    generator_type gen_type; // How the instance is generated. GEN_NONE to read it from file_path, see generator.h
+    int gen_nodes;      // Number of nodes of the generated instance
+    weight_type gen_weight; // Weight type of the generated instance
+    int gen_capacity;   // Vehicle capacity of the generated CVRP instance. 0 to choose it, -1 to generate a TSP instance
+    char *gen_output;   // Path where the generated instance is written instead of being solved. NULL to solve it
+    export_format export_format; // Format of the exported tour
+    char *export_path;  // Path of the exported tour. NULL for ../tour/<name> with the extension of the format
+    int export_async;   // 1 when the tour is written by a background thread, see export.h
+    char *stream_path;  // File, named pipe or "fd:N" where the incumbents are streamed. NULL to not stream them, see incumbent.h
+    int stream_tour;    // 1 when the streamed incumbents have their tour
+    char *perf_csv;     // CSV file where the result of the run is appended for the performance profiles. NULL to not write it
+    char *result_cache; // Directory of the cached results of the runs. NULL to always solve, see resultcache.h
 } instance_params;
 
 // Definition of Node
@@ -141,6 +238,12 @@ typedef struct {
     bool is_depot;
 } node;
 
+// Latitude and longitude in radians of a node of a GEO instance
+typedef struct {
+    double lat;
+    double lon;
+} geo_coord;
+
 // Edge that connects node i and node j.
 // Directed edge: i -> j
 // Undirected edge: i - j
@@ -149,6 +252,83 @@ typedef struct {
     int j; // Index of node j
 } edge;
 
+// Packed upper triangular matrix of the distances. The entry of the edge (i, j)
+// is stored in the same position given by x_udir_pos(i, j, num_nodes)
+typedef struct {
+    void *data;             // Aligned storage of the entries. NULL when the matrix is not built
+    dist_matrix_type type;  // The element type of the entries. Never AUTO when the matrix is built
+    long size;              // The number of entries
+    void *map;              // The memory mapped distance file which contains data. NULL when data is allocated
+    size_t map_size;        // The size in bytes of the mapping
+} dist_matrix;
+
+// Neighbor of a node in the candidate lists
+typedef struct {
+    int node;       // Index of the neighbor
+    double dist;    // Distance between the node and the neighbor
+} neighbor;
+
+// The candidate neighbors of each node. The neighbors of node i are stored
+// in list[start[i] ... start[i + 1] - 1] sorted by increasing distance
+typedef struct {
+    neighbor *list;     // The neighbors of all the nodes. NULL when the lists are not built
+    int *start;         // Position of the first neighbor of each node. It has num_nodes + 1 entries
+    int k;              // Max number of neighbors of a node
+} candidate_lists;
+
+// Undirected graph in compressed form. The neighbors of node i are adj[start[i] ... start[i + 1] - 1], sorted by index
+typedef struct {
+    int *start;         // It has num_nodes + 1 entries. NULL when the graph is not built
+    int *adj;
+    long num_edges;
+} sparse_graph;
+
+// The x variables of the sparse undirected cplex model: one column for each edge of the candidate lists.
+// The neighbors of node i are adj[start[i] ... start[i + 1] - 1], sorted by index, and col[l] is the column of the edge (i, adj[l])
+typedef struct {
+    int *start;         // It has num_nodes + 1 entries. NULL when the model has a column for every edge
+    int *adj;
+    int *col;
+    long num_columns;
+} model_columns;
+
+struct instance;
+struct export_job;
+struct incumbent_stream;
+
+// Function which computes the distance between node i and node j. See select_dist_func in distutil.h
+typedef double (*dist_func)(int i, int j, struct instance *inst);
+
+// Function which computes the distance between node i and node j when the costs are integers. See get_int_dist_func in distutil.h
+typedef int (*int_dist_func)(int i, int j, struct instance *inst);
+
+// Cache of distance rows with CLOCK eviction. See distcache.h
+typedef struct {
+    void *rows;             // Storage of the cached rows, num_nodes entries each. NULL when the cache is not built
+    bool integer;           // Whether the entries are stored as int32 instead of double
+    int num_slots;          // Number of rows that fit in the cache
+    int *slot_of;           // Slot of the row of each node. -1 when the row is not cached
+    int *owner;             // Node whose row is stored in each slot. -1 when the slot is empty
+    unsigned char *ref;     // CLOCK reference bit of each slot
+    int hand;               // CLOCK hand: the next slot checked for eviction
+    int *miss_count;        // Misses of each node in the epoch miss_epoch
+    int *miss_epoch;        // Epoch of the misses counted in miss_count
+    int epoch;              // Current epoch. An epoch lasts num_nodes misses
+    long epoch_left;        // Misses left before the next epoch
+    dist_func base;         // The distance function used on misses and to fill the rows
+    long hits;
+    long misses;
+    long loads;             // Number of rows computed
+} dist_cache;
+
+// Implicit 2-d tree over the coordinates of the nodes. See kdtree.h
+typedef struct {
+    int *idx;               // Permutation of the nodes. The node of the subtree [lo, hi) is idx[(lo + hi) / 2]. NULL when the tree is not built
+    int *pos;               // Position of each node in idx
+    unsigned char *axis;    // Splitting axis of the subtree of each position: 0 for x, 1 for y
+    int *size;              // Number of nodes in the subtree of each position
+} kdtree;
+
 typedef struct {
 double obj_best;            // Stores the best value of the objective function
     edge *edges;            // List the solution's edges: list of pairs (i,j)
@@ -157,7 +337,7 @@ double obj_best;            // Stores the best value of the objective function
 } solution;
 
 // Instance data structure where all the information of the problem are stored
-typedef struct {
+typedef struct instance {
     instance_params params;
 
     char *name;
@@ -168,9 +348,25 @@ typedef struct {
     int num_nodes;
     int capacity;               // Truck's capacity
     weight_type weight_type;
+    edge_weight_format weight_format; // The layout of the weights of the EXPLICIT instances
     long num_columns;           // The number of variables. It is used in callback method
     int* ind;                   // List of the indices of solution values in cplex. Needed for updating manually the incubement in cplex. Used in callbacks
     unsigned int* thread_seeds; // An array which contains the seed for each thread. Used in relaxation callback to create a randomness
+    dist_matrix dist;           // The precomputed distances. Shared between the instance and its copies
+    double *xcoord;             // Aligned copy of the x coordinates of the nodes used by the vectorized distance kernels
+    double *ycoord;             // Aligned copy of the y coordinates of the nodes used by the vectorized distance kernels
+    geo_coord *geo;             // Latitude and longitude of the nodes computed once at parse time. NULL when the weight type is not GEO
+    dist_cache cache;           // The distance rows cache used when the matrix is not built. Not used by the copies
+    kdtree tree;                // The spatial index of the nodes. Shared between the instance and its copies
+    sparse_graph delaunay;      // The Delaunay graph of the nodes. Shared between the instance and its copies
+    candidate_lists cand;       // The candidate neighbors of each node. Shared between the instance and its copies
+    model_columns columns;      // The columns of the sparse undirected cplex model. They live as long as the model and are shared with the copies of the callbacks
+    int *warm_tour;             // The nodes of the warm start tour in visiting order. NULL without warm start. Shared between the instance and its copies
+    dist_func dist_fn;          // The distance function specialized for the weight type and the cost type. NULL until it is selected
+    int_dist_func int_dist_fn;  // The distance function returning integers. NULL when the costs are not integers
+    struct incumbent_stream *stream; // The stream of the incumbents during the run. NULL when they are not streamed, see incumbent.h
+    struct export_job *export_job; // The export of the tour running in background. NULL when there is none, see export.h
+    bool is_copy;               // Whether the instance is created by copy_instance. Copies don't own the shared precomputed data
 
     solution solution;
 } instance;
@@ -186,6 +382,15 @@ typedef struct {
  */
 double dmax(double d1, double d2);
 
+/**
+ * Calculates the minimum between two doubles
+ *
+ * @param d1 The first double value
+ * @param d2 The second double value
+ * @returns the minimum value
+ */
+double dmin(double d1, double d2);
+
 /**
  * Transforms the indexes (i, j) to a scalar index k for
  * undirecred graph;
@@ -200,6 +405,18 @@ double dmax(double d1, double d2);
  */
 int x_udir_pos(int i, int j, int num_nodes);
 
+/**
+ * Returns the column of the edge (i, j) in the undirected cplex model of the instance. It is x_udir_pos
+ * when the model has a column for every edge. In the sparse model only the edges of the candidate lists
+ * have a column, which is found in O(log k).
+ *
+ * @param inst The instance pointer of the problem
+ * @param i The index of node i
+ * @param j The index of node j
+ * @returns the column of the edge (i, j), -1 when the edge is not in the sparse model
+ */
+int x_udir_col(const instance *inst, int i, int j);
+
 
 /**
  * Transforms the indexes (i, j) to a scalar index k for
@@ -232,7 +449,7 @@ void parse_comand_line(int argc, const char *argv[], instance *inst);
 void free_instance(instance *inst);
 
 /**
- * Parses the problem data
+ * Parses the problem data from the TSPLIB file in the file_path param. See parse_tsplib_file in tsplib.h
  *
  * @param inst The instance pointer of the problem
  */ 
@@ -245,13 +462,6 @@ void parse_instance(instance *inst);
  */ 
 void print_instance(instance inst);
 
-/**
- * Exports the found tour in a .tour file
- *
- * @param inst The instance pointer of the problem
- */
-void export_tour(instance *inst);
-
 /**
  * Stores the solution given by xstar into a list of edges. 
  * With the list of edges is much more easier to retrieve the
@@ -339,16 +549,6 @@ void save_cplex_log(CPXENVptr env, instance *inst);
  */
 double get_elapsed_time(struct timeval start, struct timeval end);
 
-/**
- * Reverses the path from a chosen starting node and end node. Useful for 2-opt
- * 
- * @param inst The instance pointer of the problem
- * @param start_node The starting node of the reversed path
- * @param end_node The end node of the reversed path 
- * @param prev An array which stores the previous node of each node (i.e. like a successors array)
- */
-void reverse_path(instance *inst, int start_node, int end_node, int *prev);
-
 /**
  * Copies the src instance to dst instance. Parameter like name, comment etc which are not useful
  * for the problem solution are setted to NULL. The copied instance is used to make calculations in multi-threaded
@@ -360,6 +560,15 @@ void reverse_path(instance *inst, int start_node, int end_node, int *prev);
  */
 void copy_instance(instance *dst, instance *src);
 
+/**
+ * Copies the src params to dst params. Every string of the params is duplicated, so dst owns its own
+ * strings and they are freed by free_instance independently from the ones of src
+ *
+ * @param dst The destination params
+ * @param src The source params
+ */
+void copy_params(instance_params *dst, const instance_params *src);
+
 
 /**
  * Choses a random number in between [from, to)
@@ -370,4 +579,38 @@ void copy_instance(instance *dst, instance *src);
  */
 int rand_choice(int from, int to);
 
+/**
+ * Seeds the random generator of the calling thread. Each thread has its own generator, so the runs
+ * solved concurrently by the batch mode give the same results of the single runs with the same seed.
+ * The sequence is the same of srandom and random.
+ *
+ * @param seed The seed of the generator
+ */
+void seed_random(unsigned int seed);
+
+/**
+ * Returns the next number of the random generator of the calling thread. It is used by URAND.
+ * A thread which doesn't call seed_random uses the seed 1, as random does.
+ *
+ * @returns Random integer between [0, RAND_MAX]
+ */
+long next_random(void);
+
+/**
+ * Finds the method with the given name. The names are the ones listed by "--methods".
+ *
+ * @param name The name of the method
+ * @param params Where the method and its options (i.e. callback_2opt) are stored. They are not changed when the name is unknown
+ * @returns 1 if the method is found, 0 otherwise
+ */
+int parse_method(const char *name, instance_params *params);
+
+/**
+ * Parses the instance file of inst->params.file_path and builds all its precomputed data: the
+ * distance matrix, the distance kernels, the distance rows cache, the k-d tree and the candidate lists
+ *
+ * @param inst The instance pointer of the problem
+ */
+void load_instance(instance *inst);
+
 #endif
\ No newline at end of file
@@ -6,6 +6,7 @@ import matplotlib
 #matplotlib.use('PDF')
 import matplotlib.pyplot as plt
 import sys
+import csv
 
 from optparse import OptionParser
 
@@ -35,6 +36,7 @@ class CmdLineParser(object):
 		self.parser.add_option("-P", "--plot-title", dest="plottitle", default=None, help="plot title")
 		self.parser.add_option("-X", "--x-label", dest="xlabel", default='Time Ratio', help="x axis label")
 		self.parser.add_option("-B", "--bw", dest="bw", action="store_true", default=False, help="plot B/W")
+		self.parser.add_option("-R", "--rows", dest="rows", default=None, choices=['time', 'objective'], help="read the rows written by -perfcsv and use this column (time or objective)")
 
 	def addOption(self, *args, **kwargs):
 		self.parser.add_option(*args, **kwargs)
@@ -71,12 +73,42 @@ def readTable(fp, delimiter):
 	return (rnames, cnames, data)
 
 
+def readRows(fp, column):
+	"""
+	read the CSV file written by the -perfcsv option of the solver
+	the format is as follows:
+	instance,method,time,objective,status,seed
+	the runs of the same instance and method with different seeds are averaged,
+	the instances without a run of each method are skipped
+	"""
+	values = {}
+	methods = []
+	for row in csv.DictReader(fp):
+		if row['method'] not in methods:
+			methods.append(row['method'])
+		values.setdefault(row['instance'], {}).setdefault(row['method'], []).append(float(row[column]))
+	assert(len(methods) <= len(markers))
+	rnames = []
+	rows = []
+	for name in sorted(values):
+		if len(values[name]) < len(methods):
+			print('Skipping instance %s: not solved by every method' % name, file=sys.stderr)
+			continue
+		rnames.append(name)
+		rows.append(np.array([np.mean(values[name][m]) for m in methods]))
+	data = np.array(rows)
+	return (rnames, methods, data)
+
+
 def main():
 	parser = CmdLineParser()
 	opt = parser.parseArgs()
 	print(opt)
 	# read data
-	rnames, cnames, data = readTable(open(opt.input, 'r'), opt.delimiter)
+	if opt.rows is not None:
+		rnames, cnames, data = readRows(open(opt.input, 'r'), opt.rows)
+	else:
+		rnames, cnames, data = readTable(open(opt.input, 'r'), opt.delimiter)
 	nrows, ncols = data.shape
 	# add shift
 	data = data + opt.shift
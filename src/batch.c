@@ -0,0 +1,367 @@
+#include "batch.h"
+
+#include "solver.h"
+
+#include <dirent.h>
+#include <pthread.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// A run of the batch
+typedef struct {
+    int index;          // Position of the run in the directory or in the manifest
+    int group;          // Index of the instance of the run in batch_context.instances
+    sol_method method;
+    int callback_2opt;  // 1 when the method uses the 2-opt refinement in the callbacks
+    int seed;
+} batch_run;
+
+// An instance shared by its runs. It is loaded by the first run which needs it and freed by the last one
+typedef struct {
+    char *path;             // The path of the instance file
+    instance inst;
+    int loaded;             // 1 when inst is loaded, -1 when its file can't be loaded
+    int pending;            // Number of runs on the instance which are not ended
+    pthread_mutex_t lock;   // Guards inst, loaded and pending
+} batch_instance;
+
+typedef struct {
+    const instance *base;       // The instance with the params of the command line
+    batch_run *runs;            // The runs sorted by instance, so only the instances of the running jobs are in memory
+    int num_runs;
+    batch_instance *instances;
+    int num_instances;
+    int next_run;               // Index in runs of the next run to solve
+    int run_threads;            // Max number of threads of each run
+    int run_verbose;            // Verbose level of the runs. 0 when the report is on the standard output, so the logs don't mix with it
+    int failed;                 // Number of runs ended with an error
+    FILE *report;
+    int jsonl;                  // 1 when the report is written as JSON lines, 0 for CSV
+    pthread_mutex_t lock;       // Guards next_run, failed and report
+} batch_context;
+
+static char *copy_string(const char *str) {
+    char *copy = CALLOC(strlen(str) + 1, char);
+    memcpy(copy, str, strlen(str));
+    return copy;
+}
+
+static int ends_with(const char *str, const char *suffix) {
+    size_t len = strlen(str);
+    size_t suffix_len = strlen(suffix);
+    return len >= suffix_len && strcmp(str + len - suffix_len, suffix) == 0;
+}
+
+// Checks if the file name is a .tsp or .vrp instance, possibly compressed
+static int is_instance_file(const char *name) {
+    size_t len = strlen(name);
+    if (ends_with(name, ".gz")) { len -= 3; }
+    else if (ends_with(name, ".zst")) { len -= 4; }
+    return len > 4 && (strncmp(name + len - 4, ".tsp", 4) == 0 || strncmp(name + len - 4, ".vrp", 4) == 0);
+}
+
+// Returns the index of the instance of the path, adding it if it is not in the batch
+static int find_instance(batch_context *ctx, const char *path) {
+    for (int i = 0; i < ctx->num_instances; i++) {
+        if (strcmp(ctx->instances[i].path, path) == 0) { return i; }
+    }
+    ctx->instances = REALLOC(ctx->instances, ctx->num_instances + 1, batch_instance);
+    batch_instance *shared = &ctx->instances[ctx->num_instances];
+    memset(shared, 0, sizeof(batch_instance));
+    shared->path = copy_string(path);
+    return ctx->num_instances++;
+}
+
+static void add_run(batch_context *ctx, const char *path, const instance_params *params, int seed) {
+    ctx->runs = REALLOC(ctx->runs, ctx->num_runs + 1, batch_run);
+    batch_run *run = &ctx->runs[ctx->num_runs];
+    run->index = ctx->num_runs;
+    run->group = find_instance(ctx, path);
+    run->method = params->method;
+    run->callback_2opt = params->callback_2opt;
+    run->seed = seed;
+    ctx->instances[run->group].pending++;
+    ctx->num_runs++;
+}
+
+static int compare_names(const void *a, const void *b) {
+    return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+// Adds a run for each instance file of the directory, in alphabetical order
+static void read_directory(batch_context *ctx, const char *dir_path) {
+    DIR *dir = opendir(dir_path);
+    if (dir == NULL) { LOG_E("Unable to open the directory %s", dir_path); }
+    char **names = NULL;
+    int num_names = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (!is_instance_file(entry->d_name)) { continue; }
+        names = REALLOC(names, num_names + 1, char *);
+        names[num_names++] = copy_string(entry->d_name);
+    }
+    closedir(dir);
+    qsort(names, num_names, sizeof(char *), compare_names);
+
+    for (int i = 0; i < num_names; i++) {
+        size_t len = strlen(dir_path) + strlen(names[i]) + 2;
+        char *path = CALLOC(len, char);
+        snprintf(path, len, "%s/%s", dir_path, names[i]);
+        struct stat st;
+        if (stat(path, &st) == 0 && S_ISREG(st.st_mode)) {
+            add_run(ctx, path, &ctx->base->params, ctx->base->params.seed);
+        }
+        FREE(path);
+        FREE(names[i]);
+    }
+    FREE(names);
+}
+
+// Adds a run for each line "instance [method] [seed]" of the manifest
+static void read_manifest(batch_context *ctx, const char *manifest_path) {
+    FILE *fp = fopen(manifest_path, "r");
+    if (fp == NULL) { LOG_E("Unable to open the manifest %s", manifest_path); }
+    const char *slash = strrchr(manifest_path, '/');
+    size_t dir_len = slash != NULL ? (size_t) (slash - manifest_path + 1) : 0; // The directory with the final slash
+
+    char *line = NULL;
+    size_t capacity = 0;
+    int line_num = 0;
+    while (getline(&line, &capacity, fp) != -1) {
+        line_num++;
+        char *save = NULL;
+        char *file = strtok_r(line, " \t\r\n,", &save);
+        if (file == NULL || file[0] == '#') { continue; }
+        char *method_name = strtok_r(NULL, " \t\r\n,", &save);
+        char *seed = strtok_r(NULL, " \t\r\n,", &save);
+
+        instance_params params = ctx->base->params;
+        if (method_name != NULL && !parse_method(method_name, &params)) {
+            LOG_E("Unknown method %s at line %d of the manifest %s", method_name, line_num, manifest_path);
+        }
+        size_t len = strlen(file) + dir_len + 1;
+        char *path = CALLOC(len, char);
+        if (file[0] == '/') {
+            memcpy(path, file, strlen(file));
+        } else {
+            memcpy(path, manifest_path, dir_len);
+            memcpy(path + dir_len, file, strlen(file));
+        }
+        add_run(ctx, path, &params, seed != NULL ? atoi(seed) : ctx->base->params.seed);
+        FREE(path);
+    }
+    free(line);
+    fclose(fp);
+}
+
+// Runs of the same instance are consecutive, and in the order of the batch
+static int compare_runs(const void *a, const void *b) {
+    const batch_run *r1 = a;
+    const batch_run *r2 = b;
+    if (r1->group != r2->group) { return r1->group - r2->group; }
+    return r1->index - r2->index;
+}
+
+static void write_json_string(FILE *out, const char *str) {
+    fputc('"', out);
+    for (const char *c = str; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') { fputc('\\', out); fputc(*c, out); }
+        else if ((unsigned char) *c < 0x20) { fprintf(out, "\\u%04x", (unsigned char) *c); }
+        else { fputc(*c, out); }
+    }
+    fputc('"', out);
+}
+
+// The fields with commas, quotes or line breaks are quoted, doubling the quotes
+static void write_csv_field(FILE *out, const char *str) {
+    if (strpbrk(str, ",\"\r\n") == NULL) {
+        fputs(str, out);
+        return;
+    }
+    fputc('"', out);
+    for (const char *c = str; *c != '\0'; c++) {
+        if (*c == '"') { fputc('"', out); }
+        fputc(*c, out);
+    }
+    fputc('"', out);
+}
+
+// Writes the row of the run. inst is NULL when the run failed before its instance was loaded: the row has no name, nodes, cost and time
+static void write_result(batch_context *ctx, const batch_run *run, const batch_instance *shared, const instance *inst, int status) {
+    pthread_mutex_lock(&ctx->lock);
+    if (status != 0) { ctx->failed++; }
+    FILE *out = ctx->report;
+    const char *name = inst != NULL && inst->name != NULL ? inst->name : "";
+    int num_nodes = inst != NULL ? inst->num_nodes : 0;
+    double cost = inst != NULL ? inst->solution.obj_best : 0.0;
+    double time = inst != NULL ? inst->solution.time_to_solve : 0.0;
+    if (ctx->jsonl) {
+        fprintf(out, "{\"run\":%d,\"instance\":", run->index);
+        write_json_string(out, name);
+        fprintf(out, ",\"file\":");
+        write_json_string(out, shared->path);
+        fprintf(out, ",\"method\":");
+        write_json_string(out, run->method.name);
+        fprintf(out, ",\"seed\":%d,\"nodes\":%d,\"cost\":%0.6f,\"time\":%0.6f,\"status\":%d}\n",
+                run->seed, num_nodes, cost, time, status);
+    } else {
+        fprintf(out, "%d,", run->index);
+        write_csv_field(out, name);
+        fputc(',', out);
+        write_csv_field(out, shared->path);
+        fputc(',', out);
+        write_csv_field(out, run->method.name);
+        fprintf(out, ",%d,%d,%0.6f,%0.6f,%d\n", run->seed, num_nodes, cost, time, status);
+    }
+    fflush(out); // The results of the ended runs are kept if a later run stops the program
+    pthread_mutex_unlock(&ctx->lock);
+}
+
+// Loads the instance with the params of the command line. An error in the instance file, logged with LOG_E,
+// jumps back here instead of ending the program, and the runs on the instance are reported as failed
+static void load_shared_instance(batch_context *ctx, batch_instance *shared) {
+    memcpy(&shared->inst, ctx->base, sizeof(instance));
+    copy_params(&shared->inst.params, &ctx->base->params); // The shared instance owns its strings, so it is freed like any other
+    FREE(shared->inst.params.file_path);
+    shared->inst.params.file_path = copy_string(shared->path);
+    shared->inst.params.gen_type = GEN_NONE;  // The runs read their instance files
+    FREE(shared->inst.params.batch_path);
+    FREE(shared->inst.params.batch_output);
+    FREE(shared->inst.params.gen_output);
+    shared->inst.params.verbose = ctx->run_verbose;
+    shared->inst.params.batch = 1; // A warm start tour of another size is skipped, see parse_tour_file
+    jmp_buf jump;
+    if (setjmp(jump) == 0) {
+        error_jump = &jump;
+        load_instance(&shared->inst);
+        shared->loaded = 1;
+    } else {
+        shared->loaded = -1; // The partially loaded data is freed by the last run on the instance
+    }
+    error_jump = NULL;
+}
+
+// Solves the run on a copy of its instance, which shares the precomputed data with the other runs on the instance
+static void solve_run(batch_context *ctx, const batch_run *run, batch_instance *shared, CPXENVptr *env) {
+    instance inst;
+    copy_instance(&inst, &shared->inst);
+    inst.name = copy_string(shared->inst.name != NULL ? shared->inst.name : shared->path);
+    inst.params.method = run->method;
+    inst.params.callback_2opt = run->callback_2opt;
+    inst.params.seed = run->seed;
+    inst.params.num_threads = ctx->run_threads;
+    inst.params.verbose = ctx->run_verbose;
+    inst.params.batch = 1;
+    inst.params.perf_prof = 1; // No plots, tour files and cplex logs
+
+    int status;
+    if (inst.params.method.use_cplex) {
+        int error = 0;
+        if (*env == NULL) { *env = CPXopenCPLEX(&error); } // Tried again by the next cplex run when it fails
+        if (*env == NULL) {
+            fprintf(stderr, "[ERROR] CPXopenCPLEX() error code %d\n", error);
+            status = BATCH_RUN_ERROR;
+        } else {
+            status = TSP_opt_env(&inst, *env);
+            if (status) { fprintf(stderr, "[ERROR] Cplex solver encountered an error with error code %d on %s\n", status, shared->path); }
+        }
+    } else {
+        status = TSP_heuc(&inst);
+    }
+    write_result(ctx, run, shared, &inst, status);
+    free_instance(&inst);
+}
+
+static void *batch_worker(void *arg) {
+    batch_context *ctx = arg;
+    CPXENVptr env = NULL; // Opened at the first cplex run of the thread and reused by the next ones
+
+    while (1) {
+        pthread_mutex_lock(&ctx->lock);
+        int r = ctx->next_run++;
+        pthread_mutex_unlock(&ctx->lock);
+        if (r >= ctx->num_runs) { break; }
+        batch_run *run = &ctx->runs[r];
+        batch_instance *shared = &ctx->instances[run->group];
+
+        pthread_mutex_lock(&shared->lock);
+        if (!shared->loaded) { load_shared_instance(ctx, shared); }
+        int load_failed = shared->loaded < 0;
+        pthread_mutex_unlock(&shared->lock);
+
+        if (load_failed) {
+            write_result(ctx, run, shared, NULL, BATCH_RUN_ERROR);
+        } else {
+            solve_run(ctx, run, shared, &env);
+        }
+
+        pthread_mutex_lock(&shared->lock);
+        if (--shared->pending == 0) {
+            free_instance(&shared->inst); // Also the data of a failed load, whose pointers are NULL or allocated
+            shared->loaded = 0;
+        }
+        pthread_mutex_unlock(&shared->lock);
+    }
+
+    if (env != NULL) { CPXcloseCPLEX(&env); }
+    return NULL;
+}
+
+int solve_batch(instance *inst) {
+    const char *path = inst->params.batch_path;
+    batch_context ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.base = inst;
+
+    struct stat st;
+    if (stat(path, &st) != 0) { LOG_E("Unable to read the batch %s", path); }
+    if (S_ISDIR(st.st_mode)) {
+        read_directory(&ctx, path);
+    } else {
+        read_manifest(&ctx, path);
+    }
+    if (ctx.num_runs == 0) { LOG_E("The batch %s has no runs", path); }
+    qsort(ctx.runs, ctx.num_runs, sizeof(batch_run), compare_runs);
+
+    int num_jobs = inst->params.batch_jobs < ctx.num_runs ? inst->params.batch_jobs : ctx.num_runs;
+    long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    ctx.run_threads = inst->params.num_threads > 0 ? inst->params.num_threads : (num_cpus > num_jobs ? num_cpus / num_jobs : 1);
+
+    const char *output = inst->params.batch_output;
+    ctx.report = output != NULL ? fopen(output, "w") : stdout;
+    if (ctx.report == NULL) { LOG_E("Unable to write the batch report %s", output); }
+    ctx.jsonl = output != NULL && ends_with(output, ".jsonl");
+    ctx.run_verbose = ctx.report == stdout ? 0 : inst->params.verbose;
+    if (!ctx.jsonl) { fprintf(ctx.report, "run,instance,file,method,seed,nodes,cost,time,status\n"); }
+
+    // The mutexes are initialized after the arrays stop growing
+    pthread_mutex_init(&ctx.lock, NULL);
+    for (int i = 0; i < ctx.num_instances; i++) { pthread_mutex_init(&ctx.instances[i].lock, NULL); }
+
+    struct timeval start, end;
+    gettimeofday(&start, 0);
+    pthread_t *threads = MALLOC(num_jobs, pthread_t);
+    for (int i = 0; i < num_jobs; i++) {
+        if (pthread_create(&threads[i], NULL, batch_worker, &ctx) != 0) { LOG_E("Unable to start the batch threads"); }
+    }
+    for (int i = 0; i < num_jobs; i++) { pthread_join(threads[i], NULL); }
+    gettimeofday(&end, 0);
+
+    if (inst->params.verbose >= 3) {
+        LOG_I("Batch solved: %d runs on %d instances with %d jobs of %d threads in %0.3f seconds",
+              ctx.num_runs, ctx.num_instances, num_jobs, ctx.run_threads, get_elapsed_time(start, end));
+    }
+    if (ctx.report != stdout) { fclose(ctx.report); }
+    for (int i = 0; i < ctx.num_instances; i++) {
+        pthread_mutex_destroy(&ctx.instances[i].lock);
+        FREE(ctx.instances[i].path);
+    }
+    pthread_mutex_destroy(&ctx.lock);
+    FREE(threads);
+    FREE(ctx.instances);
+    FREE(ctx.runs);
+    return ctx.failed > 0;
+}
@@ -3,6 +3,8 @@
 #include <concorde.h>
 #include <cut.h>
 #include "heuristics.h"
+#include "incumbent.h"
+#include "localsearch.h"
 
 
 static int add_SEC_cuts(instance *inst, CPXCALLBACKCONTEXTptr context, int current_tour, int *comp, int *indexes, double *values) {
@@ -43,6 +45,12 @@ static int CPXPUBLIC SEC_cuts_callback_candidate(CPXCALLBACKCONTEXTptr context,
         LOG_I("Num components candidate: %d", num_comp);
     }
 
+    double bound = STREAM_NO_BOUND;
+    if (num_comp == 1 && inst->stream != NULL) { // A feasible tour: it is the new incumbent if it improves the last one
+        CPXcallbackgetinfodbl(context, CPXCALLBACKINFO_BEST_BND, &bound);
+        stream_incumbent_succ(inst, objval, bound, succ);
+    }
+
     if (num_comp > 1) { // More than one tours found. Violated so add the cuts
         if (inst->params.verbose >= 5) {
             LOG_I("Added SEC cut in node %d", currentnode);
@@ -66,7 +74,7 @@ static int CPXPUBLIC SEC_cuts_callback_candidate(CPXCALLBACKCONTEXTptr context,
         copy_instance(&tempinst, inst);
         save_solution_edges(&tempinst, xstar);
         tempinst.solution.obj_best = objval; // 2opt needs the current objective value
-        alg_2opt(&tempinst);
+        refine_solution(&tempinst, NULL, 0);
         if (inst->params.verbose >= 5) {
             LOG_I("Applied 2-opt refinement");
             LOG_D("Incubement: %0.0f", tempinst.solution.obj_best);
@@ -75,16 +83,22 @@ static int CPXPUBLIC SEC_cuts_callback_candidate(CPXCALLBACKCONTEXTptr context,
         MEMSET(xstar, 0.0, inst->num_columns, double);
        
         // Filling xstar with the solution found by 2-opt
+        int in_model = 1; // 0 when the 2-opt solution uses an edge out of the sparse model
         for (int i = 0; i < tempinst.num_nodes; i++) {
             edge e = tempinst.solution.edges[i];
-            xstar[x_udir_pos(e.i, e.j, tempinst.num_nodes)] = 1.0;
+            int col = x_udir_col(&tempinst, e.i, e.j);
+            if (col < 0) { in_model = 0; break; }
+            xstar[col] = 1.0;
         }
 
         // Saving the heuristic solution found with 2opt to cplex in order to improve the convergence speed. The 2-opt solution found is complete so no need to check it
         // Check here for other strategies: https://www.ibm.com/docs/en/icos/20.1.0?topic=manual-cpxcallbacksolutionstrategy
-        int status = CPXcallbackpostheursoln(context, ncols, inst->ind, xstar, tempinst.solution.obj_best, CPXCALLBACKSOLUTION_NOCHECK);
-        if (status) {
-            LOG_I("An error occured on CPXcallbackpostheursoln");
+        if (in_model) {
+            int status = CPXcallbackpostheursoln(context, ncols, inst->ind, xstar, tempinst.solution.obj_best, CPXCALLBACKSOLUTION_NOCHECK);
+            if (status) {
+                LOG_I("An error occured on CPXcallbackpostheursoln");
+            }
+            stream_incumbent(inst, tempinst.solution.obj_best, bound, tempinst.solution.edges);
         }
         free_instance(&tempinst);
 
@@ -118,7 +132,8 @@ static int violated_cuts_callback(double cutval, int num_nodes, int* members, vo
     for (int i = 0; i < num_nodes; i++) {
         for (int j = 0; j < num_nodes; j++) {
             if (members[i] >= members[j]) { continue; } // undirected graph. If the node in index i is greated than the node in index j, we skip since (i,j) = (j,i)
-            edges[k] = x_udir_pos(members[i], members[j], inst->num_nodes);
+            edges[k] = x_udir_col(inst, members[i], members[j]);
+            if (edges[k] < 0) { continue; } // The edge is not in the sparse model
             values[k] = 1.0;
             k++;
             //LOG_D("X(%d,%d)", members[i], members[j]);
@@ -126,7 +141,7 @@ static int violated_cuts_callback(double cutval, int num_nodes, int* members, vo
     }
     int purgeable = CPX_USECUT_FILTER;
 	int local = 0;
-    int status = CPXcallbackaddusercuts(context, 1, num_edges, &rhs, &sense, &matbeg, edges, values, &purgeable, &local);
+    int status = CPXcallbackaddusercuts(context, 1, k, &rhs, &sense, &matbeg, edges, values, &purgeable, &local);
     FREE(values);
     if (status) LOG_E("CPXcallbackaddusercuts() when conn comps = 1. Error code %d", status);
     return 0;
@@ -182,6 +197,7 @@ static int CPXPUBLIC SEC_cuts_callback_relaxation(CPXCALLBACKCONTEXTptr context,
     for (int i = 0; i < inst->num_nodes; i++) {
         for (int j = i+1; j < inst->num_nodes; j++) {
             //if (fabs(xstar[x_udir_pos(i, j, inst->num_nodes)]) <= EPS) continue;
+            if (x_udir_col(inst, i, j) < 0) continue; // The edges follow the order of the columns
             elist[k++] = i;
             elist[k++] = j;
             num_edges++;
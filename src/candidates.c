@@ -0,0 +1,146 @@
+#include "candidates.h"
+
+#include "distutil.h"
+#include "kdtree.h"
+#include "delaunay.h"
+
+#include <stdlib.h>
+
+// Inserts the node in the sorted list if it is among the k nearest ones. Ties are broken by index
+static void insert_sorted(neighbor *best, int *count, int k, int node, double dist) {
+    if (*count == k) {
+        neighbor worst = best[k - 1];
+        if (dist > worst.dist || (dist == worst.dist && node > worst.node)) { return; }
+        (*count)--;
+    }
+    int pos = *count;
+    while (pos > 0 && (best[pos - 1].dist > dist || (best[pos - 1].dist == dist && best[pos - 1].node > node))) {
+        best[pos] = best[pos - 1];
+        pos--;
+    }
+    best[pos].node = node;
+    best[pos].dist = dist;
+    (*count)++;
+}
+
+// Finds the k nearest nodes computing the distance of every node. Used when the k-d tree is not built (GEO instances).
+// The quadrants are the same of kdtree_search
+static int brute_force_search(instance *inst, int from, int k, int quadrant, neighbor *best) {
+    dist_func dist = get_dist_func(inst);
+    node p0 = inst->nodes[from];
+    int count = 0;
+    for (int j = 0; j < inst->num_nodes; j++) {
+        if (j == from) { continue; }
+        node p = inst->nodes[j];
+        if (quadrant >= 0 && ((p.x < p0.x ? 1 : 0) | (p.y < p0.y ? 2 : 0)) != quadrant) { continue; }
+        insert_sorted(best, &count, k, j, dist(from, j, inst));
+    }
+    return count;
+}
+
+static int knn_search(instance *inst, int from, int k, int quadrant, neighbor *best) {
+    if (inst->tree.idx != NULL) { return kdtree_search(inst, NULL, from, k, quadrant, best); }
+    return brute_force_search(inst, from, k, quadrant, best);
+}
+
+// Finds the k nearest neighbors of node i, optionally balanced between the quadrants. Returns their number
+static int knn_candidates(instance *inst, int i, int k, int quad_k, neighbor *best, neighbor *found) {
+    int count = 0;
+    // The nearest neighbors of each quadrant, then the list is filled with the nearest ones overall
+    for (int quadrant = 0; quadrant < 4 && quad_k > 0; quadrant++) {
+        int num_found = knn_search(inst, i, quad_k, quadrant, found);
+        for (int l = 0; l < num_found; l++) { insert_sorted(best, &count, k, found[l].node, found[l].dist); }
+    }
+    int num_found = knn_search(inst, i, k, -1, found);
+    for (int l = 0; l < num_found && count < k; l++) {
+        int duplicate = 0;
+        for (int m = 0; m < count && !duplicate; m++) { duplicate = best[m].node == found[l].node; }
+        if (!duplicate) { insert_sorted(best, &count, k, found[l].node, found[l].dist); }
+    }
+    return count;
+}
+
+int build_candidate_lists(instance *inst) {
+    inst->cand.list = NULL;
+    inst->cand.start = NULL;
+    inst->cand.k = 0;
+    candidate_type type = inst->params.cand_type;
+    if (type != CAND_KNN && inst->delaunay.start == NULL && !build_delaunay(inst)) {
+        if (inst->params.verbose >= 3) { LOG_I("The Delaunay graph is not available: the candidate lists use the nearest neighbors only"); }
+        type = CAND_KNN;
+    }
+    int k = inst->params.cand_k < inst->num_nodes - 1 ? inst->params.cand_k : inst->num_nodes - 1;
+    if (k < 0 || inst->num_nodes < 2) { k = 0; }
+    if (type == CAND_DELAUNAY) { k = 0; }
+    if (k == 0 && type == CAND_KNN) { return 0; }
+
+    struct timeval start, end;
+    gettimeofday(&start, 0);
+
+    int max_degree = 0;
+    if (type != CAND_KNN) {
+        for (int i = 0; i < inst->num_nodes; i++) {
+            int degree = inst->delaunay.start[i + 1] - inst->delaunay.start[i];
+            max_degree = degree > max_degree ? degree : max_degree;
+        }
+    }
+    int max_count = k + max_degree; // Max neighbors of a node
+
+    dist_func dist = get_dist_func(inst);
+    int *cand_start = MALLOC(inst->num_nodes + 1, int);
+    long capacity = (long) inst->num_nodes * (k > 0 ? k : 1) + 1;
+    neighbor *list = MALLOC(capacity, neighbor);
+    long size = 0;
+    neighbor *best = MALLOC(max_count, neighbor);
+    neighbor *found = MALLOC(k > 0 ? k : 1, neighbor);
+    int quad_k = inst->params.cand_quadrant ? k / 4 : 0; // Neighbors taken from each quadrant
+    int longest = 0;
+    for (int i = 0; i < inst->num_nodes; i++) {
+        int count = k > 0 ? knn_candidates(inst, i, k, quad_k, best, found) : 0;
+        if (type != CAND_KNN) {
+            // Adding the neighbors in the Delaunay graph which are not already in the list
+            int num_knn = count;
+            for (int l = inst->delaunay.start[i]; l < inst->delaunay.start[i + 1]; l++) {
+                int j = inst->delaunay.adj[l];
+                int duplicate = 0;
+                for (int m = 0; m < num_knn && !duplicate; m++) { duplicate = best[m].node == j; }
+                if (!duplicate) { insert_sorted(best, &count, max_count, j, dist(i, j, inst)); }
+            }
+        }
+
+        if (size + count > capacity) {
+            capacity = 2 * capacity + count;
+            list = REALLOC(list, capacity, neighbor);
+        }
+        cand_start[i] = size;
+        memcpy(list + size, best, sizeof(neighbor) * count);
+        size += count;
+        longest = count > longest ? count : longest;
+    }
+    cand_start[inst->num_nodes] = size;
+    FREE(best);
+    FREE(found);
+
+    inst->cand.list = REALLOC(list, size > 0 ? size : 1, neighbor);
+    inst->cand.start = cand_start;
+    inst->cand.k = longest;
+
+    gettimeofday(&end, 0);
+    if (inst->params.verbose >= 3) {
+        const char *name = type == CAND_KNN ? "nearest" : (type == CAND_DELAUNAY ? "Delaunay" : "nearest and Delaunay");
+        LOG_I("Candidate lists built: %ld %s neighbors, at most %d per node%s in %0.3f seconds", size, name, longest,
+              quad_k > 0 ? " (quadrant balanced)" : "", get_elapsed_time(start, end));
+    }
+    return 1;
+}
+
+bool is_candidate_edge(const instance *inst, int i, int j) {
+    if (inst->cand.list == NULL) { return true; }
+    for (int l = inst->cand.start[i]; l < inst->cand.start[i + 1]; l++) {
+        if (inst->cand.list[l].node == j) { return true; }
+    }
+    for (int l = inst->cand.start[j]; l < inst->cand.start[j + 1]; l++) {
+        if (inst->cand.list[l].node == i) { return true; }
+    }
+    return false;
+}
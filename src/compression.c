@@ -0,0 +1,124 @@
+#include "compression.h"
+
+#include <stdlib.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#define MIN_DECODE_BUFFER 4096          // Initial size of the decoded buffer when the stream doesn't store its decoded size
+#define MAX_INFLATE_CHUNK (1U << 30)    // zlib counts the available bytes with 32-bit integers
+
+compression_type detect_compression(const char *data, size_t len) {
+    const unsigned char *p = (const unsigned char *) data;
+    if (len >= 2 && p[0] == 0x1F && p[1] == 0x8B) { return COMPRESSION_GZIP; }
+    if (len >= 4 && p[0] == 0x28 && p[1] == 0xB5 && p[2] == 0x2F && p[3] == 0xFD) { return COMPRESSION_ZSTD; }
+    return COMPRESSION_NONE;
+}
+
+// Doubles the decoded buffer when it is full
+static char *grow_buffer(char *buffer, size_t used, size_t *capacity) {
+    if (used < *capacity) { return buffer; }
+    *capacity *= 2;
+    buffer = REALLOC(buffer, *capacity, char);
+    if (buffer == NULL) { LOG_E("Unable to allocate the decompressed instance: %0.1f MB", *capacity / (1024.0 * 1024.0)); }
+    return buffer;
+}
+
+#ifdef HAVE_ZLIB
+static char *gunzip(const char *data, size_t len, size_t *out_len) {
+    // The last 4 bytes of a gzip member store its decoded size modulo 2^32: it is only a hint
+    size_t capacity = MIN_DECODE_BUFFER;
+    if (len >= 18) {
+        const unsigned char *p = (const unsigned char *) data + len - 4;
+        size_t isize = (size_t) p[0] | (size_t) p[1] << 8 | (size_t) p[2] << 16 | (size_t) p[3] << 24;
+        if (isize + 1 > capacity) { capacity = isize + 1; }
+    }
+    char *buffer = MALLOC(capacity, char);
+    if (buffer == NULL) { LOG_E("Unable to allocate the decompressed instance: %0.1f MB", capacity / (1024.0 * 1024.0)); }
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit2(&stream, 15 + 16) != Z_OK) { LOG_E("Unable to initialize the gzip decoder"); } // 15 + 16: gzip header, max window
+    size_t used = 0;
+    size_t consumed = 0;
+    while (1) {
+        if (stream.avail_in == 0 && consumed < len) {
+            size_t chunk = len - consumed < MAX_INFLATE_CHUNK ? len - consumed : MAX_INFLATE_CHUNK;
+            stream.next_in = (Bytef *) (data + consumed);
+            stream.avail_in = chunk;
+            consumed += chunk;
+        }
+        buffer = grow_buffer(buffer, used, &capacity);
+        size_t available = capacity - used < MAX_INFLATE_CHUNK ? capacity - used : MAX_INFLATE_CHUNK;
+        stream.next_out = (Bytef *) (buffer + used);
+        stream.avail_out = available;
+        int ret = inflate(&stream, Z_NO_FLUSH);
+        used += available - stream.avail_out;
+        if (ret == Z_STREAM_END) {
+            if (stream.avail_in == 0 && consumed == len) { break; }
+            inflateReset(&stream); // The next member of the file
+            continue;
+        }
+        if (ret != Z_OK && ret != Z_BUF_ERROR) { LOG_E("Corrupted gzip stream: %s", stream.msg != NULL ? stream.msg : "unknown error"); }
+        if (ret == Z_BUF_ERROR && stream.avail_in == 0 && consumed == len) { LOG_E("Truncated gzip stream"); }
+    }
+    inflateEnd(&stream);
+    *out_len = used;
+    return buffer;
+}
+#endif
+
+#ifdef HAVE_ZSTD
+static char *unzstd(const char *data, size_t len, size_t *out_len) {
+    // The frame header may store the decoded size of the frame: it is only a hint
+    size_t capacity = MIN_DECODE_BUFFER;
+    unsigned long long content_size = ZSTD_getFrameContentSize(data, len);
+    if (content_size != ZSTD_CONTENTSIZE_UNKNOWN && content_size != ZSTD_CONTENTSIZE_ERROR && content_size + 1 > capacity) {
+        capacity = content_size + 1;
+    }
+    char *buffer = MALLOC(capacity, char);
+    if (buffer == NULL) { LOG_E("Unable to allocate the decompressed instance: %0.1f MB", capacity / (1024.0 * 1024.0)); }
+
+    ZSTD_DCtx *context = ZSTD_createDCtx();
+    if (context == NULL) { LOG_E("Unable to initialize the zstd decoder"); }
+    ZSTD_inBuffer input = {data, len, 0};
+    size_t used = 0;
+    size_t ret = 1;
+    // The loop ends when the input is consumed and the last frame is complete and flushed (ret is 0)
+    while (input.pos < input.size || ret != 0) {
+        buffer = grow_buffer(buffer, used, &capacity);
+        ZSTD_outBuffer output = {buffer + used, capacity - used, 0};
+        ret = ZSTD_decompressStream(context, &output, &input);
+        if (ZSTD_isError(ret)) { LOG_E("Corrupted zstd stream: %s", ZSTD_getErrorName(ret)); }
+        used += output.pos;
+        if (output.pos == 0 && input.pos == input.size && ret != 0) { LOG_E("Truncated zstd stream"); }
+    }
+    ZSTD_freeDCtx(context);
+    *out_len = used;
+    return buffer;
+}
+#endif
+
+char *decompress_buffer(const char *data, size_t len, compression_type type, size_t *out_len) {
+    switch (type) {
+    case COMPRESSION_GZIP:
+#ifdef HAVE_ZLIB
+        return gunzip(data, len, out_len);
+#else
+        LOG_E("gzip instances are not supported: build with zlib");
+#endif
+    case COMPRESSION_ZSTD:
+#ifdef HAVE_ZSTD
+        return unzstd(data, len, out_len);
+#else
+        LOG_E("zstd instances are not supported: build with libzstd");
+#endif
+    default:
+        LOG_E("The instance is not compressed");
+    }
+    return NULL;
+}
@@ -0,0 +1,487 @@
+#include "delaunay.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define SUPER_TRIANGLE_SCALE 100.0 // Size of the super triangle with respect to the bounding box of the nodes
+#define BRIO_FIRST_ROUND 16        // Nodes of the first round of the insertion order. Each round doubles the nodes
+#define HILBERT_BITS 16            // Bits of each coordinate on the Hilbert curve of the insertion order
+
+// Triangulation under construction. The vertices of each triangle are in counterclockwise order
+// and the neighbor k of a triangle is the one sharing the edge opposite to vertex k (-1 if none)
+typedef struct {
+    double *x;          // Coordinates of the nodes followed by the 3 vertices of the super triangle
+    double *y;
+    int *v;             // 3 vertices of each triangle
+    int *nb;            // 3 neighbors of each triangle
+    int *mark;          // Insertion in which each triangle was found in the cavity
+    int *link;          // New triangle of the cavity boundary edge starting at each vertex
+    int num_tri;
+    int capacity;
+} triangulation;
+
+// Boundary edge (a, b) of the cavity, seen from the outside triangle
+typedef struct {
+    int a;
+    int b;
+    int outside;
+} cavity_edge;
+
+// Sorting key of a node. The insertion order is a biased randomized insertion order (BRIO): the nodes
+// are shuffled and split in rounds of doubling size, and each round is sorted along a Hilbert curve.
+// Consecutive nodes are close, so the walks are short, and no round follows the rows of a grid, whose
+// long thin triangles would give huge cavities
+typedef struct {
+    int round;
+    uint32_t curve;
+    double x;
+    double y;
+    int idx;
+} insert_key;
+
+static int compare_keys(const void *lhs, const void *rhs) {
+    const insert_key *l = lhs;
+    const insert_key *r = rhs;
+    if (l->round != r->round) { return l->round < r->round ? -1 : 1; }
+    if (l->curve != r->curve) { return l->curve < r->curve ? -1 : 1; }
+    return l->idx - r->idx;
+}
+
+// Order of the convex hull algorithm: by x and then by y
+static int compare_points(const void *lhs, const void *rhs) {
+    const insert_key *l = lhs;
+    const insert_key *r = rhs;
+    if (l->x != r->x) { return l->x < r->x ? -1 : 1; }
+    if (l->y != r->y) { return l->y < r->y ? -1 : 1; }
+    return l->idx - r->idx;
+}
+
+static int compare_ints(const void *lhs, const void *rhs) {
+    return *(const int *) lhs - *(const int *) rhs;
+}
+
+// splitmix64, for a shuffle which is the same at every run
+static inline uint64_t shuffle_random(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Position of the cell (hx, hy) along the Hilbert curve which fills the square of side 2^HILBERT_BITS
+static uint32_t hilbert_index(uint32_t hx, uint32_t hy) {
+    uint32_t side = 1u << HILBERT_BITS;
+    uint32_t d = 0;
+    for (uint32_t s = side / 2; s > 0; s /= 2) {
+        uint32_t rx = (hx & s) > 0;
+        uint32_t ry = (hy & s) > 0;
+        d += s * s * ((3 * rx) ^ ry);
+        if (ry == 0) { // Rotating the quadrant
+            if (rx == 1) {
+                hx = side - 1 - hx;
+                hy = side - 1 - hy;
+            }
+            uint32_t tmp = hx;
+            hx = hy;
+            hy = tmp;
+        }
+    }
+    return d;
+}
+
+// Twice the signed area of the triangle (a, b, c). Positive when counterclockwise
+static inline double orient(const triangulation *tr, int a, int b, int c) {
+    return (tr->x[b] - tr->x[a]) * (tr->y[c] - tr->y[a]) - (tr->y[b] - tr->y[a]) * (tr->x[c] - tr->x[a]);
+}
+
+// Positive when node d is inside the circumcircle of the counterclockwise triangle (a, b, c)
+static inline double incircle(const triangulation *tr, int a, int b, int c, int d) {
+    double adx = tr->x[a] - tr->x[d], ady = tr->y[a] - tr->y[d];
+    double bdx = tr->x[b] - tr->x[d], bdy = tr->y[b] - tr->y[d];
+    double cdx = tr->x[c] - tr->x[d], cdy = tr->y[c] - tr->y[d];
+    return (adx*adx + ady*ady) * (bdx*cdy - cdx*bdy)
+         + (bdx*bdx + bdy*bdy) * (cdx*ady - adx*cdy)
+         + (cdx*cdx + cdy*cdy) * (adx*bdy - bdx*ady);
+}
+
+static int new_triangle(triangulation *tr) {
+    if (tr->num_tri == tr->capacity) {
+        tr->capacity *= 2;
+        tr->v = REALLOC(tr->v, 3 * tr->capacity, int);
+        tr->nb = REALLOC(tr->nb, 3 * tr->capacity, int);
+        tr->mark = REALLOC(tr->mark, tr->capacity, int);
+    }
+    tr->mark[tr->num_tri] = -1;
+    return tr->num_tri++;
+}
+
+// Finds the triangle containing node p walking from triangle t towards p
+static int locate(const triangulation *tr, int t, int p) {
+    long max_steps = 4L * tr->num_tri + 16;
+    for (long step = 0; step < max_steps; step++) {
+        const int *v = &tr->v[3 * t];
+        int next = -1;
+        for (int k = 0; k < 3 && next < 0; k++) {
+            if (orient(tr, v[(k + 1) % 3], v[(k + 2) % 3], p) < 0) { next = tr->nb[3 * t + k]; }
+        }
+        if (next < 0) { return t; }
+        t = next;
+    }
+    // The walk can loop on numerically degenerate triangulations: fall back to a scan
+    for (t = 0; t < tr->num_tri; t++) {
+        const int *v = &tr->v[3 * t];
+        if (tr->mark[t] != -2 && orient(tr, v[0], v[1], p) >= 0 && orient(tr, v[1], v[2], p) >= 0 && orient(tr, v[2], v[0], p) >= 0) { return t; }
+    }
+    return -1;
+}
+
+// Inserts node p in the triangulation. Returns a triangle incident to p, or -1 if p is not inserted
+static int insert_node(triangulation *tr, int p, int start, int *dup_of, int **bad, int *bad_cap, cavity_edge **edges, int *edges_cap) {
+    int t = locate(tr, start, p);
+    if (t < 0) { return -1; }
+    for (int k = 0; k < 3; k++) {
+        int u = tr->v[3 * t + k];
+        if (tr->x[u] == tr->x[p] && tr->y[u] == tr->y[p]) {
+            dup_of[p] = u;
+            return -1;
+        }
+    }
+
+    // Cavity: the triangles whose circumcircle contains p, connected to t
+    int num_bad = 0;
+    (*bad)[num_bad++] = t;
+    tr->mark[t] = p;
+    for (int l = 0; l < num_bad; l++) {
+        int b = (*bad)[l];
+        for (int k = 0; k < 3; k++) {
+            int n = tr->nb[3 * b + k];
+            if (n < 0 || tr->mark[n] == p) { continue; }
+            const int *v = &tr->v[3 * n];
+            if (incircle(tr, v[0], v[1], v[2], p) > 0) {
+                if (num_bad == *bad_cap) {
+                    *bad_cap *= 2;
+                    *bad = REALLOC(*bad, *bad_cap, int);
+                }
+                (*bad)[num_bad++] = n;
+                tr->mark[n] = p;
+            }
+        }
+    }
+
+    // Boundary of the cavity. Rounding errors can leave p not strictly inside the cavity,
+    // in that case the triangle beyond the offending edge is added to the cavity and scanned in turn
+    int num_edges = 0;
+    for (int l = 0; l < num_bad; l++) {
+        int b = (*bad)[l];
+        for (int k = 0; k < 3; k++) {
+            int n = tr->nb[3 * b + k];
+            if (n >= 0 && tr->mark[n] == p) { continue; }
+            int a = tr->v[3 * b + (k + 1) % 3];
+            int c = tr->v[3 * b + (k + 2) % 3];
+            if (orient(tr, a, c, p) <= 0 && n >= 0) {
+                if (num_bad == *bad_cap) {
+                    *bad_cap *= 2;
+                    *bad = REALLOC(*bad, *bad_cap, int);
+                }
+                (*bad)[num_bad++] = n;
+                tr->mark[n] = p;
+                continue;
+            }
+            if (num_edges == *edges_cap) {
+                *edges_cap *= 2;
+                *edges = REALLOC(*edges, *edges_cap, cavity_edge);
+            }
+            (*edges)[num_edges].a = a;
+            (*edges)[num_edges].b = c;
+            (*edges)[num_edges].outside = n;
+            num_edges++;
+        }
+    }
+    // The edges found before the triangle beyond them joined the cavity are inside it
+    int kept = 0;
+    for (int m = 0; m < num_edges; m++) {
+        int n = (*edges)[m].outside;
+        if (n < 0 || tr->mark[n] != p) { (*edges)[kept++] = (*edges)[m]; }
+    }
+    num_edges = kept;
+
+    // One new triangle (a, b, p) for each boundary edge. The slots of the cavity are reused
+    int *created = MALLOC(num_edges, int);
+    for (int m = 0; m < num_edges; m++) {
+        int nt = m < num_bad ? (*bad)[m] : new_triangle(tr);
+        created[m] = nt;
+        cavity_edge e = (*edges)[m];
+        tr->v[3 * nt] = e.a;
+        tr->v[3 * nt + 1] = e.b;
+        tr->v[3 * nt + 2] = p;
+        tr->nb[3 * nt + 2] = e.outside;
+        tr->mark[nt] = -1;
+        if (e.outside >= 0) {
+            for (int k = 0; k < 3; k++) {
+                int u = tr->v[3 * e.outside + k];
+                if (u != e.a && u != e.b) { tr->nb[3 * e.outside + k] = nt; }
+            }
+        }
+    }
+    // The slots of the cavity which are not reused are removed from the triangulation
+    for (int m = num_edges; m < num_bad; m++) {
+        int dead = (*bad)[m];
+        tr->mark[dead] = -2;
+        tr->v[3 * dead] = tr->v[3 * dead + 1] = tr->v[3 * dead + 2] = -1;
+        tr->nb[3 * dead] = tr->nb[3 * dead + 1] = tr->nb[3 * dead + 2] = -1;
+    }
+    // Linking the new triangles around p: the triangle of the boundary edge (a, b) shares the edge (b, p)
+    // with the triangle of the boundary edge starting at b
+    for (int m = 0; m < num_edges; m++) { tr->link[(*edges)[m].a] = created[m]; }
+    for (int m = 0; m < num_edges; m++) {
+        int next = tr->link[(*edges)[m].b];
+        tr->nb[3 * created[m]] = next;    // Edge (b, p)
+        tr->nb[3 * next + 1] = created[m]; // Edge (p, b) of the next triangle
+    }
+    int last = created[0];
+    FREE(created);
+    return last;
+}
+
+// Adds the edges of the convex hull computed with the monotone chain algorithm. The collinear nodes on
+// the hull are kept, so each edge joins two adjacent nodes of the boundary and is a Delaunay edge
+static int hull_edges(const triangulation *tr, const int *sorted, int num_sorted, int *pairs) {
+    int *hull = MALLOC(2 * num_sorted + 1, int);
+    int size = 0;
+    for (int i = 0; i < num_sorted; i++) { // Lower hull
+        while (size >= 2 && orient(tr, hull[size - 2], hull[size - 1], sorted[i]) < 0) { size--; }
+        hull[size++] = sorted[i];
+    }
+    int lower = size + 1;
+    for (int i = num_sorted - 2; i >= 0; i--) { // Upper hull
+        while (size >= lower && orient(tr, hull[size - 2], hull[size - 1], sorted[i]) < 0) { size--; }
+        hull[size++] = sorted[i];
+    }
+    int num_pairs = 0;
+    // With collinear nodes the hull is a segment, whose inner edges are already in the triangulation
+    if (size <= 3) { size = 0; }
+    for (int i = 0; i + 1 < size; i++) {
+        if (hull[i] == hull[i + 1]) { continue; }
+        pairs[2 * num_pairs] = hull[i];
+        pairs[2 * num_pairs + 1] = hull[i + 1];
+        num_pairs++;
+    }
+    FREE(hull);
+    return num_pairs;
+}
+
+// Stores the undirected edges in the graph in compressed form, removing the repeated ones
+static void fill_graph(sparse_graph *graph, int num_nodes, const int *pairs, long num_pairs) {
+    int *degree = CALLOC(num_nodes + 1, int);
+    for (long e = 0; e < num_pairs; e++) {
+        degree[pairs[2 * e]]++;
+        degree[pairs[2 * e + 1]]++;
+    }
+    int *start = MALLOC(num_nodes + 1, int);
+    start[0] = 0;
+    for (int i = 0; i < num_nodes; i++) { start[i + 1] = start[i] + degree[i]; }
+    int *adj = MALLOC(start[num_nodes] > 0 ? start[num_nodes] : 1, int);
+    MEMSET(degree, 0, num_nodes, int);
+    for (long e = 0; e < num_pairs; e++) {
+        int a = pairs[2 * e], b = pairs[2 * e + 1];
+        adj[start[a] + degree[a]++] = b;
+        adj[start[b] + degree[b]++] = a;
+    }
+    // Sorting and compacting each adjacency list
+    long size = 0;
+    for (int i = 0; i < num_nodes; i++) {
+        int begin = start[i];
+        int end = start[i + 1];
+        qsort(adj + begin, end - begin, sizeof(int), compare_ints);
+        start[i] = size;
+        for (int l = begin; l < end; l++) {
+            if (l > begin && adj[l] == adj[l - 1]) { continue; }
+            adj[size++] = adj[l];
+        }
+    }
+    start[num_nodes] = size;
+    graph->start = start;
+    graph->adj = REALLOC(adj, size > 0 ? size : 1, int);
+    graph->num_edges = size / 2;
+    FREE(degree);
+}
+
+int build_delaunay(instance *inst) {
+    inst->delaunay.start = NULL;
+    inst->delaunay.adj = NULL;
+    inst->delaunay.num_edges = 0;
+    if (inst->weight_type == GEO || inst->weight_type == EXPLICIT || inst->num_nodes < 2) { return 0; }
+
+    struct timeval start, end;
+    gettimeofday(&start, 0);
+    int n = inst->num_nodes;
+
+    triangulation tr;
+    tr.x = MALLOC(n + 3, double);
+    tr.y = MALLOC(n + 3, double);
+    double min_x = DBL_MAX, max_x = -DBL_MAX, min_y = DBL_MAX, max_y = -DBL_MAX;
+    for (int i = 0; i < n; i++) {
+        tr.x[i] = inst->nodes[i].x;
+        tr.y[i] = inst->nodes[i].y;
+        min_x = dmin(min_x, tr.x[i]);
+        max_x = dmax(max_x, tr.x[i]);
+        min_y = dmin(min_y, tr.y[i]);
+        max_y = dmax(max_y, tr.y[i]);
+    }
+    double range = dmax(dmax(max_x - min_x, max_y - min_y), 1.0);
+    double cx = (min_x + max_x) / 2;
+    double cy = (min_y + max_y) / 2;
+    double d = SUPER_TRIANGLE_SCALE * range;
+    tr.x[n] = cx - 2 * d; tr.y[n] = cy - d;
+    tr.x[n + 1] = cx + 2 * d; tr.y[n + 1] = cy - d;
+    tr.x[n + 2] = cx; tr.y[n + 2] = cy + 2 * d;
+
+    tr.capacity = 2 * n + 16;
+    tr.num_tri = 0;
+    tr.v = MALLOC(3 * tr.capacity, int);
+    tr.nb = MALLOC(3 * tr.capacity, int);
+    tr.mark = MALLOC(tr.capacity, int);
+    tr.link = MALLOC(n + 3, int);
+    int t0 = new_triangle(&tr);
+    tr.v[0] = n; tr.v[1] = n + 1; tr.v[2] = n + 2;
+    tr.nb[0] = tr.nb[1] = tr.nb[2] = -1;
+
+    // Biased randomized insertion order
+    insert_key *keys = MALLOC(n, insert_key);
+    double cell = ((1u << HILBERT_BITS) - 1) / range;
+    for (int i = 0; i < n; i++) {
+        keys[i].x = tr.x[i];
+        keys[i].y = tr.y[i];
+        keys[i].idx = i;
+        keys[i].curve = hilbert_index((uint32_t) ((tr.x[i] - min_x) * cell), (uint32_t) ((tr.y[i] - min_y) * cell));
+    }
+    uint64_t state = n;
+    for (int i = n - 1; i > 0; i--) {
+        int r = (int) (shuffle_random(&state) % (uint64_t) (i + 1));
+        insert_key tmp = keys[i];
+        keys[i] = keys[r];
+        keys[r] = tmp;
+    }
+    for (int i = 0, round = 0, size = BRIO_FIRST_ROUND; i < n; i++) {
+        if (i == size) {
+            round++;
+            size *= 2;
+        }
+        keys[i].round = round;
+    }
+    qsort(keys, n, sizeof(insert_key), compare_keys);
+
+    int *dup_of = MALLOC(n, int);
+    MEMSET(dup_of, -1, n, int);
+    int bad_cap = 64, edges_cap = 64;
+    int *bad = MALLOC(bad_cap, int);
+    cavity_edge *edges = MALLOC(edges_cap, cavity_edge);
+    int last = t0;
+    for (int l = 0; l < n; l++) {
+        int t = insert_node(&tr, keys[l].idx, last, dup_of, &bad, &bad_cap, &edges, &edges_cap);
+        if (t >= 0) { last = t; }
+    }
+    FREE(bad);
+    FREE(edges);
+
+    // Collecting the edges between real nodes. Each one is shared by two triangles with opposite directions
+    long max_pairs = 3L * tr.num_tri + 2L * n + 16;
+    int *pairs = MALLOC(2 * max_pairs, int);
+    long num_pairs = 0;
+    for (int t = 0; t < tr.num_tri; t++) {
+        if (tr.mark[t] == -2) { continue; }
+        for (int k = 0; k < 3; k++) {
+            int a = tr.v[3 * t + k];
+            int b = tr.v[3 * t + (k + 1) % 3];
+            if (a < b && b < n) {
+                pairs[2 * num_pairs] = a;
+                pairs[2 * num_pairs + 1] = b;
+                num_pairs++;
+            }
+        }
+    }
+    // The super triangle is finite, so some edges of the convex hull may be missing
+    qsort(keys, n, sizeof(insert_key), compare_points);
+    int *sorted = MALLOC(n, int);
+    int num_sorted = 0;
+    for (int l = 0; l < n; l++) {
+        if (dup_of[keys[l].idx] < 0) { sorted[num_sorted++] = keys[l].idx; }
+    }
+    num_pairs += hull_edges(&tr, sorted, num_sorted, pairs + 2 * num_pairs);
+    FREE(sorted);
+    FREE(keys);
+    for (int i = 0; i < n; i++) { // Nodes with the same coordinates are connected
+        if (dup_of[i] < 0) { continue; }
+        pairs[2 * num_pairs] = i;
+        pairs[2 * num_pairs + 1] = dup_of[i];
+        num_pairs++;
+    }
+
+    fill_graph(&inst->delaunay, n, pairs, num_pairs);
+    FREE(pairs);
+
+    // Duplicated nodes take the neighbors of their twin too
+    int num_dups = 0;
+    for (int i = 0; i < n; i++) { num_dups += dup_of[i] >= 0; }
+    if (num_dups > 0) {
+        sparse_graph *g = &inst->delaunay;
+        long extra = 0;
+        for (int i = 0; i < n; i++) {
+            if (dup_of[i] >= 0) { extra += g->start[dup_of[i] + 1] - g->start[dup_of[i]]; }
+        }
+        long size = g->start[n] / 2 + extra;
+        pairs = MALLOC(2 * size, int);
+        num_pairs = 0;
+        for (int i = 0; i < n; i++) {
+            for (int l = g->start[i]; l < g->start[i + 1]; l++) {
+                if (i < g->adj[l]) {
+                    pairs[2 * num_pairs] = i;
+                    pairs[2 * num_pairs + 1] = g->adj[l];
+                    num_pairs++;
+                }
+            }
+            if (dup_of[i] < 0) { continue; }
+            int twin = dup_of[i];
+            for (int l = g->start[twin]; l < g->start[twin + 1]; l++) {
+                if (g->adj[l] == i) { continue; }
+                pairs[2 * num_pairs] = i;
+                pairs[2 * num_pairs + 1] = g->adj[l];
+                num_pairs++;
+            }
+        }
+        FREE(g->start);
+        FREE(g->adj);
+        fill_graph(g, n, pairs, num_pairs);
+        FREE(pairs);
+    }
+
+    FREE(dup_of);
+    FREE(tr.x);
+    FREE(tr.y);
+    FREE(tr.v);
+    FREE(tr.nb);
+    FREE(tr.mark);
+    FREE(tr.link);
+
+    gettimeofday(&end, 0);
+    if (inst->params.verbose >= 3) {
+        LOG_I("Delaunay graph built: %ld edges in %0.3f seconds", inst->delaunay.num_edges, get_elapsed_time(start, end));
+    }
+    return 1;
+}
+
+bool sparse_graph_has_edge(const sparse_graph *graph, int i, int j) {
+    if (graph->start == NULL) { return false; }
+    // The adjacency lists are sorted
+    int lo = graph->start[i];
+    int hi = graph->start[i + 1] - 1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (graph->adj[mid] == j) { return true; }
+        if (graph->adj[mid] < j) { lo = mid + 1; }
+        else { hi = mid - 1; }
+    }
+    return false;
+}
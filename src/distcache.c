@@ -0,0 +1,131 @@
+#include "distcache.h"
+
+#include "distutil.h"
+#include "distkernels.h"
+
+#include <stdlib.h>
+
+// Computes the row of the node in the slot, evicting with the CLOCK policy the first row not referenced since the last sweep
+static int load_row(instance *inst, int node) {
+    dist_cache *cache = &inst->cache;
+    while (cache->owner[cache->hand] >= 0 && cache->ref[cache->hand]) {
+        cache->ref[cache->hand] = 0;
+        cache->hand = (cache->hand + 1) % cache->num_slots;
+    }
+    int slot = cache->hand;
+    cache->hand = (cache->hand + 1) % cache->num_slots;
+    if (cache->owner[slot] >= 0) { cache->slot_of[cache->owner[slot]] = -1; }
+
+    int n = inst->num_nodes;
+    double *row = cache->integer ? MALLOC(n, double) : (double *) cache->rows + (long) slot * n;
+    if (inst->xcoord != NULL && inst->weight_type != GEO) {
+        dist_row(inst, node, 0, n, row);
+    } else {
+        for (int j = 0; j < n; j++) { row[j] = cache->base(node, j, inst); }
+    }
+    if (cache->integer) {
+        int *dst = (int *) cache->rows + (long) slot * n;
+        for (int j = 0; j < n; j++) { dst[j] = (int) row[j]; }
+        FREE(row);
+    }
+
+    cache->owner[slot] = node;
+    cache->slot_of[node] = slot;
+    cache->ref[slot] = 1;
+    cache->loads++;
+    return slot;
+}
+
+static inline double row_entry(const instance *inst, int slot, int j) {
+    long pos = (long) slot * inst->num_nodes + j;
+    return inst->cache.integer ? ((int *) inst->cache.rows)[pos] : ((double *) inst->cache.rows)[pos];
+}
+
+static double cached_dist(int i, int j, instance *inst) {
+    dist_cache *cache = &inst->cache;
+    int slot = cache->slot_of[i];
+    if (slot >= 0) {
+        cache->ref[slot] = 1;
+        cache->hits++;
+        return row_entry(inst, slot, j);
+    }
+    slot = cache->slot_of[j];
+    if (slot >= 0) {
+        cache->ref[slot] = 1;
+        cache->hits++;
+        return row_entry(inst, slot, i);
+    }
+
+    // The row of node i is loaded only when it is missed many times in a short period, otherwise
+    // the nodes visited once (e.g. the ones of the 2-opt inner loop) would evict the useful rows
+    cache->misses++;
+    if (--cache->epoch_left <= 0) {
+        cache->epoch++;
+        cache->epoch_left = inst->num_nodes;
+    }
+    if (cache->miss_epoch[i] != cache->epoch) {
+        cache->miss_epoch[i] = cache->epoch;
+        cache->miss_count[i] = 0;
+    }
+    if (++cache->miss_count[i] >= DIST_CACHE_ADMIT) {
+        slot = load_row(inst, i);
+        return row_entry(inst, slot, j);
+    }
+    return cache->base(i, j, inst);
+}
+
+int build_dist_cache(instance *inst) {
+    dist_cache *cache = &inst->cache;
+    cache->rows = NULL;
+    cache->hits = cache->misses = cache->loads = 0;
+    long mem_limit = inst->params.dist_cache_mem;
+    if (mem_limit < 0) {
+        // The other metrics are computed faster than a row entry is read from memory
+        mem_limit = inst->weight_type == ATT || inst->weight_type == GEO ? DEFAULT_DIST_CACHE_MEM : 0;
+    }
+    if (inst->dist.data != NULL || mem_limit <= 0 || inst->num_nodes < 2) { return 0; }
+
+    int n = inst->num_nodes;
+    // Integer costs are stored as int32 as in the distance matrix
+    cache->integer = has_integer_costs(inst);
+    size_t row_bytes = (size_t) n * (cache->integer ? sizeof(int) : sizeof(double));
+    long num_slots = (long) ((double) mem_limit * 1024 * 1024 / row_bytes);
+    if (num_slots > n) { num_slots = n; }
+    if (num_slots < 2) {
+        if (inst->params.verbose >= 3) { LOG_I("Distance cache not built: a row needs %0.1f MB", row_bytes / (1024.0 * 1024.0)); }
+        return 0;
+    }
+
+    void *rows = NULL;
+    if (posix_memalign(&rows, DIST_MATRIX_ALIGNMENT, num_slots * row_bytes) != 0) {
+        if (inst->params.verbose >= 3) { LOG_I("Distance cache not built: unable to allocate %ld rows", num_slots); }
+        return 0;
+    }
+    cache->rows = rows;
+    cache->num_slots = (int) num_slots;
+    cache->slot_of = MALLOC(n, int);
+    cache->owner = MALLOC(num_slots, int);
+    cache->ref = CALLOC(num_slots, unsigned char);
+    cache->miss_count = CALLOC(n, int);
+    cache->miss_epoch = CALLOC(n, int);
+    MEMSET(cache->slot_of, -1, n, int);
+    MEMSET(cache->owner, -1, num_slots, int);
+    cache->hand = 0;
+    cache->epoch = 0;
+    cache->epoch_left = n;
+
+    cache->base = get_dist_func(inst);
+    inst->dist_fn = cached_dist;
+    if (inst->params.verbose >= 3) {
+        LOG_I("Distance cache built: %d rows, %0.1f MB", cache->num_slots, num_slots * row_bytes / (1024.0 * 1024.0));
+    }
+    return 1;
+}
+
+void dist_cache_report(instance *inst) {
+    dist_cache *cache = &inst->cache;
+    if (cache->rows == NULL || inst->params.verbose < 3) { return; }
+    long total = cache->hits + cache->misses;
+    LOG_I("Distance cache: %ld hits, %ld misses (%0.1f%% hit rate), %ld rows loaded", cache->hits, cache->misses,
+          total > 0 ? 100.0 * cache->hits / total : 0.0, cache->loads);
+}
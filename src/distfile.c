@@ -0,0 +1,221 @@
+#include "distfile.h"
+
+#include "distutil.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Header of the distance file. The entries start at DIST_MATRIX_ALIGNMENT bytes from the beginning of the file
+typedef struct {
+    char magic[8];          // DIST_FILE_MAGIC, without the terminating null character
+    int num_nodes;
+    int type;               // The dist_matrix_type of the entries
+    int format;             // The edge_weight_format of the instance file
+    int reserved;
+    long size;              // The number of entries
+    long source_size;       // The size of the instance file when the distance file was written
+    long source_mtime;      // The modification time in nanoseconds of the instance file when the distance file was written
+    long section_end;       // The offset in the instance file after the last weight
+} dist_file_header;
+
+_Static_assert(sizeof(dist_file_header) <= DIST_MATRIX_ALIGNMENT, "The header must fit before the aligned entries");
+
+static inline long mtime_ns(const struct stat *st) {
+    return (long) st->st_mtim.tv_sec * 1000000000L + st->st_mtim.tv_nsec;
+}
+
+// Position of the edge (i, j), with i < j, in the packed upper triangular matrix. The same of dist_pos in distutil.c
+static inline long packed_pos(int i, int j, int num_nodes) {
+    return (long) i * num_nodes + j - ((long) (i + 1) * (i + 2)) / 2;
+}
+
+// The columns [first, last) of row i listed in the weight section
+static void row_range(edge_weight_format format, int i, int num_nodes, int *first, int *last) {
+    switch (format) {
+    case FULL_MATRIX:    *first = 0;     *last = num_nodes; break;
+    case UPPER_ROW:      *first = i + 1; *last = num_nodes; break;
+    case UPPER_DIAG_ROW: *first = i;     *last = num_nodes; break;
+    case LOWER_ROW:      *first = 0;     *last = i;         break;
+    default:             *first = 0;     *last = i + 1;     break; // LOWER_DIAG_ROW
+    }
+}
+
+static char *dist_file_path(const instance *inst) {
+    size_t len = strlen(inst->params.file_path) + strlen(DIST_FILE_EXT) + 1;
+    char *path = CALLOC(len, char);
+    snprintf(path, len, "%s%s", inst->params.file_path, DIST_FILE_EXT);
+    return path;
+}
+
+// Maps the distance file if it matches the instance. Returns the offset after the weight section, -1 if it is not mapped
+static long map_dist_file(instance *inst, const char *path, dist_matrix_type type, const struct stat *source) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) { return -1; }
+    dist_file_header header;
+    long size = (long) inst->num_nodes * (inst->num_nodes - 1) / 2;
+    size_t elem_size = type == DIST_MATRIX_INT ? sizeof(int) : sizeof(double);
+    size_t map_size = DIST_MATRIX_ALIGNMENT + (size_t) size * elem_size;
+    struct stat st;
+    int valid = read(fd, &header, sizeof(header)) == sizeof(header) && fstat(fd, &st) == 0 &&
+                memcmp(header.magic, DIST_FILE_MAGIC, sizeof(header.magic)) == 0 &&
+                header.num_nodes == inst->num_nodes && header.type == (int) type &&
+                header.format == (int) inst->weight_format && header.size == size &&
+                header.source_size == (long) source->st_size && header.source_mtime == mtime_ns(source) &&
+                (size_t) st.st_size == map_size;
+    void *map = valid ? mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd); // The mapping stays valid after closing the file
+    if (map == MAP_FAILED) { return -1; }
+
+    inst->dist.map = map;
+    inst->dist.map_size = map_size;
+    inst->dist.data = (char *) map + DIST_MATRIX_ALIGNMENT;
+    inst->dist.type = type;
+    inst->dist.size = size;
+    return header.section_end;
+}
+
+// Writes the matrix in the distance file. Returns 1 on success, 0 otherwise
+static int write_dist_file(const instance *inst, const char *path, const struct stat *source, long section_end) {
+    dist_file_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, DIST_FILE_MAGIC, sizeof(header.magic));
+    header.num_nodes = inst->num_nodes;
+    header.type = inst->dist.type;
+    header.format = inst->weight_format;
+    header.size = inst->dist.size;
+    header.source_size = (long) source->st_size;
+    header.source_mtime = mtime_ns(source);
+    header.section_end = section_end;
+    char padding[DIST_MATRIX_ALIGNMENT];
+    memset(padding, 0, sizeof(padding));
+    memcpy(padding, &header, sizeof(header));
+
+    // Written to a temporary file and renamed: the file may be mapped by another run, which would get
+    // SIGBUS if it were truncated, and the runs started at the same time never map a partial file
+    size_t tmp_len = strlen(path) + 32;
+    char *tmp_path = CALLOC(tmp_len, char);
+    snprintf(tmp_path, tmp_len, "%s.%ld", path, (long) getpid());
+    FILE *fp = fopen(tmp_path, "wb");
+    int ok = fp != NULL;
+    if (ok) {
+        size_t elem_size = inst->dist.type == DIST_MATRIX_INT ? sizeof(int) : sizeof(double);
+        ok = fwrite(padding, 1, sizeof(padding), fp) == sizeof(padding) &&
+             fwrite(inst->dist.data, elem_size, inst->dist.size, fp) == (size_t) inst->dist.size;
+        ok = fclose(fp) == 0 && ok;
+        ok = ok && rename(tmp_path, path) == 0;
+        if (!ok) { remove(tmp_path); }
+    }
+    FREE(tmp_path);
+    return ok;
+}
+
+// Reads the weights in a matrix allocated in memory
+static void read_weights(instance *inst, tsplib_reader *reader, dist_matrix_type type) {
+    int n = inst->num_nodes;
+    long size = (long) n * (n - 1) / 2;
+    size_t elem_size = type == DIST_MATRIX_INT ? sizeof(int) : sizeof(double);
+    void *data = NULL;
+    if (posix_memalign(&data, DIST_MATRIX_ALIGNMENT, size > 0 ? size * elem_size : elem_size) != 0) {
+        LOG_E("Unable to allocate the explicit distance matrix: %0.1f MB", size * elem_size / (1024.0 * 1024.0));
+    }
+
+    for (int i = 0; i < n; i++) {
+        int first, last;
+        row_range(inst->weight_format, i, n, &first, &last);
+        for (int j = first; j < last; j++) {
+            double weight;
+            if (!tsplib_read_number(reader, &weight)) { LOG_E("Missing weights in EDGE_WEIGHT_SECTION: row %d, column %d", i + 1, j + 1); }
+            if (i == j) { continue; } // The diagonal is not stored
+            long pos = i < j ? packed_pos(i, j, n) : packed_pos(j, i, n);
+            if (type == DIST_MATRIX_INT) {
+                double rounded = floor(weight + 0.5);
+                if (rounded > INT_MAX || rounded < INT_MIN) { LOG_E("The weight %f doesn't fit an integer cost", weight); }
+                weight = rounded;
+            }
+            // The lower triangle of the full matrix must repeat the upper one, which is already stored
+            if (inst->weight_format == FULL_MATRIX && i > j) {
+                double upper = type == DIST_MATRIX_INT ? ((int *) data)[pos] : ((double *) data)[pos];
+                if (weight != upper) {
+                    LOG_E("The FULL_MATRIX is not symmetric: the weight of row %d, column %d is %g but the one of row %d, column %d is %g. "
+                          "Only symmetric instances are supported", i + 1, j + 1, weight, j + 1, i + 1, upper);
+                }
+                continue;
+            }
+            if (type == DIST_MATRIX_INT) {
+                ((int *) data)[pos] = (int) weight;
+            } else {
+                ((double *) data)[pos] = weight;
+            }
+        }
+    }
+
+    inst->dist.data = data;
+    inst->dist.type = type;
+    inst->dist.size = size;
+    inst->dist.map = NULL;
+    inst->dist.map_size = 0;
+}
+
+void load_edge_weights(instance *inst, tsplib_reader *reader, const struct stat *source) {
+    if (inst->num_nodes <= 0) { LOG_E("DIMENSION must be given before EDGE_WEIGHT_SECTION"); }
+    if ((int) inst->weight_format < 0) { LOG_E("Missing or unsupported EDGE_WEIGHT_FORMAT"); }
+
+    struct timeval start, end;
+    gettimeofday(&start, 0);
+    dist_matrix_type type = has_integer_costs(inst) ? DIST_MATRIX_INT : DIST_MATRIX_DOUBLE;
+    char *path = dist_file_path(inst);
+
+    long section_end = map_dist_file(inst, path, type, source);
+    if (section_end >= 0) {
+        if (section_end > reader->end - reader->begin) { LOG_E("Unable to skip the EDGE_WEIGHT_SECTION"); }
+        reader->cur = reader->begin + section_end;
+        gettimeofday(&end, 0);
+        if (inst->params.verbose >= 3) { LOG_I("Distance file %s mapped in %0.3f seconds", path, get_elapsed_time(start, end)); }
+        FREE(path);
+        return;
+    }
+
+    read_weights(inst, reader, type);
+    section_end = reader->cur - reader->begin;
+    // The matrix is mapped from the file just written, so this run and the next ones read the same data
+    if (write_dist_file(inst, path, source, section_end)) {
+        dist_matrix matrix = inst->dist;
+        if (map_dist_file(inst, path, type, source) >= 0) {
+            free(matrix.data);
+        } else {
+            inst->dist = matrix;
+        }
+    } else if (inst->params.verbose >= 3) {
+        LOG_I("Unable to write the distance file %s: the weights are kept in memory", path);
+    }
+    gettimeofday(&end, 0);
+    if (inst->params.verbose >= 3) {
+        LOG_I("Explicit weights parsed: %ld %s entries in %0.3f seconds", inst->dist.size,
+              type == DIST_MATRIX_INT ? "int" : "double", get_elapsed_time(start, end));
+    }
+    FREE(path);
+}
+
+int map_edge_weights(instance *inst, const struct stat *source) {
+    dist_matrix_type type = has_integer_costs(inst) ? DIST_MATRIX_INT : DIST_MATRIX_DOUBLE;
+    char *path = dist_file_path(inst);
+    int mapped = map_dist_file(inst, path, type, source) >= 0;
+    FREE(path);
+    return mapped;
+}
+
+void free_dist_matrix(instance *inst) {
+    if (inst->dist.map != NULL) {
+        munmap(inst->dist.map, inst->dist.map_size);
+    } else {
+        free(inst->dist.data);
+    }
+    inst->dist.data = NULL;
+    inst->dist.map = NULL;
+    inst->dist.map_size = 0;
+}
@@ -0,0 +1,386 @@
+#include "distkernels.h"
+
+#include "distutil.h"
+
+#include <float.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define DIST_KERNELS_X86
+#endif
+
+// Computes the distances from (x0, y0) to the n points (xs[k], ys[k]) storing them in out[k]
+typedef void (*row_kernel)(const double *xs, const double *ys, double x0, double y0, int n, weight_type type, int integer, double *out);
+
+// The two nearest nodes found so far. Nodes are ordered by distance and then by index
+typedef struct {
+    double d1;  // Distance of the nearest node
+    double d2;  // Distance of the second nearest node
+    int i1;     // Index of the nearest node. -1 if not found
+    int i2;     // Index of the second nearest node. -1 if not found
+} nearest_pair;
+
+// Updates the two nearest nodes of dists[k], k in [0, n), whose skip[k] is 0. The index of dists[k] is base + k.
+// Skipped nodes and nodes with distance DBL_MAX are ignored
+typedef void (*nearest_reducer)(const double *dists, const int *skip, int base, int n, nearest_pair *pair);
+
+static inline void nearest_insert(nearest_pair *pair, double d, int idx) {
+    if (idx < 0 || d >= DBL_MAX) { return; }
+    if (d < pair->d1 || (d == pair->d1 && idx < pair->i1)) {
+        pair->d2 = pair->d1;
+        pair->i2 = pair->i1;
+        pair->d1 = d;
+        pair->i1 = idx;
+    } else if (d < pair->d2 || (d == pair->d2 && idx < pair->i2)) {
+        pair->d2 = d;
+        pair->i2 = idx;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////
+///////////////// SCALAR KERNEL /////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////
+
+static double scalar_dist(weight_type type, double x0, double y0, double x, double y, int integer) {
+    node p1 = {x0, y0, 0, false};
+    node p2 = {x, y, 0, false};
+    switch (type) {
+    case ATT:
+        return calc_pseudo_euc(p1, p2, integer);
+    case MAN_2D:
+        return calc_man2d(p1, p2, integer);
+    case MAX_2D:
+        return calc_max2d(p1, p2, integer);
+    case CEIL_2D:
+        return calc_ceil2d(p1, p2);
+    default:
+        return calc_euc2d(p1, p2, integer);
+    }
+}
+
+static void row_kernel_scalar(const double *xs, const double *ys, double x0, double y0, int n, weight_type type, int integer, double *out) {
+    for (int k = 0; k < n; k++) {
+        out[k] = scalar_dist(type, x0, y0, xs[k], ys[k], integer);
+    }
+}
+
+static void nearest_reducer_scalar(const double *dists, const int *skip, int base, int n, nearest_pair *pair) {
+    for (int k = 0; k < n; k++) {
+        if (skip && skip[k]) { continue; }
+        nearest_insert(pair, dists[k], base + k);
+    }
+}
+
+#ifdef DIST_KERNELS_X86
+
+/////////////////////////////////////////////////////////////////////////
+///////////////// AVX2 KERNEL ///////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////
+
+// All the roundings of the scalar functions are done on non negative numbers, so
+// the cast to long used by nint is the same of a truncation
+
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+AVX2_TARGET static inline __m256d avx2_nint(__m256d x) {
+    return _mm256_round_pd(_mm256_add_pd(x, _mm256_set1_pd(0.5)), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+}
+
+AVX2_TARGET static inline __m256d avx2_abs(__m256d x) {
+    return _mm256_andnot_pd(_mm256_set1_pd(-0.0), x);
+}
+
+AVX2_TARGET static inline __m256d avx2_euc(__m256d dx, __m256d dy, int integer) {
+    __m256d dist = _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)));
+    return integer ? avx2_nint(dist) : dist;
+}
+
+AVX2_TARGET static inline __m256d avx2_att(__m256d dx, __m256d dy, int integer) {
+    __m256d r = _mm256_sqrt_pd(_mm256_div_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)), _mm256_set1_pd(10.0)));
+    if (!integer) { return r; }
+    __m256d t = avx2_nint(r);
+    __m256d lower = _mm256_cmp_pd(t, r, _CMP_LT_OQ); // t < r ? t + 1 : t
+    return _mm256_add_pd(t, _mm256_and_pd(lower, _mm256_set1_pd(1.0)));
+}
+
+AVX2_TARGET static inline __m256d avx2_ceil(__m256d dx, __m256d dy, int integer) {
+    return _mm256_ceil_pd(avx2_euc(dx, dy, 0));
+}
+
+AVX2_TARGET static inline __m256d avx2_man(__m256d dx, __m256d dy, int integer) {
+    __m256d dist = _mm256_add_pd(avx2_abs(dx), avx2_abs(dy));
+    return integer ? avx2_nint(dist) : dist;
+}
+
+AVX2_TARGET static inline __m256d avx2_max(__m256d dx, __m256d dy, int integer) {
+    dx = avx2_abs(dx);
+    dy = avx2_abs(dy);
+    if (integer) {
+        dx = avx2_nint(dx);
+        dy = avx2_nint(dy);
+    }
+    return _mm256_max_pd(dx, dy);
+}
+
+#define AVX2_ROW_LOOP(metric)                                       \
+    for (; k + 4 <= n; k += 4) {                                    \
+        __m256d dx = _mm256_sub_pd(vx0, _mm256_loadu_pd(xs + k));   \
+        __m256d dy = _mm256_sub_pd(vy0, _mm256_loadu_pd(ys + k));   \
+        _mm256_storeu_pd(out + k, metric(dx, dy, integer));         \
+    }
+
+AVX2_TARGET static void row_kernel_avx2(const double *xs, const double *ys, double x0, double y0, int n, weight_type type, int integer, double *out) {
+    const __m256d vx0 = _mm256_set1_pd(x0);
+    const __m256d vy0 = _mm256_set1_pd(y0);
+    int k = 0;
+    switch (type) {
+    case ATT:
+        AVX2_ROW_LOOP(avx2_att);
+        break;
+    case MAN_2D:
+        AVX2_ROW_LOOP(avx2_man);
+        break;
+    case MAX_2D:
+        AVX2_ROW_LOOP(avx2_max);
+        break;
+    case CEIL_2D:
+        AVX2_ROW_LOOP(avx2_ceil);
+        break;
+    default:
+        AVX2_ROW_LOOP(avx2_euc);
+        break;
+    }
+    // Remaining points
+    row_kernel_scalar(xs + k, ys + k, x0, y0, n - k, type, integer, out + k);
+}
+
+// Each lane keeps its own two nearest nodes, which are merged at the end
+AVX2_TARGET static void nearest_reducer_avx2(const double *dists, const int *skip, int base, int n, nearest_pair *pair) {
+    const __m256d inf = _mm256_set1_pd(DBL_MAX);
+    __m256d d1 = inf, d2 = inf;
+    __m256d i1 = _mm256_set1_pd(-1.0), i2 = i1;
+    __m256d idx = _mm256_setr_pd(base, base + 1, base + 2, base + 3);
+    const __m256d step = _mm256_set1_pd(4.0);
+    int k = 0;
+    for (; k + 4 <= n; k += 4) {
+        __m256d d = _mm256_loadu_pd(dists + k);
+        if (skip) {
+            __m128i flags = _mm_loadu_si128((const __m128i *) (skip + k));
+            __m256d keep = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm_cmpeq_epi32(flags, _mm_setzero_si128())));
+            d = _mm256_blendv_pd(inf, d, keep);
+        }
+        __m256d lt1 = _mm256_cmp_pd(d, d1, _CMP_LT_OQ);
+        __m256d lt2 = _mm256_cmp_pd(d, d2, _CMP_LT_OQ);
+        d2 = _mm256_blendv_pd(_mm256_blendv_pd(d2, d, lt2), d1, lt1);
+        i2 = _mm256_blendv_pd(_mm256_blendv_pd(i2, idx, lt2), i1, lt1);
+        d1 = _mm256_blendv_pd(d1, d, lt1);
+        i1 = _mm256_blendv_pd(i1, idx, lt1);
+        idx = _mm256_add_pd(idx, step);
+    }
+    double ld1[4], ld2[4], li1[4], li2[4];
+    _mm256_storeu_pd(ld1, d1);
+    _mm256_storeu_pd(ld2, d2);
+    _mm256_storeu_pd(li1, i1);
+    _mm256_storeu_pd(li2, i2);
+    for (int l = 0; l < 4; l++) {
+        nearest_insert(pair, ld1[l], (int) li1[l]);
+        nearest_insert(pair, ld2[l], (int) li2[l]);
+    }
+    nearest_reducer_scalar(dists + k, skip ? skip + k : NULL, base + k, n - k, pair);
+}
+
+/////////////////////////////////////////////////////////////////////////
+///////////////// SSE4.1 KERNEL /////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////
+
+#define SSE41_TARGET __attribute__((target("sse4.1")))
+
+SSE41_TARGET static inline __m128d sse41_nint(__m128d x) {
+    return _mm_round_pd(_mm_add_pd(x, _mm_set1_pd(0.5)), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+}
+
+SSE41_TARGET static inline __m128d sse41_abs(__m128d x) {
+    return _mm_andnot_pd(_mm_set1_pd(-0.0), x);
+}
+
+SSE41_TARGET static inline __m128d sse41_euc(__m128d dx, __m128d dy, int integer) {
+    __m128d dist = _mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)));
+    return integer ? sse41_nint(dist) : dist;
+}
+
+SSE41_TARGET static inline __m128d sse41_att(__m128d dx, __m128d dy, int integer) {
+    __m128d r = _mm_sqrt_pd(_mm_div_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)), _mm_set1_pd(10.0)));
+    if (!integer) { return r; }
+    __m128d t = sse41_nint(r);
+    __m128d lower = _mm_cmplt_pd(t, r); // t < r ? t + 1 : t
+    return _mm_add_pd(t, _mm_and_pd(lower, _mm_set1_pd(1.0)));
+}
+
+SSE41_TARGET static inline __m128d sse41_ceil(__m128d dx, __m128d dy, int integer) {
+    return _mm_ceil_pd(sse41_euc(dx, dy, 0));
+}
+
+SSE41_TARGET static inline __m128d sse41_man(__m128d dx, __m128d dy, int integer) {
+    __m128d dist = _mm_add_pd(sse41_abs(dx), sse41_abs(dy));
+    return integer ? sse41_nint(dist) : dist;
+}
+
+SSE41_TARGET static inline __m128d sse41_max(__m128d dx, __m128d dy, int integer) {
+    dx = sse41_abs(dx);
+    dy = sse41_abs(dy);
+    if (integer) {
+        dx = sse41_nint(dx);
+        dy = sse41_nint(dy);
+    }
+    return _mm_max_pd(dx, dy);
+}
+
+#define SSE41_ROW_LOOP(metric)                                  \
+    for (; k + 2 <= n; k += 2) {                                \
+        __m128d dx = _mm_sub_pd(vx0, _mm_loadu_pd(xs + k));     \
+        __m128d dy = _mm_sub_pd(vy0, _mm_loadu_pd(ys + k));     \
+        _mm_storeu_pd(out + k, metric(dx, dy, integer));        \
+    }
+
+SSE41_TARGET static void row_kernel_sse41(const double *xs, const double *ys, double x0, double y0, int n, weight_type type, int integer, double *out) {
+    const __m128d vx0 = _mm_set1_pd(x0);
+    const __m128d vy0 = _mm_set1_pd(y0);
+    int k = 0;
+    switch (type) {
+    case ATT:
+        SSE41_ROW_LOOP(sse41_att);
+        break;
+    case MAN_2D:
+        SSE41_ROW_LOOP(sse41_man);
+        break;
+    case MAX_2D:
+        SSE41_ROW_LOOP(sse41_max);
+        break;
+    case CEIL_2D:
+        SSE41_ROW_LOOP(sse41_ceil);
+        break;
+    default:
+        SSE41_ROW_LOOP(sse41_euc);
+        break;
+    }
+    // Remaining points
+    row_kernel_scalar(xs + k, ys + k, x0, y0, n - k, type, integer, out + k);
+}
+
+// Each lane keeps its own two nearest nodes, which are merged at the end
+SSE41_TARGET static void nearest_reducer_sse41(const double *dists, const int *skip, int base, int n, nearest_pair *pair) {
+    const __m128d inf = _mm_set1_pd(DBL_MAX);
+    __m128d d1 = inf, d2 = inf;
+    __m128d i1 = _mm_set1_pd(-1.0), i2 = i1;
+    __m128d idx = _mm_setr_pd(base, base + 1);
+    const __m128d step = _mm_set1_pd(2.0);
+    int k = 0;
+    for (; k + 2 <= n; k += 2) {
+        __m128d d = _mm_loadu_pd(dists + k);
+        if (skip) {
+            __m128i flags = _mm_loadl_epi64((const __m128i *) (skip + k));
+            __m128d keep = _mm_castsi128_pd(_mm_cvtepi32_epi64(_mm_cmpeq_epi32(flags, _mm_setzero_si128())));
+            d = _mm_blendv_pd(inf, d, keep);
+        }
+        __m128d lt1 = _mm_cmplt_pd(d, d1);
+        __m128d lt2 = _mm_cmplt_pd(d, d2);
+        d2 = _mm_blendv_pd(_mm_blendv_pd(d2, d, lt2), d1, lt1);
+        i2 = _mm_blendv_pd(_mm_blendv_pd(i2, idx, lt2), i1, lt1);
+        d1 = _mm_blendv_pd(d1, d, lt1);
+        i1 = _mm_blendv_pd(i1, idx, lt1);
+        idx = _mm_add_pd(idx, step);
+    }
+    double ld1[2], ld2[2], li1[2], li2[2];
+    _mm_storeu_pd(ld1, d1);
+    _mm_storeu_pd(ld2, d2);
+    _mm_storeu_pd(li1, i1);
+    _mm_storeu_pd(li2, i2);
+    for (int l = 0; l < 2; l++) {
+        nearest_insert(pair, ld1[l], (int) li1[l]);
+        nearest_insert(pair, ld2[l], (int) li2[l]);
+    }
+    nearest_reducer_scalar(dists + k, skip ? skip + k : NULL, base + k, n - k, pair);
+}
+
+#endif
+
+/////////////////////////////////////////////////////////////////////////
+///////////////// PUBLIC FUNCTIONS //////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////
+
+static row_kernel kernel = row_kernel_scalar;
+static nearest_reducer reducer = nearest_reducer_scalar;
+static const char *kernel_isa = "SCALAR";
+
+// Selects the kernels of the instruction set of the cpu. It runs once, also when the batch mode loads many instances concurrently
+static void select_kernels(void) {
+#ifdef DIST_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        kernel = row_kernel_avx2;
+        reducer = nearest_reducer_avx2;
+        kernel_isa = "AVX2";
+    } else if (__builtin_cpu_supports("sse4.1")) {
+        kernel = row_kernel_sse41;
+        reducer = nearest_reducer_sse41;
+        kernel_isa = "SSE4.1";
+    }
+#endif
+}
+
+void init_dist_kernels(instance *inst) {
+    static pthread_once_t kernels_selected = PTHREAD_ONCE_INIT;
+    pthread_once(&kernels_selected, select_kernels);
+
+    // The EXPLICIT instances have no coordinates: the rows are read from the matrix
+    if (inst->nodes == NULL || inst->num_nodes <= 0 || inst->weight_type == EXPLICIT) { return; }
+    void *xs = NULL;
+    void *ys = NULL;
+    size_t bytes = inst->num_nodes * sizeof(double);
+    if (posix_memalign(&xs, DIST_MATRIX_ALIGNMENT, bytes) != 0 || posix_memalign(&ys, DIST_MATRIX_ALIGNMENT, bytes) != 0) {
+        LOG_E("Unable to allocate the coordinates of the distance kernels");
+    }
+    inst->xcoord = xs;
+    inst->ycoord = ys;
+    for (int i = 0; i < inst->num_nodes; i++) {
+        inst->xcoord[i] = inst->nodes[i].x;
+        inst->ycoord[i] = inst->nodes[i].y;
+    }
+    if (inst->params.verbose >= 3) { LOG_I("Distance kernels use %s instructions", kernel_isa); }
+}
+
+void dist_row(instance *inst, int from, int begin, int end, double *row) {
+    // GEO distances need trigonometric functions which are not vectorized. A float matrix
+    // has rounded entries, so the distances are read from it to be consistent with calc_dist
+    int use_calc_dist = inst->xcoord == NULL || inst->weight_type == GEO || (inst->dist.data != NULL && inst->dist.type == DIST_MATRIX_FLOAT);
+    if (use_calc_dist) {
+        for (int j = begin; j < end; j++) {
+            row[j - begin] = calc_dist(from, j, inst);
+        }
+        return;
+    }
+    kernel(inst->xcoord + begin, inst->ycoord + begin, inst->xcoord[from], inst->ycoord[from], end - begin, inst->weight_type, inst->params.integer_cost, row);
+}
+
+int dist_row_argmin(instance *inst, int from, const int *skip, double *min_dist, int *second_idx, double *second_dist) {
+    double block[DIST_ROW_BLOCK];
+    nearest_pair pair = {DBL_MAX, DBL_MAX, -1, -1};
+
+    for (int begin = 0; begin < inst->num_nodes; begin += DIST_ROW_BLOCK) {
+        int end = begin + DIST_ROW_BLOCK < inst->num_nodes ? begin + DIST_ROW_BLOCK : inst->num_nodes;
+        dist_row(inst, from, begin, end, block);
+        if (from >= begin && from < end) { block[from - begin] = DBL_MAX; } // Node "from" is ignored
+        reducer(block, skip ? skip + begin : NULL, begin, end - begin, &pair);
+    }
+
+    if (min_dist) { *min_dist = pair.d1; }
+    if (second_idx) { *second_idx = pair.i2; }
+    if (second_dist) { *second_dist = pair.d2; }
+    return pair.i1;
+}
+
+const char *dist_kernels_isa() {
+    return kernel_isa;
+}
@@ -1,4 +1,5 @@
 #include <math.h>
+#include <stdlib.h>
 #include "distutil.h"
 
 static double nint(double x) {
@@ -32,13 +33,13 @@ double calc_pseudo_euc(node p1, node p2, int integer) {
 
 double calc_man2d(node p1, node p2, int integer) {
     double dx = fabs(p1.x - p2.x);
-    double dy = fabs(p2.y - p2.y);
+    double dy = fabs(p1.y - p2.y);
     return integer ? nint(dx + dy) : dx + dy;
 }
 
 double calc_max2d(node p1, node p2, int integer) {
     double dx = fabs(p1.x - p2.x);
-    double dy = fabs(p2.y - p2.y);
+    double dy = fabs(p1.y - p2.y);
     dx = integer ? nint(dx) : dx;
     dy = integer ? nint(dy) : dy;
     return dmax(dx, dy);
@@ -57,20 +58,46 @@ static void calc_lat_lon(node p, double *lat, double *lon) {
     *lon = PI * (deg + 5.0 * min / 3.0 ) / 180.0;
 }
 
-double calc_geo(node p1, node p2, int integer) {
-    double lat1, lon1; // Latitude and longitude point 1
-    double lat2, lon2; // Latitude and longitude point 2
-    calc_lat_lon(p1, &lat1, &lon1);
-    calc_lat_lon(p2, &lat2, &lon2);
-
-    double q1 = cos( lon1 - lon2 );
-    double q2 = cos( lat1 - lat2 );
-    double q3 = cos( lat1 + lat2 );
+// The TSPLIB GEO distance between two points given in radians
+static inline double geo_dist(geo_coord g1, geo_coord g2, int integer) {
+    double q1 = cos( g1.lon - g2.lon );
+    double q2 = cos( g1.lat - g2.lat );
+    double q3 = cos( g1.lat + g2.lat );
     double dist = EARTH_RAD * acos( 0.5 * ((1.0+q1)*q2 - (1.0-q1)*q3) ) + 1.0;
     return integer ? nint(dist) : dist;
 }
 
-double calc_dist(int i, int j, instance *inst) {
+double calc_geo(node p1, node p2, int integer) {
+    geo_coord g1, g2;
+    calc_lat_lon(p1, &g1.lat, &g1.lon);
+    calc_lat_lon(p2, &g2.lat, &g2.lon);
+    return geo_dist(g1, g2, integer);
+}
+
+void precompute_geo_coords(instance *inst) {
+    if (inst->weight_type != GEO || inst->nodes == NULL) { return; }
+    if (!inst->geo) { inst->geo = MALLOC(inst->num_nodes, geo_coord); }
+    for (int i = 0; i < inst->num_nodes; i++) {
+        calc_lat_lon(inst->nodes[i], &inst->geo[i].lat, &inst->geo[i].lon);
+    }
+}
+
+// Position of the edge (i, j) in the packed upper triangular matrix. It is the same of x_udir_pos
+// without the checks on the indexes and computed with long integers to avoid overflows
+static inline long dist_pos(int i, int j, int num_nodes) {
+    if (i > j) { int tmp = i; i = j; j = tmp; }
+    return (long) i * num_nodes + j - ((long) (i + 1) * (i + 2)) / 2;
+}
+
+// The weights of the EXPLICIT instances are read from the matrix loaded by parse_instance
+static double explicit_dist(int i, int j, instance *inst) {
+    if (i == j) { return 0; }
+    long pos = dist_pos(i, j, inst->num_nodes);
+    return inst->dist.type == DIST_MATRIX_INT ? ((int *) inst->dist.data)[pos] : ((double *) inst->dist.data)[pos];
+}
+
+static double calc_dist_nodes(int i, int j, instance *inst) {
+    if (inst->weight_type == EXPLICIT) { return explicit_dist(i, j, inst); }
     node node1 = inst->nodes[i];
     node node2 = inst->nodes[j];
     int integer = inst->params.integer_cost;
@@ -85,8 +112,191 @@ double calc_dist(int i, int j, instance *inst) {
     } else if (inst->weight_type == CEIL_2D) {
         return calc_ceil2d(node1, node2);
     } else if (inst->weight_type == GEO) {
+        if (inst->geo) { return geo_dist(inst->geo[i], inst->geo[j], integer); }
         return calc_geo(node1, node2, integer);
     }
     // Default: euclidian distance. Should be ok for most problems
     return calc_euc2d(node1, node2, integer);
-}
\ No newline at end of file
+}
+
+/////////////////////////////////////////////////////////////////////////
+///////////////// SPECIALIZED DISTANCE FUNCTIONS ////////////////////////
+/////////////////////////////////////////////////////////////////////////
+
+// Generates a distance function computed from the coordinates with a fixed metric and cost type,
+// so the compiler can inline the metric and drop the branches on the integer flag
+#define COORD_DIST_FUNC(name, metric_call)                      \
+static double name(int i, int j, instance *inst) {              \
+    node p1 = inst->nodes[i];                                   \
+    node p2 = inst->nodes[j];                                   \
+    return metric_call;                                         \
+}
+
+COORD_DIST_FUNC(dist_euc2d_int, calc_euc2d(p1, p2, 1))
+COORD_DIST_FUNC(dist_euc2d_real, calc_euc2d(p1, p2, 0))
+COORD_DIST_FUNC(dist_att_int, calc_pseudo_euc(p1, p2, 1))
+COORD_DIST_FUNC(dist_att_real, calc_pseudo_euc(p1, p2, 0))
+COORD_DIST_FUNC(dist_man2d_int, calc_man2d(p1, p2, 1))
+COORD_DIST_FUNC(dist_man2d_real, calc_man2d(p1, p2, 0))
+COORD_DIST_FUNC(dist_max2d_int, calc_max2d(p1, p2, 1))
+COORD_DIST_FUNC(dist_max2d_real, calc_max2d(p1, p2, 0))
+COORD_DIST_FUNC(dist_ceil2d, calc_ceil2d(p1, p2))
+COORD_DIST_FUNC(dist_geo_int, calc_geo(p1, p2, 1))
+COORD_DIST_FUNC(dist_geo_real, calc_geo(p1, p2, 0))
+
+// GEO distance functions reading the latitudes and longitudes computed by precompute_geo_coords
+static double dist_geo_pre_int(int i, int j, instance *inst) {
+    return geo_dist(inst->geo[i], inst->geo[j], 1);
+}
+
+static double dist_geo_pre_real(int i, int j, instance *inst) {
+    return geo_dist(inst->geo[i], inst->geo[j], 0);
+}
+
+// Generates a distance function which reads the precomputed matrix with a fixed element type.
+// The diagonal is not stored so it is computed from the coordinates
+#define MATRIX_DIST_FUNC(name, elem_type)                                       \
+static double name(int i, int j, instance *inst) {                              \
+    if (i == j) { return calc_dist_nodes(i, j, inst); }                         \
+    return ((elem_type *) inst->dist.data)[dist_pos(i, j, inst->num_nodes)];    \
+}
+
+MATRIX_DIST_FUNC(dist_matrix_int, int)
+MATRIX_DIST_FUNC(dist_matrix_float, float)
+MATRIX_DIST_FUNC(dist_matrix_double, double)
+
+// Coordinates based distance functions indexed by weight type and integer cost flag
+static const dist_func coord_dist_funcs[][2] = {
+    [EUC_2D]  = {dist_euc2d_real, dist_euc2d_int},
+    [MAX_2D]  = {dist_max2d_real, dist_max2d_int},
+    [MAN_2D]  = {dist_man2d_real, dist_man2d_int},
+    [CEIL_2D] = {dist_ceil2d, dist_ceil2d},
+    [GEO]     = {dist_geo_real, dist_geo_int},
+    [ATT]     = {dist_att_real, dist_att_int},
+};
+
+// Matrix based distance functions indexed by element type
+static const dist_func matrix_dist_funcs[] = {
+    [DIST_MATRIX_DOUBLE] = dist_matrix_double,
+    [DIST_MATRIX_FLOAT]  = dist_matrix_float,
+    [DIST_MATRIX_INT]    = dist_matrix_int,
+};
+
+// Integer distance functions. The int32 matrix is read without conversions, the other distances are rounded
+// already so the cast is exact
+static int int_dist_matrix(int i, int j, instance *inst) {
+    if (i == j) { return (int) calc_dist_nodes(i, j, inst); }
+    return ((int *) inst->dist.data)[dist_pos(i, j, inst->num_nodes)];
+}
+
+static int int_dist_rounded(int i, int j, instance *inst) {
+    return (int) inst->dist_fn(i, j, inst);
+}
+
+void select_dist_func(instance *inst) {
+    if (inst->dist.data != NULL) {
+        inst->dist_fn = matrix_dist_funcs[inst->dist.type];
+    } else {
+        int integer = inst->params.integer_cost ? 1 : 0;
+        // Default: euclidian distance, as in calc_dist_nodes
+        int type = inst->weight_type >= 0 && inst->weight_type < (int) LEN(coord_dist_funcs) ? inst->weight_type : EUC_2D;
+        inst->dist_fn = coord_dist_funcs[type][integer];
+        if (type == GEO && inst->geo) { inst->dist_fn = integer ? dist_geo_pre_int : dist_geo_pre_real; }
+    }
+    inst->int_dist_fn = NULL;
+    if (has_integer_costs(inst)) {
+        inst->int_dist_fn = inst->dist.data != NULL && inst->dist.type == DIST_MATRIX_INT ? int_dist_matrix : int_dist_rounded;
+    }
+}
+
+int_dist_func get_int_dist_func(instance *inst) {
+    if (inst->dist_fn == NULL) { select_dist_func(inst); }
+    return inst->int_dist_fn;
+}
+
+double calc_tour_cost(instance *inst, const edge *edges) {
+    int_dist_func int_dist = get_int_dist_func(inst);
+    if (int_dist) {
+        long cost = 0;
+        for (int i = 0; i < inst->num_nodes; i++) { cost += int_dist(edges[i].i, edges[i].j, inst); }
+        return (double) cost;
+    }
+    dist_func dist = get_dist_func(inst);
+    double cost = 0;
+    for (int i = 0; i < inst->num_nodes; i++) { cost += dist(edges[i].i, edges[i].j, inst); }
+    return cost;
+}
+
+dist_func get_dist_func(instance *inst) {
+    if (inst->dist_fn == NULL) { select_dist_func(inst); }
+    return inst->dist_fn;
+}
+
+double calc_dist(int i, int j, instance *inst) {
+    if (inst->dist_fn != NULL) { return inst->dist_fn(i, j, inst); }
+    return calc_dist_nodes(i, j, inst);
+}
+
+int build_dist_matrix(instance *inst) {
+    if (inst->weight_type == EXPLICIT) {
+        // The matrix is the instance itself: it is loaded by parse_instance, whatever the params are
+        if (inst->dist.data == NULL) { LOG_E("Missing EDGE_WEIGHT_SECTION"); }
+        select_dist_func(inst);
+        return 1;
+    }
+    inst->dist.data = NULL;
+    inst->dist.size = 0;
+    select_dist_func(inst);
+    if (inst->params.dist_type == DIST_MATRIX_OFF || inst->num_nodes < 2) { return 0; }
+
+    dist_matrix_type type = inst->params.dist_type;
+    if (type == DIST_MATRIX_AUTO) {
+        // CEIL_2D distances are always integers
+        type = has_integer_costs(inst) ? DIST_MATRIX_INT : DIST_MATRIX_DOUBLE;
+    }
+    if (type == DIST_MATRIX_INT && !has_integer_costs(inst)) {
+        LOG_E("The INT distance matrix can be used only with integer costs");
+    }
+
+    size_t elem_size = type == DIST_MATRIX_INT ? sizeof(int) : (type == DIST_MATRIX_FLOAT ? sizeof(float) : sizeof(double));
+    long size = (long) inst->num_nodes * (inst->num_nodes - 1) / 2;
+    double mem = (double) size * elem_size / (1024.0 * 1024.0); // MB required by the matrix
+    if (mem > inst->params.dist_mem_limit) {
+        if (inst->params.verbose >= 3) {
+            LOG_I("Distance matrix not built: %0.1f MB required, %ld MB available", mem, inst->params.dist_mem_limit);
+        }
+        return 0;
+    }
+
+    void *data = NULL;
+    size_t bytes = (size_t) size * elem_size;
+    if (posix_memalign(&data, DIST_MATRIX_ALIGNMENT, bytes) != 0) {
+        if (inst->params.verbose >= 3) { LOG_I("Distance matrix not built: unable to allocate %0.1f MB", mem); }
+        return 0;
+    }
+
+    // Filling the matrix row by row. The entries of each row are contiguous
+    long k = 0;
+    for (int i = 0; i < inst->num_nodes - 1; i++) {
+        for (int j = i + 1; j < inst->num_nodes; j++) {
+            double dist = calc_dist_nodes(i, j, inst);
+            if (type == DIST_MATRIX_INT) {
+                ((int *) data)[k++] = (int) dist;
+            } else if (type == DIST_MATRIX_FLOAT) {
+                ((float *) data)[k++] = (float) dist;
+            } else {
+                ((double *) data)[k++] = dist;
+            }
+        }
+    }
+
+    inst->dist.data = data;
+    inst->dist.type = type;
+    inst->dist.size = size;
+    select_dist_func(inst);
+    if (inst->params.verbose >= 3) {
+        const char *name = type == DIST_MATRIX_INT ? "int" : (type == DIST_MATRIX_FLOAT ? "float" : "double");
+        LOG_I("Distance matrix built: %ld %s entries, %0.1f MB", size, name, mem);
+    }
+    return 1;
+}
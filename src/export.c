@@ -0,0 +1,247 @@
+#include "export.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Snapshot of the tour, owned by the export. The background export reads only this data
+typedef struct export_job {
+    export_format format;
+    char *path;
+    char *name;
+    int num_nodes;
+    int *succ;          // Successor of each node
+    double obj;
+    double time;
+    pthread_t thread;
+    int ok;             // Whether the file is written
+} export_job;
+
+// Buffered writer on a file descriptor
+typedef struct {
+    int fd;
+    char *buffer;
+    size_t used;
+    int ok;             // 0 after the first failed write
+} buffered_writer;
+
+static void writer_flush(buffered_writer *w) {
+    size_t done = 0;
+    while (w->ok && done < w->used) {
+        ssize_t written = write(w->fd, w->buffer + done, w->used - done);
+        if (written <= 0) { w->ok = 0; }
+        else { done += written; }
+    }
+    w->used = 0;
+}
+
+static void writer_bytes(buffered_writer *w, const void *data, size_t len) {
+    if (w->used + len > EXPORT_BUFFER_SIZE) { writer_flush(w); }
+    if (len > EXPORT_BUFFER_SIZE) {
+        // Larger than the buffer: written directly
+        const char *p = data;
+        while (w->ok && len > 0) {
+            ssize_t written = write(w->fd, p, len);
+            if (written <= 0) { w->ok = 0; }
+            else { p += written; len -= written; }
+        }
+        return;
+    }
+    memcpy(w->buffer + w->used, data, len);
+    w->used += len;
+}
+
+static void writer_str(buffered_writer *w, const char *str) {
+    writer_bytes(w, str, strlen(str));
+}
+
+// Writes a non negative integer followed by the separator. Formatting by hand is much faster than printf
+static void writer_int(buffered_writer *w, int value, char separator) {
+    if (w->used + 16 > EXPORT_BUFFER_SIZE) { writer_flush(w); }
+    char digits[12];
+    int len = 0;
+    do {
+        digits[len++] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+    char *out = w->buffer + w->used;
+    for (int k = 0; k < len; k++) { out[k] = digits[len - 1 - k]; }
+    out[len] = separator;
+    w->used += len + 1;
+}
+
+// Writes the JSON string of str, escaping the quotes, the backslashes and the control characters
+static void writer_json_string(buffered_writer *w, const char *str) {
+    writer_str(w, "\"");
+    for (const char *c = str != NULL ? str : ""; *c != '\0'; c++) {
+        char escaped[8];
+        if (*c == '"' || *c == '\\') {
+            snprintf(escaped, sizeof(escaped), "\\%c", *c);
+        } else if ((unsigned char) *c < 0x20) {
+            snprintf(escaped, sizeof(escaped), "\\u%04x", *c);
+        } else {
+            escaped[0] = *c;
+            escaped[1] = '\0';
+        }
+        writer_str(w, escaped);
+    }
+    writer_str(w, "\"");
+}
+
+static void write_tsplib_tour(buffered_writer *w, const export_job *job) {
+    char line[256];
+    snprintf(line, sizeof(line), "NAME : %s.tour\nTYPE : TOUR\nDIMENSION : %d\nOBJECTIVE : %f\nTIME : %f\nTOUR_SECTION\n",
+             job->name != NULL ? job->name : "", job->num_nodes, job->obj, job->time);
+    writer_str(w, line);
+    for (int k = 0, node = 0; k < job->num_nodes; k++, node = job->succ[node]) { writer_int(w, node + 1, '\n'); }
+    writer_str(w, "-1\nEOF\n");
+}
+
+static void write_binary_tour(buffered_writer *w, const export_job *job) {
+    int32_t n = job->num_nodes;
+    writer_bytes(w, EXPORT_BINARY_MAGIC, 8);
+    writer_bytes(w, &n, sizeof(n));
+    writer_bytes(w, &job->obj, sizeof(job->obj));
+    writer_bytes(w, &job->time, sizeof(job->time));
+    writer_bytes(w, job->succ, (size_t) n * sizeof(int32_t));
+}
+
+static void write_json_tour(buffered_writer *w, const export_job *job) {
+    char line[256];
+    writer_str(w, "{\"name\":");
+    writer_json_string(w, job->name);
+    snprintf(line, sizeof(line), ",\"nodes\":%d,\"objective\":%f,\"time\":%f,\"tour\":[", job->num_nodes, job->obj, job->time);
+    writer_str(w, line);
+    for (int k = 0, node = 0; k < job->num_nodes; k++, node = job->succ[node]) {
+        writer_int(w, node + 1, k + 1 < job->num_nodes ? ',' : ']');
+    }
+    writer_str(w, "}\n");
+}
+
+static void *run_export(void *arg) {
+    export_job *job = arg;
+    buffered_writer w = {open(job->path, O_WRONLY | O_CREAT | O_TRUNC, 0666), NULL, 0, 1};
+    if (w.fd < 0) {
+        job->ok = 0;
+        return NULL;
+    }
+    w.buffer = MALLOC(EXPORT_BUFFER_SIZE, char);
+    if (job->format == EXPORT_BINARY) {
+        write_binary_tour(&w, job);
+    } else if (job->format == EXPORT_JSON) {
+        write_json_tour(&w, job);
+    } else {
+        write_tsplib_tour(&w, job);
+    }
+    writer_flush(&w);
+    job->ok = close(w.fd) == 0 && w.ok;
+    FREE(w.buffer);
+    return NULL;
+}
+
+static void free_job(export_job *job) {
+    if (!job->ok) { printf("Unable to save the tour file %s\n", job->path); }
+    FREE(job->path);
+    FREE(job->name);
+    FREE(job->succ);
+    free(job);
+}
+
+// Returns true if the path ends with the suffix
+static bool ends_with(const char *path, const char *suffix) {
+    size_t len = strlen(path);
+    size_t suffix_len = strlen(suffix);
+    return len >= suffix_len && strcmp(path + len - suffix_len, suffix) == 0;
+}
+
+void export_tour(instance *inst) {
+    if (inst->params.perf_prof || inst->params.export_format == EXPORT_NONE || inst->solution.edges == NULL) { return; }
+    wait_export_tour(inst); // At most one export at a time for each instance
+
+    export_format format = inst->params.export_format;
+    const char *path = inst->params.export_path;
+    if (format == EXPORT_AUTO) {
+        format = path == NULL ? EXPORT_TOUR : (ends_with(path, ".succ") ? EXPORT_BINARY : (ends_with(path, ".json") ? EXPORT_JSON : EXPORT_TOUR));
+    }
+
+    export_job *job = CALLOC(1, export_job);
+    job->format = format;
+    if (path != NULL) {
+        job->path = CALLOC(strlen(path) + 1, char);
+        memcpy(job->path, path, strlen(path));
+    } else {
+        const char *ext = format == EXPORT_BINARY ? "succ" : (format == EXPORT_JSON ? "json" : "tour");
+        mkdir(EXPORT_DIR, 0777);
+        size_t len = strlen(EXPORT_DIR) + (inst->name != NULL ? strlen(inst->name) : 0) + strlen(ext) + 3;
+        job->path = CALLOC(len, char);
+        snprintf(job->path, len, "%s/%s.%s", EXPORT_DIR, inst->name != NULL ? inst->name : "", ext);
+    }
+    if (inst->name != NULL) {
+        job->name = CALLOC(strlen(inst->name) + 1, char);
+        memcpy(job->name, inst->name, strlen(inst->name));
+    }
+    job->num_nodes = inst->num_nodes;
+    job->obj = inst->solution.obj_best;
+    job->time = inst->solution.time_to_solve;
+    job->succ = MALLOC(inst->num_nodes, int);
+    for (int i = 0; i < inst->num_nodes; i++) { job->succ[inst->solution.edges[i].i] = inst->solution.edges[i].j; }
+
+    if (inst->params.export_async && pthread_create(&job->thread, NULL, run_export, job) == 0) {
+        inst->export_job = job;
+        return;
+    }
+    run_export(job); // Synchronous export, also when the thread can't be started
+    free_job(job);
+}
+
+void wait_export_tour(instance *inst) {
+    if (inst->export_job == NULL) { return; }
+    pthread_join(inst->export_job->thread, NULL);
+    free_job(inst->export_job);
+    inst->export_job = NULL;
+}
+
+// Appends the CSV field of str to the row, quoted when it has commas, quotes or line breaks
+static int append_csv_field(char *row, int len, int size, const char *str) {
+    if (str == NULL) { str = ""; }
+    if (strpbrk(str, ",\"\r\n") == NULL) { return len + snprintf(row + len, size - len, "%s", str); }
+    if (len < size - 1) { row[len++] = '"'; }
+    for (const char *c = str; *c != '\0' && len < size - 3; c++) {
+        if (*c == '"') { row[len++] = '"'; }
+        row[len++] = *c;
+    }
+    row[len++] = '"';
+    row[len] = '\0';
+    return len;
+}
+
+void export_perf_result(instance *inst, int status) {
+    const char *path = inst->params.perf_csv;
+    if (path == NULL) { return; }
+    char row[1024];
+    int len = append_csv_field(row, 0, sizeof(row) - 128, inst->name);
+    row[len++] = ',';
+    len = append_csv_field(row, len, sizeof(row) - 128, inst->params.method.name);
+    len += snprintf(row + len, sizeof(row) - len, ",%0.6f,%0.6f,%d,%d\n",
+                    inst->solution.time_to_solve, inst->solution.obj_best, status, inst->params.seed);
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0666);
+    if (fd < 0) {
+        LOG_I("Unable to open the performance profile file %s", path);
+        return;
+    }
+    // The header check and the row are done under the lock, so the header is written once and the rows are never interleaved
+    flock(fd, LOCK_EX);
+    struct stat st;
+    int ok = fstat(fd, &st) == 0;
+    if (ok && st.st_size == 0) { ok = write(fd, PERF_CSV_HEADER, strlen(PERF_CSV_HEADER)) == (ssize_t) strlen(PERF_CSV_HEADER); }
+    ok = ok && write(fd, row, len) == len;
+    flock(fd, LOCK_UN);
+    close(fd);
+    if (!ok) { LOG_I("Unable to write the performance profile file %s", path); }
+}
@@ -0,0 +1,264 @@
+#include "generator.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "distutil.h"
+#include "instcache.h"
+
+#define GEN_MIN_LAT -60.0       // Latitudes of the GEO instances, in degrees
+#define GEN_MAX_LAT 70.0
+#define GEN_MIN_LON -180.0      // Longitudes of the GEO instances, in degrees
+#define GEN_MAX_LON 180.0
+#define WRITE_BUFFER_SIZE (1 << 20)
+
+static const char *weight_names[] = {"EUC_2D", "MAX_2D", "MAN_2D", "CEIL_2D", "GEO", "ATT", "EXPLICIT"};
+static const char *generator_names[] = {"none", "uniform", "clustered", "grid"};
+
+// splitmix64. The generator doesn't use the random numbers of the solvers, so the instance
+// doesn't depend on the method, on the number of threads or on the platform
+typedef struct {
+    uint64_t state;
+} gen_random;
+
+static inline uint64_t next_u64(gen_random *rng) {
+    uint64_t z = (rng->state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Uniform in [0, 1)
+static inline double next_unit(gen_random *rng) {
+    return (next_u64(rng) >> 11) * 0x1.0p-53;
+}
+
+// Standard normal (Box-Muller)
+static double next_normal(gen_random *rng) {
+    double u = 1.0 - next_unit(rng); // In (0, 1] so the logarithm is finite
+    double v = next_unit(rng);
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+static inline double clamp(double value, double min, double max) {
+    return value < min ? min : (value > max ? max : value);
+}
+
+// Converts an angle in degrees to the TSPLIB DDD.MM format, rounded to the minute
+static double to_ddd_mm(double degrees) {
+    long minutes = lround(degrees * 60.0);
+    long deg = minutes / 60; // Truncated toward zero, so the minutes have the sign of the degrees
+    return (double) (deg * 100 + minutes % 60) / 100.0;
+}
+
+// Generates num_points points with the distribution of the params in the square [0, side] x [0, side]
+static void generate_points(instance *inst, gen_random *rng, double side, node *points, int num_points) {
+    switch (inst->params.gen_type) {
+    case GEN_UNIFORM:
+        for (int i = 0; i < num_points; i++) {
+            points[i].x = next_unit(rng) * side;
+            points[i].y = next_unit(rng) * side;
+        }
+        break;
+    case GEN_CLUSTERED: {
+        int num_centers = num_points / GEN_CLUSTER_SIZE > 1 ? num_points / GEN_CLUSTER_SIZE : 1;
+        // Each cluster spreads over about the area of the square divided by the number of clusters
+        double sigma = side / sqrt((double) num_centers) / 4.0;
+        node *centers = MALLOC(num_centers, node);
+        for (int c = 0; c < num_centers; c++) {
+            centers[c].x = next_unit(rng) * side;
+            centers[c].y = next_unit(rng) * side;
+        }
+        for (int i = 0; i < num_points; i++) {
+            node center = centers[(int) (next_unit(rng) * num_centers)];
+            points[i].x = clamp(center.x + sigma * next_normal(rng), 0, side);
+            points[i].y = clamp(center.y + sigma * next_normal(rng), 0, side);
+        }
+        FREE(centers);
+        break;
+    }
+    case GEN_GRID: {
+        // The rows of the smallest square grid with num_points points are filled in order
+        int k = (int) ceil(sqrt((double) num_points));
+        for (int i = 0; i < num_points; i++) {
+            points[i].x = (i % k) * GEN_SPACING;
+            points[i].y = (i / k) * GEN_SPACING;
+        }
+        break;
+    }
+    default:
+        LOG_E("Unknown instance distribution");
+    }
+}
+
+// Computes the weights of the EXPLICIT instance from its nodes
+static void generate_weights(instance *inst) {
+    int n = inst->num_nodes;
+    dist_matrix_type type = has_integer_costs(inst) ? DIST_MATRIX_INT : DIST_MATRIX_DOUBLE;
+    size_t elem_size = type == DIST_MATRIX_INT ? sizeof(int) : sizeof(double);
+    long size = (long) n * (n - 1) / 2;
+    double mem = (double) size * elem_size / (1024.0 * 1024.0);
+    if (mem > inst->params.dist_mem_limit) {
+        LOG_E("The weights of the EXPLICIT instance require %0.1f MB, %ld MB available: raise -distmem", mem, inst->params.dist_mem_limit);
+    }
+    void *data = NULL;
+    if (posix_memalign(&data, DIST_MATRIX_ALIGNMENT, size > 0 ? size * elem_size : elem_size) != 0) {
+        LOG_E("Unable to allocate the explicit distance matrix: %0.1f MB", mem);
+    }
+
+    long k = 0;
+    for (int i = 0; i < n - 1; i++) {
+        for (int j = i + 1; j < n; j++) {
+            double dist = calc_euc2d(inst->nodes[i], inst->nodes[j], inst->params.integer_cost);
+            if (type == DIST_MATRIX_INT) {
+                ((int *) data)[k++] = (int) dist;
+            } else {
+                ((double *) data)[k++] = dist;
+            }
+        }
+    }
+
+    inst->dist.data = data;
+    inst->dist.type = type;
+    inst->dist.size = size;
+    inst->dist.map = NULL;
+    inst->dist.map_size = 0;
+}
+
+void generate_instance(instance *inst) {
+    struct timeval start, end;
+    gettimeofday(&start, 0);
+
+    int n = inst->params.gen_nodes;
+    if (n <= 0) { LOG_E("The generated instance must have at least one node"); }
+    inst->is_vrp = inst->params.gen_capacity >= 0;
+    if (inst->is_vrp && n < 2) { LOG_E("The generated CVRP instance must have at least two nodes"); }
+    inst->num_nodes = n;
+    inst->weight_type = inst->params.gen_weight;
+    inst->weight_format = inst->weight_type == EXPLICIT ? UPPER_ROW : -1;
+
+    gen_random rng = {(uint64_t) (unsigned int) inst->params.seed};
+    FREE(inst->nodes);
+    inst->nodes = CALLOC(n, node);
+
+    // The depot of the CVRP instances is at the center of the square, the customers follow the distribution
+    int first = inst->is_vrp ? 1 : 0;
+    double side = inst->params.gen_type == GEN_GRID ? (ceil(sqrt((double) (n - first))) - 1) * GEN_SPACING
+                                                    : sqrt((double) (n - first)) * GEN_SPACING;
+    generate_points(inst, &rng, side, inst->nodes + first, n - first);
+    if (inst->is_vrp) {
+        inst->nodes[0].x = side / 2;
+        inst->nodes[0].y = side / 2;
+    }
+
+    for (int i = 0; i < n; i++) {
+        if (inst->weight_type == GEO) {
+            double lat = GEN_MIN_LAT + (GEN_MAX_LAT - GEN_MIN_LAT) * (side > 0 ? inst->nodes[i].x / side : 0.5);
+            double lon = GEN_MIN_LON + (GEN_MAX_LON - GEN_MIN_LON) * (side > 0 ? inst->nodes[i].y / side : 0.5);
+            inst->nodes[i].x = to_ddd_mm(lat);
+            inst->nodes[i].y = to_ddd_mm(lon);
+        } else {
+            inst->nodes[i].x = round(inst->nodes[i].x);
+            inst->nodes[i].y = round(inst->nodes[i].y);
+        }
+    }
+
+    if (inst->is_vrp) {
+        int capacity = inst->params.gen_capacity;
+        int max_demand = capacity > 0 && capacity < GEN_MAX_DEMAND ? capacity : GEN_MAX_DEMAND;
+        long total = 0;
+        for (int i = 1; i < n; i++) {
+            inst->nodes[i].demand = 1 + (int) (next_unit(&rng) * max_demand);
+            total += inst->nodes[i].demand;
+        }
+        inst->nodes[0].is_depot = true;
+        if (capacity == 0) {
+            capacity = (int) ceil((double) GEN_ROUTE_SIZE * total / (n - 1));
+            if (capacity < GEN_MAX_DEMAND) { capacity = GEN_MAX_DEMAND; }
+        }
+        inst->capacity = capacity;
+    }
+
+    if (inst->weight_type == EXPLICIT) { generate_weights(inst); }
+
+    const char *dist_name = generator_names[inst->params.gen_type];
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer), "%s%d-s%d", dist_name, n, inst->params.seed);
+    FREE(inst->name);
+    inst->name = CALLOC(strlen(buffer) + 1, char);
+    memcpy(inst->name, buffer, strlen(buffer));
+    snprintf(buffer, sizeof(buffer), "Generated %s instance, seed %d", dist_name, inst->params.seed);
+    FREE(inst->comment);
+    inst->comment = CALLOC(strlen(buffer) + 1, char);
+    memcpy(inst->comment, buffer, strlen(buffer));
+
+    gettimeofday(&end, 0);
+    if (inst->params.verbose >= 3) { LOG_I("Instance %s generated in %0.3f seconds", inst->name, get_elapsed_time(start, end)); }
+}
+
+void write_tsplib(instance *inst, const char *path) {
+    struct timeval start, end;
+    gettimeofday(&start, 0);
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) { LOG_E("Unable to write the instance file %s", path); }
+    char *buffer = MALLOC(WRITE_BUFFER_SIZE, char);
+    setvbuf(fp, buffer, _IOFBF, WRITE_BUFFER_SIZE);
+
+    int n = inst->num_nodes;
+    int explicit = inst->weight_type == EXPLICIT;
+    if (inst->name != NULL) { fprintf(fp, "NAME : %s\n", inst->name); }
+    if (inst->comment != NULL) { fprintf(fp, "COMMENT : %s\n", inst->comment); }
+    fprintf(fp, "TYPE : %s\n", inst->is_vrp ? "CVRP" : "TSP");
+    fprintf(fp, "DIMENSION : %d\n", n);
+    fprintf(fp, "EDGE_WEIGHT_TYPE : %s\n", weight_names[inst->weight_type]);
+    if (explicit) { fprintf(fp, "EDGE_WEIGHT_FORMAT : UPPER_ROW\nDISPLAY_DATA_TYPE : TWOD_DISPLAY\n"); }
+    if (inst->is_vrp) { fprintf(fp, "CAPACITY : %d\n", inst->capacity); }
+
+    // The coordinates are integers, or DDD.MM with two decimals for GEO, so they are read back exactly
+    fprintf(fp, "%s\n", explicit ? "DISPLAY_DATA_SECTION" : "NODE_COORD_SECTION");
+    for (int i = 0; i < n; i++) {
+        if (inst->weight_type == GEO) {
+            fprintf(fp, "%d %.2f %.2f\n", i + 1, inst->nodes[i].x, inst->nodes[i].y);
+        } else { // Formatting integers is much faster than formatting doubles
+            fprintf(fp, "%d %ld %ld\n", i + 1, (long) inst->nodes[i].x, (long) inst->nodes[i].y);
+        }
+    }
+
+    if (explicit) {
+        // The packed upper triangular matrix lists the weights in the UPPER_ROW order
+        fprintf(fp, "EDGE_WEIGHT_SECTION\n");
+        long k = 0;
+        for (int i = 0; i < n - 1; i++) {
+            for (int j = i + 1; j < n; j++, k++) {
+                if (inst->dist.type == DIST_MATRIX_INT) {
+                    fprintf(fp, j + 1 < n ? "%d " : "%d\n", ((int *) inst->dist.data)[k]);
+                } else {
+                    fprintf(fp, j + 1 < n ? "%.17g " : "%.17g\n", ((double *) inst->dist.data)[k]);
+                }
+            }
+        }
+    }
+
+    if (inst->is_vrp) {
+        fprintf(fp, "DEMAND_SECTION\n");
+        for (int i = 0; i < n; i++) { fprintf(fp, "%d %d\n", i + 1, inst->nodes[i].demand); }
+        fprintf(fp, "DEPOT_SECTION\n");
+        for (int i = 0; i < n; i++) {
+            if (inst->nodes[i].is_depot) { fprintf(fp, "%d\n", i + 1); }
+        }
+        fprintf(fp, "-1\n");
+    }
+    fprintf(fp, "EOF\n");
+    int ok = !ferror(fp);
+    ok = fclose(fp) == 0 && ok;
+    FREE(buffer);
+    if (!ok) { LOG_E("Unable to write the instance file %s", path); }
+
+    if (inst->params.inst_cache && !write_instance_cache(inst, path) && inst->params.verbose >= 3) {
+        LOG_I("Unable to write the instance cache of %s", path);
+    }
+    gettimeofday(&end, 0);
+    if (inst->params.verbose >= 3) { LOG_I("Instance written in %s in %0.3f seconds", path, get_elapsed_time(start, end)); }
+}
@@ -2,6 +2,7 @@
 
 #include "heuristics.h"
 #include "distutil.h"
+#include "incumbent.h"
 
 #include <float.h>
 #include <assert.h>
@@ -31,14 +32,7 @@ typedef struct {
  * @param individual The individual which chromosome is stored to edge representation
  */
 void from_chromosome_to_edges(instance* inst, individual individual) {
-    for (int i = 0; i < inst->num_nodes - 1; i++) {
-        int index = individual.chromosome[i];
-        inst->solution.edges[index].i = individual.chromosome[i];
-        inst->solution.edges[index].j = individual.chromosome[i + 1];
-    }
-    int index = individual.chromosome[inst->num_nodes - 1];
-    inst->solution.edges[index].i = individual.chromosome[inst->num_nodes - 1];
-    inst->solution.edges[index].j = individual.chromosome[0];
+    order_to_edges(individual.chromosome, inst->num_nodes, inst->solution.edges);
 }
 
 /**
@@ -49,21 +43,37 @@ void from_chromosome_to_edges(instance* inst, individual individual) {
  * @param individual A reference of the individual which the fitness will be calculated
  */
 void fitness(instance* inst, individual* individual) {
+    int_dist_func int_dist = get_int_dist_func(inst);
+    if (int_dist) {
+        // Integer costs are summed exactly in int64
+        long cost = 0;
+        int prev_node = individual->chromosome[0];
+        for (int i = 1; i < inst->num_nodes; i++) {
+            int node = individual->chromosome[i];
+            cost += int_dist(prev_node, node, inst);
+            prev_node = node;
+        }
+        cost += int_dist(prev_node, individual->chromosome[0], inst);
+        individual->fitness = (double) cost;
+        return;
+    }
+    dist_func dist = get_dist_func(inst);
     int prev_node = individual->chromosome[0];
     individual->fitness = 0;
     for (int i = 1; i < inst->num_nodes; i++) {
         int node = individual->chromosome[i];
-        individual->fitness += calc_dist(prev_node, node, inst);
+        individual->fitness += dist(prev_node, node, inst);
         prev_node = node;
     }
-    individual->fitness += calc_dist(prev_node, individual->chromosome[0], inst);
+    individual->fitness += dist(prev_node, individual->chromosome[0], inst);
 }
 
 static int compare_individuals(const void *lhs, const void *rhs) {
     const individual* lp = lhs;
     const individual* rp = rhs;
 
-    return rp->fitness - lp->fitness;
+    // The difference is not returned since its conversion to int truncates the real costs
+    return (rp->fitness > lp->fitness) - (rp->fitness < lp->fitness);
     
 }
 
@@ -425,21 +435,16 @@ void mutation(instance* inst, individual* offsprings, const int off_size) {
                 }
             } else {
                 // Mutation method3
-                // Applies 2opt algoritm.
+                // Applies 2opt algoritm directly on the chromosome, which is already the visiting order of the tour.
                 //LOG_D("Applying 2opt mutation");
-                instance tmp_inst;
-                copy_instance(&tmp_inst, inst);
-                from_chromosome_to_edges(&tmp_inst, offsprings[off]);
+                array_tour t;
+                tour_init(&t, inst->num_nodes);
+                tour_from_order(&t, offsprings[off].chromosome);
+                double obj = inst->solution.obj_best; // Only the deltas matter
                 // We set 2opt's time limit so it finishes faster and finds a little better solution 
-                tmp_inst.params.time_limit = 2;
-                alg_2opt(&tmp_inst);
-                int node_idx = 0;
-                int node_iter = 0;
-                while (node_iter < tmp_inst.num_nodes) {
-                    offsprings[off].chromosome[node_iter++] = tmp_inst.solution.edges[node_idx].i;
-                    node_idx = tmp_inst.solution.edges[node_idx].j;
-                }
-                free_instance(&tmp_inst);
+                alg_2opt_tour(inst, &t, &obj, 2);
+                tour_to_order(&t, offsprings[off].chromosome);
+                tour_free(&t);
             }
         }
     }
@@ -459,6 +464,13 @@ int HEU_Genetic(instance *inst) {
     for (int i = 0; i < pop_size; i++) {
         population[i].chromosome = CALLOC(inst->num_nodes, int);
 
+        if (i == 0 && inst->warm_tour != NULL) {
+            // The warm start tour is an individual of the initial population
+            memcpy(population[i].chromosome, inst->warm_tour, inst->num_nodes * sizeof(int));
+            fitness(inst, &(population[i]));
+            continue;
+        }
+
         double rand_num = URAND();
         if (rand_num < HEURISTIC_INIT_RATE) {
             int start_node = rand_choice(0, inst->num_nodes);
@@ -522,6 +534,7 @@ int HEU_Genetic(instance *inst) {
             individual best_individual = population[best_idx];
             inst->solution.obj_best = best_fitness;
             from_chromosome_to_edges(inst, best_individual); //Update best solution
+            stream_incumbent(inst, best_fitness, STREAM_NO_BOUND, inst->solution.edges);
             //plot_solution(inst);
             //if (inst->params.verbose >= 3) {LOG_I("UPDATED INCUMBENT: %0.2f", best_fitness);}
 
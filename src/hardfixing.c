@@ -3,6 +3,7 @@
 #include "solver.h"
 #include "utility.h"
 #include "heuristics.h"
+#include "incumbent.h"
 
 
 //Function that UNfix the edges
@@ -123,7 +124,8 @@ void advanced_fix(CPXENVptr env, CPXLPptr lp, instance *inst, double prob, int *
     double zero = 0.0;
     for (int i = 0; i < num_closed_cycles; i++) {
         edge e = close_cycle_edges[i];
-        int index = x_udir_pos(e.i, e.j, inst->num_nodes);
+        int index = x_udir_col(inst, e.i, e.j);
+        if (index < 0) continue; // The edge is not in the sparse model
         CPXchgbds(env, lp, 1, &index, &ub, &zero);
         indexes[*ncols] = index;
         bounds[*ncols] = ub;
@@ -161,18 +163,21 @@ int hard_fixing_solver(instance *inst, CPXENVptr env, CPXLPptr lp) {
     if (inst->params.verbose >= 3) {
         LOG_I("End of heuristic initialization");
     }
+    int partial = 0; // 1 when the heuristic solution uses edges out of the sparse model
     for (int i = 0; i < inst->num_nodes; i++) {
         edge e = inst->solution.edges[i];
-        int index = x_udir_pos(e.i, e.j, inst->num_nodes);
+        int index = x_udir_col(inst, e.i, e.j);
+        if (index < 0) { partial = 1; continue; }
         xh[index] = 1.0;
     }
 
     int beg = 0;
-    int level = CPX_MIPSTART_NOCHECK;
+    int level = partial ? CPX_MIPSTART_REPAIR : CPX_MIPSTART_NOCHECK;
     status = CPXaddmipstarts(env, lp, 1, inst->num_columns, &beg, inst->ind, xh, &level, NULL);
     if (status) {
         LOG_E("CPXaddmipstarts() error code %d", status);
     }
+    if (partial) { inst->solution.obj_best = CPX_INFBOUND; } // The heuristic solution is not a solution of the model, so the first one of cplex replaces it
     
     status = configure_opt_best_solver(env, lp, inst);
     if (status) {LOG_E("Configure opt best solver in hard fixing error code %d", status);}
@@ -229,6 +234,7 @@ int hard_fixing_solver(instance *inst, CPXENVptr env, CPXLPptr lp) {
                 save_solution_edges(inst, xh);
                 plot_solution(inst);
             }
+            stream_incumbent(inst, objval, STREAM_NO_BOUND, inst->params.perf_prof ? NULL : inst->solution.edges);
         }
         
 
@@ -272,18 +278,21 @@ int hard_fixing_solver2(instance *inst, CPXENVptr env, CPXLPptr lp) {
     if (inst->params.verbose >= 3) {
         LOG_I("End of heuristic initialization");
     }
+    int partial = 0; // 1 when the heuristic solution uses edges out of the sparse model
     for (int i = 0; i < inst->num_nodes; i++) {
         edge e = inst->solution.edges[i];
-        int index = x_udir_pos(e.i, e.j, inst->num_nodes);
+        int index = x_udir_col(inst, e.i, e.j);
+        if (index < 0) { partial = 1; continue; }
         xh[index] = 1.0;
     }
 
     int beg = 0;
-    int level = CPX_MIPSTART_NOCHECK;
+    int level = partial ? CPX_MIPSTART_REPAIR : CPX_MIPSTART_NOCHECK;
     status = CPXaddmipstarts(env, lp, 1, inst->num_columns, &beg, inst->ind, xh, &level, NULL);
     if (status) {
         LOG_E("CPXaddmipstarts() error code %d", status);
     }
+    if (partial) { inst->solution.obj_best = CPX_INFBOUND; } // The heuristic solution is not a solution of the model, so the first one of cplex replaces it
     status = configure_opt_best_solver(env, lp, inst);
     if (status) {LOG_E("Configure opt best solver in hard fixing error code %d", status);}
 
@@ -361,6 +370,7 @@ int hard_fixing_solver2(instance *inst, CPXENVptr env, CPXLPptr lp) {
                 save_solution_edges(inst, xh);
                 plot_solution(inst);
             }
+            stream_incumbent(inst, objval, STREAM_NO_BOUND, inst->params.perf_prof ? NULL : inst->solution.edges);
         }
         // Unfix the variables
         //set_default_lb2(env, lp, ncols_fixed, indexes);
@@ -1,7 +1,11 @@
 #include "heuristics.h"
 
 #include "distutil.h"
+#include "incumbent.h"
+#include "distkernels.h"
+#include "kdtree.h"
 #include "convexhull.h"
+#include "localsearch.h"
 
 #include <float.h>
 #include <sys/stat.h>
@@ -14,7 +18,31 @@
 ///////////////// CONSTRUCTIVE HEURISTICS ///////////////////////////////
 /////////////////////////////////////////////////////////////////////////
 
-//Nearest Neighboor algorithm O(n^2)
+/**
+ * Finds the nearest and the second nearest not visited node to node "from". The k-d tree of the instance
+ * is used when it is built, otherwise the distances to all the nodes are scanned. The result is the same.
+ * 
+ * @param inst The instance pointer of the problem
+ * @param from The node where the distances are computed from
+ * @param visited The flags of the visited nodes. Used when the k-d tree is not built
+ * @param filter The visited nodes removed from the k-d tree. NULL when the k-d tree is not built
+ * @param min_dist Where the distance of the nearest node is stored
+ * @param second_idx Where the index of the second nearest node is stored. -1 if it does not exist. It can be NULL
+ * @param second_dist Where the distance of the second nearest node is stored. It can be NULL
+ * @returns The index of the nearest node. -1 if every node is visited
+ */
+static int nearest_unvisited(instance *inst, int from, const int *visited, const kdtree_filter *filter, double *min_dist, int *second_idx, double *second_dist) {
+    if (filter == NULL) { return dist_row_argmin(inst, from, visited, min_dist, second_idx, second_dist); }
+
+    neighbor best[2];
+    int found = kdtree_search(inst, filter, from, second_idx ? 2 : 1, -1, best);
+    if (min_dist) { *min_dist = found > 0 ? best[0].dist : DBL_MAX; }
+    if (second_idx) { *second_idx = found > 1 ? best[1].node : -1; }
+    if (second_dist) { *second_dist = found > 1 ? best[1].dist : DBL_MAX; }
+    return found > 0 ? best[0].node : -1;
+}
+
+//Nearest Neighboor algorithm O(n log n) with the k-d tree, O(n^2) otherwise
 int greedy(instance *inst, int starting_node) {
     //Check if the starting node is valid
     if (starting_node >= inst->num_nodes) {return WRONG_STARTING_NODE;}
@@ -26,10 +54,19 @@ int greedy(instance *inst, int starting_node) {
     //Initialize array of visited nodes to 0
     int *visited = CALLOC(inst->num_nodes, int);
     double obj = 0;
+    
+    //The visited nodes are also removed from the k-d tree, when it is built
+    kdtree_filter tree_filter;
+    kdtree_filter *filter = NULL;
+    if (inst->tree.idx != NULL) {
+        kdtree_filter_init(inst, &tree_filter);
+        filter = &tree_filter;
+    }
 
     //Mark starting node as visited
     int curr = starting_node;
     visited[starting_node] = 1;
+    if (filter) { kdtree_filter_remove(inst, filter, starting_node); }
     int status = 0;
 
     //While there is some node to visit and we are within the time limit
@@ -43,16 +80,8 @@ int greedy(instance *inst, int starting_node) {
         }
 
         //For each not visited node, check which is the nearest to the current
-        int minidx = -1;
-        double mindist = DBL_MAX;
-        for (int i = 0; i < inst->num_nodes; i++) {
-            if (curr == i || visited[i]) { continue; }  // skip this node if visited
-            double currdist = calc_dist(curr, i, inst);
-            if (currdist < mindist) {
-                mindist = currdist;
-                minidx = i;
-            }
-        }
+        double mindist;
+        int minidx = nearest_unvisited(inst, curr, visited, filter, &mindist, NULL, NULL);
 
         // if we visited all nodes
         if (minidx == -1) {
@@ -67,6 +96,7 @@ int greedy(instance *inst, int starting_node) {
         inst->solution.edges[curr].j = minidx;
 
         visited[minidx] = 1;    //mark the selected node as visited
+        if (filter) { kdtree_filter_remove(inst, filter, minidx); }
         obj += mindist;         //update tour cost
         curr = minidx;          //new current node is the selected one
     }
@@ -74,11 +104,12 @@ int greedy(instance *inst, int starting_node) {
     obj += calc_dist(curr, starting_node, inst);
     inst->solution.obj_best = obj;  //save tour cost
     FREE(visited);
+    if (filter) { kdtree_filter_free(filter); }
     return status;
 }
 
 
-//Nearest Neighboor algorithm O(n^2) in which we choose whith some probability between the nearest and the 2° nearest node
+//Nearest Neighboor algorithm O(n log n) with the k-d tree, O(n^2) otherwise, in which we choose whith some probability between the nearest and the 2° nearest node
 int grasp(instance *inst, int starting_node) {
     //Check if the starting node is valid
     if (starting_node >= inst->num_nodes) {return WRONG_STARTING_NODE;}
@@ -90,10 +121,19 @@ int grasp(instance *inst, int starting_node) {
     //Initialize array of visited nodes to 0
     int *visited = CALLOC(inst->num_nodes, int);
     double obj = 0;
+    
+    //The visited nodes are also removed from the k-d tree, when it is built
+    kdtree_filter tree_filter;
+    kdtree_filter *filter = NULL;
+    if (inst->tree.idx != NULL) {
+        kdtree_filter_init(inst, &tree_filter);
+        filter = &tree_filter;
+    }
 
     //Mark starting node as visited
     int curr = starting_node;
     visited[starting_node] = 1;
+    if (filter) { kdtree_filter_remove(inst, filter, starting_node); }
     int status = 0;
 
     //While there is some node to visit and we are within the time limit
@@ -107,20 +147,10 @@ int grasp(instance *inst, int starting_node) {
         }
 
         //For each non visited node: pick the one that is the nearest, rembering also the second nearest
-        int first_minidx = -1; // The index of the nearest node 
-        double first_mindist = DBL_MAX; 
-        int second_minidx = first_minidx; // The index of the 2nd nearest node
-        double second_mindist = first_mindist;
-        for (int i = 0; i < inst->num_nodes; i++) {
-            if (curr == i || visited[i]) { continue; }
-            double currdist = calc_dist(curr, i, inst);
-            if (currdist < first_mindist) {       // update nearest and 2° nearest nodes
-                second_mindist = first_mindist;
-                second_minidx = first_minidx;
-                first_mindist = currdist;
-                first_minidx = i;
-            }
-        }
+        double first_mindist; 
+        int second_minidx; // The index of the 2nd nearest node
+        double second_mindist;
+        int first_minidx = nearest_unvisited(inst, curr, visited, filter, &first_mindist, &second_minidx, &second_mindist); // The index of the nearest node 
         
         //Now we have the 2 nearest nodes to the current one
         //We select with probability GRASP_RAND the nearest node
@@ -145,6 +175,7 @@ int grasp(instance *inst, int starting_node) {
         inst->solution.edges[curr].j = idxsel;
 
         visited[idxsel] = 1;        //mark the selected node as visited
+        if (filter) { kdtree_filter_remove(inst, filter, idxsel); }
         obj += distsel;             //update tour cost
         curr = idxsel;              //new current node is the selected one
     }
@@ -152,20 +183,31 @@ int grasp(instance *inst, int starting_node) {
     obj += calc_dist(curr, starting_node, inst);
     inst->solution.obj_best = obj;  //save tour cost
     FREE(visited);
+    if (filter) { kdtree_filter_free(filter); }
     return status;
 }
 
 
 //Wrapper function that calls the Nearest Neighboor algorithm
+int HEU_warm_start(instance *inst) {
+    if (inst->warm_tour == NULL) { return 0; }
+    order_to_edges(inst->warm_tour, inst->num_nodes, inst->solution.edges);
+    inst->solution.obj_best = calc_tour_cost(inst, inst->solution.edges);
+    if (inst->params.verbose >= 3) { LOG_I("Warm start tour cost: %0.0f", inst->solution.obj_best); }
+    return 1;
+}
+
 int HEU_greedy(instance *inst) {
+    if (HEU_warm_start(inst)) { return 0; }
     int status;
     status = greedy(inst, 0);   //Start from node 0
     return status;
 }
 
 
-//Multistart algorithm: start a nearest neighboor for each node O(n^3)
+//Multistart algorithm: start a nearest neighboor for each node O(n^2 log n) with the k-d tree, O(n^3) otherwise
 int HEU_Greedy_iter(instance *inst) {
+    if (HEU_warm_start(inst)) { return 0; }
     int maxiter = inst->num_nodes;
     int status = 0;
     double bestobj = DBL_MAX;
@@ -195,6 +237,7 @@ int HEU_Greedy_iter(instance *inst) {
             if(inst->params.verbose >= 4) {LOG_I("New Best: %f", inst->solution.obj_best);}
             bestobj = inst->solution.obj_best;  //update best solution
             memcpy(bestedges, inst->solution.edges, inst->num_nodes * sizeof(edge));
+            stream_incumbent(inst, bestobj, STREAM_NO_BOUND, bestedges);
         }
     }
 
@@ -204,10 +247,53 @@ int HEU_Greedy_iter(instance *inst) {
     return status;
 }
 
+/**
+ * Selection step of the extra mileage algorithm. For each edge (a, b) of the tour, the distances from a and b to
+ * all the nodes are computed with the row kernels and the extra mileage C_ac + C_cb - C_ab of each not visited node c
+ * is evaluated. Ties are broken as the node-major scan does: lowest node first, then lowest edge.
+ * 
+ * @param inst The instance pointer of the problem
+ * @param nodes_visited The flags of the nodes already in the tour
+ * @param edges_visited The edges of the tour
+ * @param num_visited The number of edges of the tour
+ * @param rows A buffer of 2 * num_nodes doubles used to store the distances rows
+ * @param best_node Where the node with the minimum extra mileage is stored
+ * @param min_mileage Where the minimum extra mileage is stored
+ * @returns The index in edges_visited of the edge with the minimum extra mileage. -1 if every node is visited
+ */
+static int extramileage_select(instance *inst, const int *nodes_visited, const edge *edges_visited, int num_visited, double *rows, int *best_node, double *min_mileage) {
+    double *row_a = rows;
+    double *row_b = rows + inst->num_nodes;
+    int best_edge_idx = -1;
+    *best_node = -1;
+    *min_mileage = DBL_MAX;
+
+    for (int j = 0; j < num_visited; j++) {
+        edge e = edges_visited[j];
+        int a = e.i;
+        int b = e.j;
+        double cost3 = calc_dist(a, b, inst);
+        dist_row(inst, a, 0, inst->num_nodes, row_a);
+        dist_row(inst, b, 0, inst->num_nodes, row_b);
+        for (int c = 0; c < inst->num_nodes; c++) {
+            if (nodes_visited[c]) { continue; }
+            double deltacost = row_a[c] + row_b[c] - cost3;   //Delta (a,b,c)= C_ac + C_cb - C_ab
+            if (deltacost < *min_mileage || (deltacost == *min_mileage && c < *best_node)) {
+                *min_mileage = deltacost;
+                *best_node = c;
+                best_edge_idx = j;
+            }
+        }
+    }
+    return best_edge_idx;
+}
+
 //Extramileage algorithm 
 int HEU_extramileage(instance *inst) {
+    if (HEU_warm_start(inst)) { return 0; }
     int *nodes_visited = CALLOC(inst->num_nodes, int); // Stores nodes visited in tour
     edge *edges_visited = CALLOC(inst->num_nodes, edge); // Stores the visited edges. Extra mileage alg will add a new edge every iteration until all the nodes are visited
+    double *rows = MALLOC(2 * inst->num_nodes, double); // Distances rows used in the selection step
     double obj = 0;
 
     //Chose node A and node B as the two farthest nodes
@@ -224,9 +310,11 @@ int HEU_extramileage(instance *inst) {
 
     //Search the farthest distance between nodes and save the indexes
     double max_dist = 0;
+    double *row = MALLOC(inst->num_nodes, double);
     for (int i = 0; i < inst->num_nodes; i++) {
+        dist_row(inst, i, i + 1, inst->num_nodes, row);
         for (int j = i + 1; j < inst->num_nodes; j++) {
-            double dist = calc_dist(i, j, inst);
+            double dist = row[j - i - 1];
             if (dist > max_dist) {
                 nodeA = i;
                 nodeB = j;
@@ -234,6 +322,7 @@ int HEU_extramileage(instance *inst) {
             }
         }
     }
+    FREE(row);
 
     int num_visited = 0;
     edge e1 = {.i = nodeA, .j = nodeB};
@@ -254,37 +343,15 @@ int HEU_extramileage(instance *inst) {
 
     //While there is some node not visited
     while (num_visited < inst->num_nodes) {
-        //For each not visited node i
-        double min_mileage = DBL_MAX;
-        edge best_edge;
-        int best_new_node_idx = -1;
-        int best_edge_idx = -1;
-
-        for (int i = 0; i < inst->num_nodes; i++) {
-            if (nodes_visited[i]) { continue; }
-            
-            //Selection Step: find the edge (i,j) nearest to the tour
-            for (int j = 0; j < num_visited; j++) {
-                edge e = edges_visited[j];
-                int a = e.i;
-                int b = e.j;
-                int c = i;
-                double cost1 = calc_dist(a, c, inst);
-                double cost2 = calc_dist(c, b, inst);
-                double cost3 = calc_dist(a, b, inst);
-                double deltacost = cost1 + cost2 - cost3;   //Delta (a,b,c)= C_ac + C_cb - C_ab
-                if (deltacost < min_mileage) {
-                    min_mileage = deltacost;
-                    best_edge = e;
-                    best_edge_idx = j;
-                    best_new_node_idx = i;
-                }
-            }
-        }
+        //Selection Step: find the node and the edge of the tour with the minimum extra mileage
+        double min_mileage;
+        int best_new_node_idx;
+        int best_edge_idx = extramileage_select(inst, nodes_visited, edges_visited, num_visited, rows, &best_new_node_idx, &min_mileage);
 
         if (best_edge_idx == -1) {
             break;
         }
+        edge best_edge = edges_visited[best_edge_idx];
 
         //Insertion Step: replace edge (i,j) with edges (i,k) and (k,j)
         edge e1;
@@ -310,6 +377,7 @@ int HEU_extramileage(instance *inst) {
     inst->solution.obj_best = obj;
     FREE(nodes_visited);
     FREE(edges_visited);
+    FREE(rows);
     return 0;
 }
 
@@ -343,6 +411,7 @@ int HEU_extramileage2(instance *inst) {
     }
     // initialized convex hull edges
     edge *edges_visited = CALLOC(inst->num_nodes, edge);
+    double *rows = MALLOC(2 * inst->num_nodes, double); // Distances rows used in the selection step
     double obj = 0;
     for (int i = 0; i < hsize - 1; i++) {
         edge e;
@@ -368,37 +437,15 @@ int HEU_extramileage2(instance *inst) {
 
     //While there is some node not visited
     while (num_visited < inst->num_nodes) {
-        //For each not visited node i
-        double min_mileage = DBL_MAX;
-        edge best_edge;
-        int best_new_node_idx = -1;
-        int best_edge_idx = -1;
-
-        for (int i = 0; i < inst->num_nodes; i++) {
-            if (nodes_visited[i]) { continue; }
-            
-            //Selection Step: find the edge (i,j) nearest to the tour
-            for (int j = 0; j < num_visited; j++) {
-                edge e = edges_visited[j];
-                int a = e.i;
-                int b = e.j;
-                int c = i;
-                double cost1 = calc_dist(a, c, inst);
-                double cost2 = calc_dist(c, b, inst);
-                double cost3 = calc_dist(a, b, inst);
-                double deltacost = cost1 + cost2 - cost3;   //Delta (a,b,c)= C_ac + C_cb - C_ab
-                if (deltacost < min_mileage) {
-                    min_mileage = deltacost;
-                    best_edge = e;
-                    best_edge_idx = j;
-                    best_new_node_idx = i;
-                }
-            }
-        }
+        //Selection Step: find the node and the edge of the tour with the minimum extra mileage
+        double min_mileage;
+        int best_new_node_idx;
+        int best_edge_idx = extramileage_select(inst, nodes_visited, edges_visited, num_visited, rows, &best_new_node_idx, &min_mileage);
 
         if (best_edge_idx == -1) {
             break;
         }
+        edge best_edge = edges_visited[best_edge_idx];
 
         //Insertion Step: replace edge (i,j) with edges (i,k) and (k,j)
         edge e1;
@@ -426,6 +473,7 @@ int HEU_extramileage2(instance *inst) {
     FREE(nodes_visited);
     FREE(hull);
     FREE(edges_visited);
+    FREE(rows);
     return 0;
 }
 
@@ -435,79 +483,90 @@ int HEU_extramileage2(instance *inst) {
 /////////////////////////////////////////////////////////////////////////
 
 //2opt internal swap
-int alg_2opt(instance *inst) {
+int alg_2opt_tour(instance *inst, array_tour *t, double *obj, int time_limit) {
     //Start counting time elapsed from now
     struct timeval start, end;
     gettimeofday(&start, 0);
-    double best_cost=inst->solution.obj_best;
+    double best_cost = *obj;
     int status = 0;
-    int *prev = MALLOC(inst->num_nodes, int);
-    MEMSET(prev, -1, inst->num_nodes, int);
-    for (int i = 0; i < inst->num_nodes; i++) {
-        prev[inst->solution.edges[i].j] = i;
-    }
+    dist_func dist = get_dist_func(inst); // Chosen once so the loops don't dispatch on the weight type
+    int_dist_func int_dist = get_int_dist_func(inst); // Not NULL with integer costs: the deltas are computed exactly in int64
 
     while(1) {
         //For each pair of nodes
         for (int i = 0; i < inst->num_nodes - 1; i++) {
             if (status == TIME_LIMIT_EXCEEDED) {break;}
+            //Check if we reach the time limit. A row of pairs takes much less than a second
+            gettimeofday(&end, 0);
+            double elapsed = get_elapsed_time(start, end);
+            if (time_limit > 0 && elapsed > time_limit) {
+                status = TIME_LIMIT_EXCEEDED;
+                LOG_I("2-opt heuristics time exceeded");
+                break;
+            }
+            int a = i;
+            int a1 = tour_next(t, a); //successor of a. It changes only with the moves
             for (int j = i+1; j < inst->num_nodes; j++) {
-                //Check if we reach the time limit
-                gettimeofday(&end, 0);
-                double elapsed = get_elapsed_time(start, end);
-                if (inst->params.time_limit > 0 && elapsed > inst->params.time_limit) {
-                    status = TIME_LIMIT_EXCEEDED;
-                    LOG_I("2-opt heuristics time exceeded");
-                    break;
-                }
-
-                int a = i;
                 int b = j;
-                int a1 = inst->solution.edges[a].j; //successor of a
-                int b1 = inst->solution.edges[b].j; //successor of b
+                int b1 = tour_next(t, b); //successor of b
 
                 // Skip non valid configurations
                 // a1 == b1 never occurs because the edges are repsresented as directed. a->a1 then a1->b so it cannot be a->a1 b->a1
                 if (a1 == b1 || a == b1 || b == a1) {continue;}
 
-                // Compute the delta. If < 0 it means there is a crossing
-                double delta = calc_dist(a, b, inst) + calc_dist(a1, b1, inst) - calc_dist(a, a1, inst) - calc_dist(b, b1, inst);
-                if (delta < 0) {
-                    //Swap the 2 edges
-                    int a1 = inst->solution.edges[a].j;
-                    int b1 = inst->solution.edges[b].j; 
-                    inst->solution.edges[a].j = b;
-                    inst->solution.edges[a1].j = b1;
-                    
-                    //Reverse the path from minb to a1
-                    reverse_path(inst, b, a1, prev);
+                // Compute the delta. If < 0 it means there is a crossing.
+                // With real costs the rounding errors could give tiny negative deltas, so EPS is used
+                double delta;
+                int improving;
+                if (int_dist) {
+                    long int_delta = (long) int_dist(a, b, inst) + int_dist(a1, b1, inst) - int_dist(a, a1, inst) - int_dist(b, b1, inst);
+                    delta = (double) int_delta;
+                    improving = int_delta < 0;
+                } else {
+                    delta = dist(a, b, inst) + dist(a1, b1, inst) - dist(a, a1, inst) - dist(b, b1, inst);
+                    improving = delta < -EPS;
+                }
+                if (improving) {
+                    //Swap the 2 edges: a->b and a1->b1, reversing the path from a1 to b
+                    tour_2opt_move(t, a, b);
+                    a1 = b;
                     
                     //update tour cost
-                    inst->solution.obj_best += delta;
+                    *obj += delta;
                 }
             }
         }
 
         // If couldn't find a crossing, stop the algorithm
-        if (inst->solution.obj_best >=best_cost) {break;}
+        if (*obj >= best_cost) {break;}
 
         //Update best cost seen till now
-        best_cost=inst->solution.obj_best;
+        best_cost = *obj;
         
     }
 
-    
-    FREE(prev);
+    return status;
+}
+
+int alg_2opt(instance *inst) {
+    array_tour t;
+    tour_init(&t, inst->num_nodes);
+    tour_from_edges(&t, inst->solution.edges);
+    int status = alg_2opt_tour(inst, &t, &inst->solution.obj_best, inst->params.time_limit);
+    tour_to_edges(&t, inst->solution.edges);
+    tour_free(&t);
     return status;
 }
 
 //Wrapper function that execute GRASP algorithm
 int HEU_Grasp(instance *inst) {
+    if (HEU_warm_start(inst)) { return 0; }
     return grasp(inst, 0);  //Execute GRASP starting from node 0
 }
 
 //MULTISTART algorithm for GRASP: start a GRASP for each node
 int HEU_Grasp_iter(instance *inst, int time_lim) {
+    if (HEU_warm_start(inst)) { return 0; }
     int status = 0;
     double bestobj = DBL_MAX;
     edge *bestedges = CALLOC(inst->num_nodes, edge);
@@ -535,6 +594,7 @@ int HEU_Grasp_iter(instance *inst, int time_lim) {
             }
             bestobj = inst->solution.obj_best;
             memcpy(bestedges, inst->solution.edges, inst->num_nodes * sizeof(edge));
+            stream_incumbent(inst, bestobj, STREAM_NO_BOUND, bestedges);
         }
     }
     inst->solution.obj_best = bestobj;
@@ -551,7 +611,7 @@ int HEU_2opt_grasp(instance *inst) {
         LOG_I("STARTED 2-OPT REFINEMENT");
     }
     plot_solution(inst);
-    status = alg_2opt(inst);
+    status = refine_solution(inst, NULL, 0);
     return status;
 }
 
@@ -564,7 +624,7 @@ int HEU_2opt_grasp_iter(instance *inst) {
         LOG_I("STARTED 2-OPT REFINEMENT");
     }
     plot_solution(inst);
-    status = alg_2opt(inst);
+    status = refine_solution(inst, NULL, 0);
     return status;
 }
 
@@ -576,7 +636,7 @@ int HEU_2opt_greedy(instance *inst) {
         LOG_I("STARTED 2-OPT REFINEMENT");
     }
     plot_solution(inst);
-    status = alg_2opt(inst);
+    status = refine_solution(inst, NULL, 0);
     return status;
 }
 
@@ -588,7 +648,7 @@ int HEU_2opt_greedy_iter(instance *inst) {
         LOG_I("STARTED 2-OPT REFINEMENT");
     }
     plot_solution(inst);
-    status = alg_2opt(inst);
+    status = refine_solution(inst, NULL, 0);
     return status;
 }
 
@@ -600,7 +660,102 @@ int HEU_2opt_extramileage(instance *inst) {
         LOG_I("STARTED 2-OPT REFINEMENT");
     }
     plot_solution(inst);
-    status = alg_2opt(inst);
+    status = refine_solution(inst, NULL, 0);
+    return status;
+}
+
+int HEU_3opt(instance *inst) {
+    if (inst->cand.list == NULL) {
+        if (inst->params.verbose >= 3) { LOG_I("No candidate lists: 2-opt is applied instead of 3-opt"); }
+        return alg_2opt(inst);
+    }
+    array_tour t;
+    tour_init(&t, inst->num_nodes);
+    tour_from_edges(&t, inst->solution.edges);
+    int status = alg_3opt_cand(inst, &t, &inst->solution.obj_best, NULL, 0, inst->params.time_limit);
+    tour_to_edges(&t, inst->solution.edges);
+    tour_free(&t);
+    return status;
+}
+
+//Grasp initialization + 3opt refinement
+int HEU_3opt_grasp(instance *inst) {
+    int status = HEU_Grasp(inst);
+    if(inst->params.verbose >= 5) {
+        LOG_I("COMPLETED GRASP");
+        LOG_I("STARTED 3-OPT REFINEMENT");
+    }
+    plot_solution(inst);
+    status = HEU_3opt(inst);
     return status;
 }
 
+//Multistart-Grasp initialization + 3opt refinement
+int HEU_3opt_grasp_iter(instance *inst) {
+    int grasp_time_lim = inst->params.time_limit / 5; // Dividing it is safe even when time limit is -1
+    int status = HEU_Grasp_iter(inst, grasp_time_lim);
+    if(inst->params.verbose >= 5) {
+        LOG_I("COMPLETED ITERATIVE GRASP");
+        LOG_I("STARTED 3-OPT REFINEMENT");
+    }
+    plot_solution(inst);
+    status = HEU_3opt(inst);
+    return status;
+}
+
+//Greedy initialization + 3opt refinement
+int HEU_3opt_greedy(instance *inst) {
+    int status = HEU_greedy(inst);
+    if(inst->params.verbose >= 5) {
+        LOG_I("COMPLETED GREEDY");
+        LOG_I("STARTED 3-OPT REFINEMENT");
+    }
+    plot_solution(inst);
+    status = HEU_3opt(inst);
+    return status;
+}
+
+//Multistart-Greedy initialization + 3opt refinement
+int HEU_3opt_greedy_iter(instance *inst) {
+    int status = HEU_Greedy_iter(inst);
+    if(inst->params.verbose >= 5) {
+        LOG_I("COMPLETED ITERATIVE GREEDY");
+        LOG_I("STARTED 3-OPT REFINEMENT");
+    }
+    plot_solution(inst);
+    status = HEU_3opt(inst);
+    return status;
+}
+
+//Extramil initialization + 3opt refinement
+int HEU_3opt_extramileage(instance *inst) {
+    int status = HEU_extramileage(inst);
+    if(inst->params.verbose >= 5) {
+        LOG_I("COMPLETED EXTRA MILEAGE");
+        LOG_I("STARTED 3-OPT REFINEMENT");
+    }
+    plot_solution(inst);
+    status = HEU_3opt(inst);
+    return status;
+}
+
+//Greedy initialization + Lin-Kernighan refinement
+int HEU_LK(instance *inst) {
+    int status = HEU_greedy(inst);
+    if(inst->params.verbose >= 5) {
+        LOG_I("COMPLETED GREEDY");
+        LOG_I("STARTED LIN-KERNIGHAN REFINEMENT");
+    }
+    plot_solution(inst);
+    if (inst->cand.list == NULL) {
+        if (inst->params.verbose >= 3) { LOG_I("No candidate lists: 2-opt is applied instead of Lin-Kernighan"); }
+        return alg_2opt(inst);
+    }
+    array_tour t;
+    tour_init(&t, inst->num_nodes);
+    tour_from_edges(&t, inst->solution.edges);
+    status = alg_lk(inst, &t, &inst->solution.obj_best, NULL, 0, inst->params.time_limit);
+    tour_to_edges(&t, inst->solution.edges);
+    tour_free(&t);
+    return status;
+}
@@ -0,0 +1,233 @@
+#include "incumbent.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define STREAM_FD_PREFIX "fd:"
+
+typedef struct {
+    double time;        // Seconds since the stream was opened
+    double obj;
+    double bound;
+    bool final;
+    long seq;           // Sequence number of the record
+} stream_record;
+
+typedef struct incumbent_stream {
+    char *path;                 // NULL when the stream writes to a given file descriptor
+    int fd;                     // -1 until the writer thread opens the file
+    bool with_tour;             // Whether the records have the successors of the nodes
+    int num_nodes;
+    struct timeval start;
+    pthread_t thread;
+    pthread_mutex_t lock;       // Guards all the fields below
+    pthread_cond_t changed;     // Signaled when a record is queued, when the stream is closing and when the writer ends
+    stream_record queue[STREAM_QUEUE_SIZE]; // Circular queue of the records to write
+    int head;
+    int count;
+    long next_seq;
+    long dropped;               // Records dropped because the queue was full
+    double last_obj;            // Objective of the last queued record
+    int *tour;                  // Successors of the newest queued tour
+    long tour_seq;              // Record of tour, -1 when tour is taken by the writer
+    int *writer_tour;           // Successors being written by the writer thread
+    bool closing;
+    bool finished;              // Whether the writer thread has ended
+    bool failed;                // Whether the file can't be opened or the reader is gone
+} incumbent_stream;
+
+// Formats a non negative integer in out. Returns the number of characters
+static int format_int(char *out, int value) {
+    char digits[12];
+    int len = 0;
+    do {
+        digits[len++] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+    for (int k = 0; k < len; k++) { out[k] = digits[len - 1 - k]; }
+    return len;
+}
+
+// Writes the whole buffer. Returns 0 when the reader is gone or the write fails
+static int write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t written = write(fd, data, len);
+        if (written < 0 && errno == EINTR) { continue; }
+        if (written <= 0) { return 0; }
+        data += written;
+        len -= written;
+    }
+    return 1;
+}
+
+static int write_record(incumbent_stream *s, const stream_record *r, const int *tour, char *buffer) {
+    int len = snprintf(buffer, 256, "{\"time\":%0.6f,\"obj\":%0.6f,\"bound\":", r->time, r->obj);
+    len += r->bound <= STREAM_NO_BOUND ? snprintf(buffer + len, 256, "null") : snprintf(buffer + len, 256, "%0.6f", r->bound);
+    len += snprintf(buffer + len, 256, ",\"final\":%s", r->final ? "true" : "false");
+    if (tour != NULL) {
+        len += snprintf(buffer + len, 256, ",\"succ\":[");
+        for (int i = 0; i < s->num_nodes; i++) {
+            len += format_int(buffer + len, tour[i]);
+            buffer[len++] = i + 1 < s->num_nodes ? ',' : ']';
+        }
+    }
+    buffer[len++] = '}';
+    buffer[len++] = '\n';
+    return write_all(s->fd, buffer, len);
+}
+
+static void *stream_writer(void *arg) {
+    incumbent_stream *s = arg;
+    // A reader which closes the pipe must not kill the program: the writes fail with EPIPE instead
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+    // Opening a named pipe waits for its reader, so it is done here and not by the solver
+    if (s->path != NULL) { s->fd = open(s->path, O_WRONLY | O_CREAT | O_APPEND, 0666); }
+    int ok = s->fd >= 0;
+    char *buffer = MALLOC(512 + (s->with_tour ? 12L * s->num_nodes : 0), char);
+
+    pthread_mutex_lock(&s->lock);
+    while (1) {
+        while (s->count == 0 && !s->closing) { pthread_cond_wait(&s->changed, &s->lock); }
+        if (s->count == 0) { break; } // Closing and all the records are written
+        stream_record r = s->queue[s->head];
+        s->head = (s->head + 1) % STREAM_QUEUE_SIZE;
+        s->count--;
+        int *tour = NULL;
+        if (s->with_tour && r.seq == s->tour_seq) {
+            // The queued tour is swapped with the one of the writer, so the solvers can queue the next tour meanwhile
+            tour = s->tour;
+            s->tour = s->writer_tour;
+            s->writer_tour = tour;
+            s->tour_seq = -1;
+        }
+        pthread_mutex_unlock(&s->lock);
+        if (ok) { ok = write_record(s, &r, tour, buffer); }
+        pthread_mutex_lock(&s->lock);
+    }
+    s->finished = true;
+    s->failed = !ok;
+    pthread_cond_broadcast(&s->changed);
+    pthread_mutex_unlock(&s->lock);
+
+    if (s->path != NULL && s->fd >= 0) { close(s->fd); }
+    FREE(buffer);
+    return NULL;
+}
+
+void open_incumbent_stream(instance *inst) {
+    const char *path = inst->params.stream_path;
+    if (path == NULL || inst->stream != NULL) { return; }
+
+    incumbent_stream *s = CALLOC(1, incumbent_stream);
+    if (strncmp(path, STREAM_FD_PREFIX, strlen(STREAM_FD_PREFIX)) == 0) {
+        s->fd = atoi(path + strlen(STREAM_FD_PREFIX));
+    } else {
+        s->fd = -1;
+        s->path = CALLOC(strlen(path) + 1, char);
+        memcpy(s->path, path, strlen(path));
+    }
+    s->with_tour = inst->params.stream_tour;
+    s->num_nodes = inst->num_nodes;
+    gettimeofday(&s->start, 0);
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->changed, NULL);
+    s->last_obj = CPX_INFBOUND;
+    s->tour_seq = -1;
+    if (s->with_tour) {
+        s->tour = MALLOC(s->num_nodes, int);
+        s->writer_tour = MALLOC(s->num_nodes, int);
+    }
+    if (pthread_create(&s->thread, NULL, stream_writer, s) != 0) { LOG_E("Unable to start the incumbent stream"); }
+    inst->stream = s;
+}
+
+// Queues a record. The tour is copied from the edges or from the successors, whichever is given
+static void push_record(incumbent_stream *s, double obj, double bound, bool final, const edge *edges, const int *succ) {
+    struct timeval now;
+    gettimeofday(&now, 0);
+    pthread_mutex_lock(&s->lock);
+    if (!final && obj >= s->last_obj) { // Not an improvement, e.g. a cplex thread which found a worse incumbent
+        pthread_mutex_unlock(&s->lock);
+        return;
+    }
+    if (s->count == STREAM_QUEUE_SIZE) { // The reader is too slow: the oldest record is dropped
+        s->head = (s->head + 1) % STREAM_QUEUE_SIZE;
+        s->count--;
+        s->dropped++;
+    }
+    stream_record *r = &s->queue[(s->head + s->count) % STREAM_QUEUE_SIZE];
+    r->time = get_elapsed_time(s->start, now);
+    r->obj = obj;
+    r->bound = bound;
+    r->final = final;
+    r->seq = s->next_seq++;
+    s->count++;
+    if (obj < s->last_obj) { s->last_obj = obj; }
+
+    if (s->with_tour && (edges != NULL || succ != NULL)) {
+        if (edges != NULL) {
+            for (int k = 0; k < s->num_nodes; k++) { s->tour[edges[k].i] = edges[k].j; }
+        } else {
+            memcpy(s->tour, succ, s->num_nodes * sizeof(int));
+        }
+        s->tour_seq = r->seq;
+    }
+    pthread_cond_signal(&s->changed);
+    pthread_mutex_unlock(&s->lock);
+}
+
+void stream_incumbent(instance *inst, double obj, double bound, const edge *edges) {
+    if (inst->stream == NULL) { return; }
+    push_record(inst->stream, obj, bound, false, edges, NULL);
+}
+
+void stream_incumbent_succ(instance *inst, double obj, double bound, const int *succ) {
+    if (inst->stream == NULL) { return; }
+    push_record(inst->stream, obj, bound, false, NULL, succ);
+}
+
+void close_incumbent_stream(instance *inst, double bound) {
+    incumbent_stream *s = inst->stream;
+    if (s == NULL) { return; }
+    inst->stream = NULL;
+    push_record(s, inst->solution.obj_best, bound, true, inst->solution.edges, NULL);
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += STREAM_CLOSE_TIMEOUT;
+    pthread_mutex_lock(&s->lock);
+    s->closing = true;
+    pthread_cond_broadcast(&s->changed);
+    int rc = 0;
+    while (!s->finished && rc != ETIMEDOUT) { rc = pthread_cond_timedwait(&s->changed, &s->lock, &deadline); }
+    bool finished = s->finished;
+    long dropped = s->dropped;
+    bool failed = s->failed;
+    pthread_mutex_unlock(&s->lock);
+
+    if (!finished) {
+        // The writer is blocked by the reader: it is left running with its data until the program ends
+        if (inst->params.verbose >= 3) { LOG_I("The incumbent stream is not read: its last records are dropped"); }
+        pthread_detach(s->thread);
+        return;
+    }
+    pthread_join(s->thread, NULL);
+    if (failed) { LOG_I("Unable to write the incumbent stream %s", inst->params.stream_path); }
+    if (dropped > 0 && inst->params.verbose >= 3) { LOG_I("%ld incumbent records dropped by the stream", dropped); }
+    pthread_mutex_destroy(&s->lock);
+    pthread_cond_destroy(&s->changed);
+    FREE(s->path);
+    FREE(s->tour);
+    FREE(s->writer_tour);
+    free(s);
+}
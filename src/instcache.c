@@ -0,0 +1,243 @@
+#include "instcache.h"
+
+#include "distfile.h"
+#include "tsplib.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Header of the cache file. The arrays start at DIST_MATRIX_ALIGNMENT bytes from the beginning of the file
+typedef struct {
+    char magic[8];          // INST_CACHE_MAGIC, without the terminating null character
+    int num_nodes;
+    int capacity;
+    int weight_type;
+    int weight_format;
+    int is_vrp;
+    int name_len;           // The length of the name, -1 when the instance has no name
+    long source_size;       // The size of the instance file when the cache was written
+    long source_mtime;      // The modification time in nanoseconds of the instance file when the cache was written
+    uint64_t source_hash;   // The hash_bytes of the instance file when the cache was written
+    long file_size;         // The size of the cache file
+} inst_cache_header;
+
+_Static_assert(sizeof(inst_cache_header) <= DIST_MATRIX_ALIGNMENT, "The header must fit before the aligned arrays");
+
+// Offsets of the arrays in the cache file. Each array starts at a multiple of DIST_MATRIX_ALIGNMENT
+typedef struct {
+    size_t x;       // x coordinates, double
+    size_t y;       // y coordinates, double
+    size_t demand;  // Demands, int
+    size_t depot;   // Depot flags, one byte each
+    size_t name;    // Name, without the terminating null character
+    size_t size;    // Size of the file
+} inst_cache_layout;
+
+static inline long mtime_ns(const struct stat *st) {
+    return (long) st->st_mtim.tv_sec * 1000000000L + st->st_mtim.tv_nsec;
+}
+
+static inline size_t align_up(size_t offset) {
+    return (offset + DIST_MATRIX_ALIGNMENT - 1) / DIST_MATRIX_ALIGNMENT * DIST_MATRIX_ALIGNMENT;
+}
+
+static inst_cache_layout cache_layout(int num_nodes, int name_len) {
+    inst_cache_layout layout;
+    layout.x = DIST_MATRIX_ALIGNMENT;
+    layout.y = align_up(layout.x + (size_t) num_nodes * sizeof(double));
+    layout.demand = align_up(layout.y + (size_t) num_nodes * sizeof(double));
+    layout.depot = align_up(layout.demand + (size_t) num_nodes * sizeof(int));
+    layout.name = align_up(layout.depot + (size_t) num_nodes);
+    layout.size = layout.name + (name_len > 0 ? name_len : 0);
+    return layout;
+}
+
+static inline uint64_t mix64(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+uint64_t hash_bytes(const void *data, size_t len) {
+    const unsigned char *p = data;
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ len;
+    size_t i = 0;
+    // The buffer is read in words of 8 bytes. memcpy avoids the unaligned loads
+    for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, p + i, sizeof(word));
+        h = (h ^ word) * 0x9FB21C651E98DF25ULL;
+        h ^= h >> 29;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, p + i, len - i);
+    return mix64(h ^ tail);
+}
+
+static char *cache_path(const char *path) {
+    size_t len = strlen(path) + strlen(INST_CACHE_EXT) + 1;
+    char *cache = CALLOC(len, char);
+    snprintf(cache, len, "%s%s", path, INST_CACHE_EXT);
+    return cache;
+}
+
+// Loads the instance from the cache if it matches the instance file. Returns 1 on success, 0 otherwise
+static int load_cache(instance *inst, const char *path, const struct stat *source, uint64_t hash) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) { return 0; }
+    inst_cache_header header;
+    struct stat st;
+    int valid = read(fd, &header, sizeof(header)) == sizeof(header) && fstat(fd, &st) == 0 &&
+                memcmp(header.magic, INST_CACHE_MAGIC, sizeof(header.magic)) == 0 &&
+                header.source_size == (long) source->st_size && header.source_mtime == mtime_ns(source) &&
+                header.source_hash == hash && header.num_nodes > 0 && header.name_len >= -1 &&
+                header.file_size == (long) st.st_size &&
+                cache_layout(header.num_nodes, header.name_len).size == (size_t) st.st_size;
+    char *map = valid ? mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd); // The mapping stays valid after closing the file
+    if (map == MAP_FAILED) { return 0; }
+
+    inst->num_nodes = header.num_nodes;
+    inst->weight_type = header.weight_type;
+    inst->weight_format = header.weight_format;
+    // The weights are not in the cache: without the distance file the instance must be parsed again
+    if (inst->weight_type == EXPLICIT && !map_edge_weights(inst, source)) {
+        munmap(map, st.st_size);
+        inst->num_nodes = -1;
+        inst->weight_type = -1;
+        inst->weight_format = -1;
+        return 0;
+    }
+    inst->capacity = header.capacity;
+    inst->is_vrp = header.is_vrp;
+
+    inst_cache_layout layout = cache_layout(header.num_nodes, header.name_len);
+    FREE(inst->name);
+    if (header.name_len >= 0) {
+        inst->name = CALLOC(header.name_len + 1, char);
+        memcpy(inst->name, map + layout.name, header.name_len);
+    }
+    const double *x = (const double *) (map + layout.x);
+    const double *y = (const double *) (map + layout.y);
+    const int *demand = (const int *) (map + layout.demand);
+    const unsigned char *depot = (const unsigned char *) (map + layout.depot);
+    FREE(inst->nodes);
+    inst->nodes = MALLOC(header.num_nodes, node);
+    for (int i = 0; i < header.num_nodes; i++) {
+        inst->nodes[i].x = x[i];
+        inst->nodes[i].y = y[i];
+        inst->nodes[i].demand = demand[i];
+        inst->nodes[i].is_depot = depot[i];
+    }
+    munmap(map, st.st_size);
+    return 1;
+}
+
+// Writes the instance in the cache. Returns 1 on success, 0 otherwise
+static int write_cache(const instance *inst, const char *path, const struct stat *source, uint64_t hash) {
+    int n = inst->num_nodes;
+    int name_len = inst->name != NULL ? (int) strlen(inst->name) : -1;
+    inst_cache_layout layout = cache_layout(n, name_len);
+    char *buffer = CALLOC(layout.size, char);
+
+    inst_cache_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, INST_CACHE_MAGIC, sizeof(header.magic));
+    header.num_nodes = n;
+    header.capacity = inst->capacity;
+    header.weight_type = inst->weight_type;
+    header.weight_format = inst->weight_format;
+    header.is_vrp = inst->is_vrp;
+    header.name_len = name_len;
+    header.source_size = (long) source->st_size;
+    header.source_mtime = mtime_ns(source);
+    header.source_hash = hash;
+    header.file_size = (long) layout.size;
+    memcpy(buffer, &header, sizeof(header));
+
+    double *x = (double *) (buffer + layout.x);
+    double *y = (double *) (buffer + layout.y);
+    int *demand = (int *) (buffer + layout.demand);
+    unsigned char *depot = (unsigned char *) (buffer + layout.depot);
+    for (int i = 0; i < n; i++) {
+        x[i] = inst->nodes[i].x;
+        y[i] = inst->nodes[i].y;
+        demand[i] = inst->nodes[i].demand;
+        depot[i] = inst->nodes[i].is_depot;
+    }
+    if (name_len > 0) { memcpy(buffer + layout.name, inst->name, name_len); }
+
+    // The cache is written to a temporary file and renamed, so the runs started at the same time
+    // on the same instance never map a partial cache
+    size_t tmp_len = strlen(path) + 32;
+    char *tmp_path = CALLOC(tmp_len, char);
+    snprintf(tmp_path, tmp_len, "%s.%ld", path, (long) getpid());
+    FILE *fp = fopen(tmp_path, "wb");
+    int ok = fp != NULL;
+    if (ok) {
+        ok = fwrite(buffer, 1, layout.size, fp) == layout.size;
+        ok = fclose(fp) == 0 && ok;
+        ok = ok && rename(tmp_path, path) == 0;
+        if (!ok) { remove(tmp_path); }
+    }
+    FREE(tmp_path);
+    FREE(buffer);
+    return ok;
+}
+
+void parse_tsplib_cached(instance *inst, const char *path) {
+    struct timeval start, end;
+    gettimeofday(&start, 0);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) { LOG_E("Unable to open the file %s", path); }
+    struct stat source;
+    if (fstat(fd, &source) != 0) { LOG_E("Unable to read the status of the file %s", path); }
+    size_t len = source.st_size;
+    const char *data = len > 0 ? mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0) : "";
+    close(fd); // The mapping stays valid after closing the file
+    if (data == MAP_FAILED) { LOG_E("Unable to map the file %s", path); }
+    if (len > 0) { madvise((void *) data, len, MADV_SEQUENTIAL); }
+
+    uint64_t hash = hash_bytes(data, len);
+    char *cache = cache_path(path);
+    if (load_cache(inst, cache, &source, hash)) {
+        gettimeofday(&end, 0);
+        if (inst->params.verbose >= 3) { LOG_I("Instance loaded from the cache %s in %0.3f seconds", cache, get_elapsed_time(start, end)); }
+    } else {
+        parse_tsplib(inst, data, len, &source);
+        if (inst->num_nodes > 0 && inst->nodes != NULL) {
+            int written = write_cache(inst, cache, &source, hash);
+            if (!written && inst->params.verbose >= 3) { LOG_I("Unable to write the instance cache %s", cache); }
+        }
+        gettimeofday(&end, 0);
+        if (inst->params.verbose >= 3) { LOG_I("Instance parsed in %0.3f seconds", get_elapsed_time(start, end)); }
+    }
+    if (len > 0) { munmap((void *) data, len); }
+    FREE(cache);
+}
+
+int write_instance_cache(const instance *inst, const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) { return 0; }
+    struct stat source;
+    if (fstat(fd, &source) != 0) {
+        close(fd);
+        return 0;
+    }
+    size_t len = source.st_size;
+    const char *data = len > 0 ? mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0) : "";
+    close(fd);
+    if (data == MAP_FAILED) { return 0; }
+
+    char *cache = cache_path(path);
+    int written = write_cache(inst, cache, &source, hash_bytes(data, len));
+    if (len > 0) { munmap((void *) data, len); }
+    FREE(cache);
+    return written;
+}
@@ -0,0 +1,234 @@
+#include "kdtree.h"
+
+#include "distutil.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+
+// The tree is implicit. The subtree [lo, hi) of the permutation idx has its node in idx[mid] with mid = (lo + hi) / 2.
+// The nodes in [lo, mid) have coordinate <= split on the axis of the subtree, the ones in (mid, hi) have coordinate >= split
+
+// State of a k nearest neighbors search
+typedef struct {
+    const instance *inst;
+    const kdtree_filter *filter;
+    dist_func dist;
+    neighbor *best;     // The neighbors found so far sorted by distance and index
+    int count;          // Number of neighbors found so far
+    int k;              // Number of neighbors to find
+    int from;           // The node whose neighbors are searched
+    int quadrant;       // The quadrant where the neighbors are searched. -1 means everywhere
+    double x;           // Coordinates of node "from"
+    double y;
+} knn_query;
+
+static inline double coord(const node *p, int axis) {
+    return axis == 0 ? p->x : p->y;
+}
+
+// Quadrant of the point (x, y) with respect to the point (x0, y0). Bit 0 is set when x < x0, bit 1 when y < y0
+static inline int quadrant_of(double x0, double y0, double x, double y) {
+    return (x < x0 ? 1 : 0) | (y < y0 ? 2 : 0);
+}
+
+// Whether the subtree with the given side of the split can contain points of the query's quadrant
+static inline int quadrant_reachable(const knn_query *q, int axis, double split, int left_side) {
+    if (q->quadrant < 0) { return 1; }
+    int below = (q->quadrant >> axis) & 1; // The quadrant needs coordinates lower than the query's one
+    double q_coord = axis == 0 ? q->x : q->y;
+    if (left_side) { return below || split >= q_coord; } // Left side has coordinates <= split
+    return !below || split < q_coord;                    // Right side has coordinates >= split
+}
+
+// Lower bound of the distance between two nodes whose coordinates on one axis differ by gap.
+// It is the distance of the instance computed on the same floating point operations, so it's exact
+static double gap_bound(const instance *inst, double gap) {
+    node p1 = {0};
+    node p2 = {0};
+    p2.x = gap;
+    int integer = inst->params.integer_cost;
+    double bound;
+    if (inst->weight_type == ATT) {
+        bound = calc_pseudo_euc(p1, p2, integer);
+    } else if (inst->weight_type == MAN_2D) {
+        bound = calc_man2d(p1, p2, integer);
+    } else if (inst->weight_type == MAX_2D) {
+        bound = calc_max2d(p1, p2, integer);
+    } else if (inst->weight_type == CEIL_2D) {
+        bound = calc_ceil2d(p1, p2);
+    } else {
+        bound = calc_euc2d(p1, p2, integer);
+    }
+    // The distances read from a float matrix are rounded, so the bound must be rounded in the same way
+    if (inst->dist.data != NULL && inst->dist.type == DIST_MATRIX_FLOAT) { bound = (float) bound; }
+    return bound;
+}
+
+// Inserts the node in the sorted list of the query if it is among the k nearest ones. Ties are broken by index
+static void knn_insert(knn_query *q, int node, double dist) {
+    if (q->count == q->k) {
+        neighbor worst = q->best[q->k - 1];
+        if (dist > worst.dist || (dist == worst.dist && node > worst.node)) { return; }
+        q->count--;
+    }
+    int pos = q->count;
+    while (pos > 0 && (q->best[pos - 1].dist > dist || (q->best[pos - 1].dist == dist && q->best[pos - 1].node > node))) {
+        q->best[pos] = q->best[pos - 1];
+        pos--;
+    }
+    q->best[pos].node = node;
+    q->best[pos].dist = dist;
+    q->count++;
+}
+
+static void search(knn_query *q, int lo, int hi) {
+    if (hi <= lo) { return; }
+    int mid = lo + (hi - lo) / 2;
+    const kdtree *tree = &q->inst->tree;
+    if (q->filter && q->filter->count[mid] == 0) { return; } // Every node of the subtree is removed
+
+    int p = tree->idx[mid];
+    const node *pn = &q->inst->nodes[p];
+    if (p != q->from && !(q->filter && q->filter->removed[p]) &&
+        (q->quadrant < 0 || quadrant_of(q->x, q->y, pn->x, pn->y) == q->quadrant)) {
+        knn_insert(q, p, q->dist(q->from, p, (instance *) q->inst));
+    }
+
+    int axis = tree->axis[mid];
+    double split = coord(pn, axis);
+    double diff = (axis == 0 ? q->x : q->y) - split;
+    int near_left = diff < 0;
+    // The nearest side first so the far side is likely pruned
+    if (quadrant_reachable(q, axis, split, near_left)) {
+        if (near_left) { search(q, lo, mid); }
+        else { search(q, mid + 1, hi); }
+    }
+    // Every node on the far side is at least |diff| away on this axis. With the same bound a node
+    // with lower index could still be found, so the side is skipped only when the bound is greater
+    if (q->count == q->k && gap_bound(q->inst, fabs(diff)) > q->best[q->k - 1].dist) { return; }
+    if (quadrant_reachable(q, axis, split, !near_left)) {
+        if (near_left) { search(q, mid + 1, hi); }
+        else { search(q, lo, mid); }
+    }
+}
+
+// Partially sorts idx[lo, hi) on the axis so that idx[nth] is the node it would have if sorted
+static void select_nth(const node *nodes, int *idx, int lo, int hi, int nth, int axis) {
+    hi--;
+    while (lo < hi) {
+        // Median of three pivot
+        int mid = lo + (hi - lo) / 2;
+        double a = coord(&nodes[idx[lo]], axis), b = coord(&nodes[idx[mid]], axis), c = coord(&nodes[idx[hi]], axis);
+        double pivot = a < b ? (b < c ? b : (a < c ? c : a)) : (a < c ? a : (b < c ? c : b));
+        int i = lo, j = hi;
+        while (i <= j) {
+            while (coord(&nodes[idx[i]], axis) < pivot) { i++; }
+            while (coord(&nodes[idx[j]], axis) > pivot) { j--; }
+            if (i <= j) {
+                int tmp = idx[i]; idx[i] = idx[j]; idx[j] = tmp;
+                i++;
+                j--;
+            }
+        }
+        if (nth <= j) { hi = j; }
+        else if (nth >= i) { lo = i; }
+        else { break; }
+    }
+}
+
+static void build(kdtree *tree, const node *nodes, int lo, int hi) {
+    if (hi - lo <= 1) {
+        if (hi > lo) { tree->axis[lo] = 0; }
+        return;
+    }
+    // Splitting on the axis with the largest spread works better on clustered instances
+    double min_x = DBL_MAX, max_x = -DBL_MAX, min_y = DBL_MAX, max_y = -DBL_MAX;
+    for (int i = lo; i < hi; i++) {
+        const node *p = &nodes[tree->idx[i]];
+        min_x = dmin(min_x, p->x);
+        max_x = dmax(max_x, p->x);
+        min_y = dmin(min_y, p->y);
+        max_y = dmax(max_y, p->y);
+    }
+    int axis = max_y - min_y > max_x - min_x ? 1 : 0;
+    int mid = lo + (hi - lo) / 2;
+    select_nth(nodes, tree->idx, lo, hi, mid, axis);
+    tree->axis[mid] = axis;
+    build(tree, nodes, lo, mid);
+    build(tree, nodes, mid + 1, hi);
+}
+
+// Stores the size of each subtree in count
+static void subtree_sizes(int *count, int lo, int hi) {
+    if (hi <= lo) { return; }
+    int mid = lo + (hi - lo) / 2;
+    count[mid] = hi - lo;
+    subtree_sizes(count, lo, mid);
+    subtree_sizes(count, mid + 1, hi);
+}
+
+int build_kdtree(instance *inst) {
+    inst->tree.idx = NULL;
+    inst->tree.pos = NULL;
+    inst->tree.axis = NULL;
+    inst->tree.size = NULL;
+    // GEO coordinates are angles, not planar points, and EXPLICIT instances have no coordinates
+    if (inst->weight_type == GEO || inst->weight_type == EXPLICIT || inst->num_nodes < 1) { return 0; }
+
+    int n = inst->num_nodes;
+    kdtree *tree = &inst->tree;
+    tree->idx = MALLOC(n, int);
+    tree->pos = MALLOC(n, int);
+    tree->axis = MALLOC(n, unsigned char);
+    tree->size = MALLOC(n, int);
+    for (int i = 0; i < n; i++) { tree->idx[i] = i; }
+    build(tree, inst->nodes, 0, n);
+    for (int i = 0; i < n; i++) { tree->pos[tree->idx[i]] = i; }
+    subtree_sizes(tree->size, 0, n);
+    return 1;
+}
+
+int kdtree_search(const instance *inst, const kdtree_filter *filter, int from, int k, int quadrant, neighbor *best) {
+    if (k <= 0) { return 0; }
+    knn_query q;
+    q.inst = inst;
+    q.filter = filter;
+    q.dist = get_dist_func((instance *) inst);
+    q.best = best;
+    q.count = 0;
+    q.k = k;
+    q.from = from;
+    q.quadrant = quadrant;
+    q.x = inst->nodes[from].x;
+    q.y = inst->nodes[from].y;
+    search(&q, 0, inst->num_nodes);
+    return q.count;
+}
+
+void kdtree_filter_init(const instance *inst, kdtree_filter *filter) {
+    filter->count = MALLOC(inst->num_nodes, int);
+    filter->removed = CALLOC(inst->num_nodes, bool);
+    memcpy(filter->count, inst->tree.size, sizeof(int) * inst->num_nodes);
+}
+
+void kdtree_filter_remove(const instance *inst, kdtree_filter *filter, int node) {
+    if (filter->removed[node]) { return; }
+    filter->removed[node] = true;
+    // Updating the counts of the subtrees from the root to the slot of the node
+    int target = inst->tree.pos[node];
+    int lo = 0;
+    int hi = inst->num_nodes;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        filter->count[mid]--;
+        if (mid == target) { break; }
+        if (target < mid) { hi = mid; }
+        else { lo = mid + 1; }
+    }
+}
+
+void kdtree_filter_free(kdtree_filter *filter) {
+    FREE(filter->count);
+    FREE(filter->removed);
+}
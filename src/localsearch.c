@@ -0,0 +1,445 @@
+#include "localsearch.h"
+
+#include "candidates.h"
+#include "distutil.h"
+#include "heuristics.h"
+
+// The moves tried by a descent
+#define LS_MOVE_2OPT 1
+#define LS_MOVE_OROPT 2
+#define LS_MOVE_3OPT 4
+#define LS_MOVE_LK 8
+
+#define LK_MAX_DEPTH 50         // The most 2-opt steps of a Lin-Kernighan move
+#define LK_BACKTRACK_LEVELS 4   // The first steps try more alternatives: together they span the sequential 5-opt moves
+#define LK_MAX_BREADTH 5
+static const int lk_breadth[LK_BACKTRACK_LEVELS] = {LK_MAX_BREADTH, 3, 2, 2}; // The deeper steps take only the best one
+
+// FIFO queue of the active nodes. A node is queued at most once
+typedef struct {
+    int *nodes;         // Circular buffer of n entries
+    bool *queued;       // Whether each node is in the queue, i.e. its don't-look bit is not set
+    int head;
+    int count;
+    int n;
+} active_queue;
+
+// The steps applied by the current Lin-Kernighan move, so the ones after its best closing can be undone
+typedef struct {
+    int t1;
+    int depth;
+    int first[LK_MAX_DEPTH];    // Each step reversed the path which now goes from first to last
+    int last[LK_MAX_DEPTH];
+    int added[LK_MAX_DEPTH];    // Each step added the edge (last, added)
+} lk_move;
+
+// The data shared by the moves of a local search
+typedef struct {
+    instance *inst;
+    dist_func dist;
+    int_dist_func int_dist;
+    double threshold;   // A move improves the tour when its delta is below it: 0 with integer costs, -EPS otherwise
+    active_queue queue;
+} ls_context;
+
+static inline void queue_push(active_queue *q, int node) {
+    if (q->queued[node]) { return; }
+    q->queued[node] = true;
+    int tail = q->head + q->count;
+    q->nodes[tail >= q->n ? tail - q->n : tail] = node;
+    q->count++;
+}
+
+static inline int queue_pop(active_queue *q) {
+    int node = q->nodes[q->head];
+    q->head = q->head + 1 == q->n ? 0 : q->head + 1;
+    q->count--;
+    q->queued[node] = false;
+    return node;
+}
+
+// Queues the active nodes, or every node in tour order when active is NULL
+static void ls_init(ls_context *ls, instance *inst, const array_tour *t, const int *active, int num_active) {
+    ls->inst = inst;
+    ls->dist = get_dist_func(inst);
+    ls->int_dist = get_int_dist_func(inst);
+    ls->threshold = ls->int_dist ? 0 : -EPS; // With real costs the rounding errors could give tiny negative deltas
+    active_queue *q = &ls->queue;
+    q->n = t->n;
+    q->nodes = MALLOC(t->n, int);
+    q->queued = CALLOC(t->n, bool);
+    q->head = 0;
+    q->count = 0;
+    if (active == NULL) {
+        for (int k = 0; k < t->n; k++) { queue_push(q, t->order[k]); }
+    } else {
+        for (int k = 0; k < num_active; k++) { queue_push(q, active[k]); }
+    }
+}
+
+static void ls_free(ls_context *ls) {
+    FREE(ls->queue.nodes);
+    FREE(ls->queue.queued);
+}
+
+// Cost of the edge (i, j). With integer costs the sums of the costs are exact in double
+static inline double ls_cost(const ls_context *ls, int i, int j) {
+    return ls->int_dist ? (double) ls->int_dist(i, j, ls->inst) : ls->dist(i, j, ls->inst);
+}
+
+// Tries the 2-opt moves which remove an edge of node a. Returns 1 if a move is applied
+static int try_2opt(ls_context *ls, array_tour *t, int a, double *obj) {
+    for (int dir = 0; dir < 2; dir++) {
+        // dir 0 removes the edge (a, next(a)), dir 1 the edge (prev(a), a)
+        int a1 = dir == 0 ? tour_next(t, a) : tour_prev(t, a);
+        double d_a = ls_cost(ls, a, a1);
+        int count;
+        const neighbor *cand = candidate_neighbors(ls->inst, a, &count);
+        for (int k = 0; k < count; k++) {
+            int c = cand[k].node;
+            double d_ac = ls_cost(ls, a, c);
+            if (d_ac >= d_a) { break; } // The candidates are sorted by distance: no other one gives a positive gain
+            int c1 = dir == 0 ? tour_next(t, c) : tour_prev(t, c);
+            if (c == a1 || c1 == a) { continue; }
+            double delta = d_ac + ls_cost(ls, a1, c1) - d_a - ls_cost(ls, c, c1);
+            if (delta < ls->threshold) {
+                // The edges (a, c) and (a1, c1) replace (a, a1) and (c, c1)
+                if (dir == 0) {
+                    tour_2opt_move(t, a, c);
+                } else {
+                    tour_2opt_move(t, a1, c1);
+                }
+                *obj += delta;
+                queue_push(&ls->queue, a);
+                queue_push(&ls->queue, a1);
+                queue_push(&ls->queue, c);
+                queue_push(&ls->queue, c1);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+// Moves the segment which goes from s1 to s2 between u and next(u), reversed if reversed is true.
+// The tour p s1..s2 q X u v Y becomes p q X u s1..s2 v Y with at most three reversals
+static void move_segment(array_tour *t, int s1, int s2, int u, bool reversed) {
+    int q = tour_next(t, s2);
+    tour_reverse(t, s1, u);     // p u X' q s2..s1 v Y
+    tour_reverse(t, u, q);      // p q X u s2..s1 v Y
+    if (!reversed) { tour_reverse(t, s2, s1); }
+}
+
+// Tries the Or-opt moves of the segments of 1 to OROPT_MAX_LEN nodes which have node a at one end.
+// The segment is moved next to a candidate neighbor c of a, so that the new edge (c, a) is shorter than
+// the edge which connects a to the rest of the tour. Returns 1 if a move is applied
+static int try_oropt(ls_context *ls, array_tour *t, int a, double *obj) {
+    if (t->n < OROPT_MAX_LEN + 3) { return 0; } // The segment and its two neighbors must leave an edge to insert it
+    int count;
+    const neighbor *cand = candidate_neighbors(ls->inst, a, &count);
+    for (int dir = 0; dir < 2; dir++) {
+        // dir 0: a is the first node of the segment, which extends forward. dir 1: a is the last node, the segment extends backward
+        int seg[OROPT_MAX_LEN];
+        seg[0] = a;
+        for (int len = 1; len <= OROPT_MAX_LEN; len++) {
+            if (len > 1) { seg[len - 1] = dir == 0 ? tour_next(t, seg[len - 2]) : tour_prev(t, seg[len - 2]); }
+            int s1 = dir == 0 ? a : seg[len - 1];
+            int s2 = dir == 0 ? seg[len - 1] : a;
+            int p = tour_prev(t, s1);
+            int q = tour_next(t, s2);
+            int outer = dir == 0 ? p : q; // The neighbor of a out of the segment
+            double d_outer = ls_cost(ls, outer, a);
+            double removal = ls_cost(ls, p, q) - ls_cost(ls, p, s1) - ls_cost(ls, s2, q);
+            for (int k = 0; k < count; k++) {
+                int c = cand[k].node;
+                double d_ac = ls_cost(ls, a, c);
+                if (d_ac >= d_outer) { break; } // The candidates are sorted by distance: no other one gives a positive gain
+                bool in_segment = false;
+                for (int m = 0; m < len; m++) { in_segment = in_segment || seg[m] == c; }
+                if (in_segment) { continue; }
+                for (int side = 0; side < 2; side++) {
+                    // The segment goes between u and v = next(u), with a next to c
+                    int e = side == 0 ? tour_next(t, c) : tour_prev(t, c);
+                    bool e_in_segment = false;
+                    for (int m = 0; m < len; m++) { e_in_segment = e_in_segment || seg[m] == e; }
+                    if (e_in_segment) { continue; }
+                    int u = side == 0 ? c : e;
+                    int v = side == 0 ? e : c;
+                    int z = seg[len - 1]; // The other end of the segment, next to e
+                    double delta = removal + d_ac + ls_cost(ls, z, e) - ls_cost(ls, u, v);
+                    if (delta < ls->threshold) {
+                        // a is next to u when it is the first node after u: the segment is reversed when a is not s1
+                        bool reversed = side == 0 ? a != s1 : a != s2;
+                        move_segment(t, s1, s2, u, reversed);
+                        *obj += delta;
+                        queue_push(&ls->queue, p);
+                        queue_push(&ls->queue, q);
+                        queue_push(&ls->queue, s1);
+                        queue_push(&ls->queue, s2);
+                        queue_push(&ls->queue, u);
+                        queue_push(&ls->queue, v);
+                        return 1;
+                    }
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+// Tries the sequential 3-opt moves which remove the edge (t1, t2), with t2 = next(t1): the edges (t2, t3),
+// (t4, t5) and (t6, t1) replace (t1, t2), (t3, t4) and (t5, t6), with t3 and t5 in the candidate lists of t2
+// and t4. The partial gain must stay positive after each added edge. Returns 1 if a move is applied
+static int try_3opt_forward(ls_context *ls, array_tour *t, int t1, double *obj) {
+    int t2 = tour_next(t, t1);
+    double d_12 = ls_cost(ls, t1, t2);
+    int count2, count4;
+    const neighbor *cand2 = candidate_neighbors(ls->inst, t2, &count2);
+    for (int k = 0; k < count2; k++) {
+        int t3 = cand2[k].node;
+        double g1 = d_12 - ls_cost(ls, t2, t3);
+        if (g1 <= 0) { break; } // The candidates are sorted by distance: no other one gives a positive gain
+        if (t3 == t1 || t3 == tour_next(t, t2)) { continue; } // (t2, t3) is already in the tour
+
+        for (int side = 0; side < 2; side++) {
+            // side 0: t4 = prev(t3), the move can be closed as a 2-opt move. side 1: t4 = next(t3), the path
+            // t2..t3 becomes a cycle which the third exchange opens again (the or3opt moves)
+            int t4 = side == 0 ? tour_prev(t, t3) : tour_next(t, t3);
+            double g2 = g1 + ls_cost(ls, t3, t4);
+            if (side == 0) {
+                double delta = ls_cost(ls, t4, t1) - g2;
+                if (delta < ls->threshold) {
+                    tour_2opt_move(t, t1, t4); // t1 t2..t4 t3 -> t1 t4..t2 t3
+                    *obj += delta;
+                    queue_push(&ls->queue, t1);
+                    queue_push(&ls->queue, t2);
+                    queue_push(&ls->queue, t3);
+                    queue_push(&ls->queue, t4);
+                    return 1;
+                }
+            }
+            const neighbor *cand4 = candidate_neighbors(ls->inst, t4, &count4);
+            for (int h = 0; h < count4; h++) {
+                int t5 = cand4[h].node;
+                double g3 = g2 - ls_cost(ls, t4, t5);
+                if (g3 <= 0) { break; }
+                if (t5 == t1 || t5 == t3 || t5 == tour_next(t, t4) || t5 == tour_prev(t, t4)) { continue; }
+                int t6;
+                if (side == 0) {
+                    // The path t4..t2 t3..t1 is closed by removing the edge of t5 towards t4
+                    t6 = tour_between(t, t2, t5, t4) ? tour_next(t, t5) : tour_prev(t, t5);
+                } else {
+                    // t5 must be on the cycle t2..t3. Both its edges give a tour
+                    if (!tour_between(t, t2, t5, t3)) { continue; }
+                    t6 = tour_next(t, t5);
+                }
+                for (int tries = side == 0 ? 1 : 2; tries > 0; tries--) {
+                    if (side == 1 && tries == 1) { t6 = tour_prev(t, t5); }
+                    if (side == 1 && (t6 == t4 || t6 == t1)) { continue; } // The edge (t5, t6) leaves the cycle
+                    double delta = ls_cost(ls, t6, t1) - ls_cost(ls, t5, t6) - g3;
+                    if (delta >= ls->threshold) { continue; }
+                    if (side == 0 && tour_between(t, t2, t5, t4)) {
+                        // t1 t2..t5 t6..t4 t3 -> t1 t6..t4 t5..t2 t3
+                        tour_reverse(t, t2, t4);
+                        tour_reverse(t, t4, t6);
+                    } else if (side == 0) {
+                        // t1 t2..t4 t3..t6 t5 -> t1 t6..t3 t2..t4 t5
+                        tour_reverse(t, t2, t6);
+                        tour_reverse(t, t4, t2);
+                    } else if (t6 == tour_next(t, t5)) {
+                        // The pure segment insertion: t1 t2..t5 t6..t3 t4 -> t1 t6..t3 t2..t5 t4
+                        tour_reverse(t, t2, t3);
+                        tour_reverse(t, t3, t6);
+                        tour_reverse(t, t5, t2);
+                    } else {
+                        // t1 t2..t6 t5..t3 t4 -> t1 t6..t2 t3..t5 t4
+                        tour_reverse(t, t2, t6);
+                        tour_reverse(t, t5, t3);
+                    }
+                    *obj += delta;
+                    queue_push(&ls->queue, t1);
+                    queue_push(&ls->queue, t2);
+                    queue_push(&ls->queue, t3);
+                    queue_push(&ls->queue, t4);
+                    queue_push(&ls->queue, t5);
+                    queue_push(&ls->queue, t6);
+                    return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+// Tries the 3-opt moves which remove an edge of node a. The moves which remove (prev(a), a) are the ones
+// which remove (a, next(a)) in the tour visited backwards, so the orientation is flipped instead of
+// duplicating every case. Returns 1 if a move is applied
+static int try_3opt(ls_context *ls, array_tour *t, int a, double *obj) {
+    for (int dir = 0; dir < 2; dir++) {
+        if (dir == 1) { t->reversed = !t->reversed; }
+        int applied = try_3opt_forward(ls, t, a, obj);
+        if (dir == 1) { t->reversed = !t->reversed; }
+        if (applied) { return 1; }
+    }
+    return 0;
+}
+
+// Undoes the steps of the move after the first depth ones
+static void lk_undo(array_tour *t, lk_move *m, int depth) {
+    while (m->depth > depth) {
+        m->depth--;
+        tour_reverse(t, m->first[m->depth], m->last[m->depth]);
+    }
+}
+
+// Whether the edge (i, j) was added by a step of the move: it must not be removed again
+static bool lk_added(const lk_move *m, int i, int j) {
+    for (int k = 0; k < m->depth; k++) {
+        if ((m->last[k] == i && m->added[k] == j) || (m->last[k] == j && m->added[k] == i)) { return true; }
+    }
+    return false;
+}
+
+// Extends the move from a tour where t2 = next(t1), and g is the cost of the removed edges minus the cost of the
+// added ones, the edge (t1, t2) included. Each step adds (t2, t3) with t3 in the candidate list of t2 and removes
+// (t4, t3), t4 = prev(t3): reversing t2..t4 gives a tour again, where t4 = next(t1) and (t1, t4) closes the move.
+// The best closed move found from here is kept applied and its gain returned; 0 when none improves the tour
+static double lk_search(ls_context *ls, array_tour *t, lk_move *m, int t2, double g) {
+    int level = m->depth;
+    if (level >= LK_MAX_DEPTH) { return 0; }
+    int t1 = m->t1;
+    int breadth = level < LK_BACKTRACK_LEVELS ? lk_breadth[level] : 1;
+
+    // The alternatives with a positive partial gain, sorted by the gain of the step
+    int alt[LK_MAX_BREADTH];
+    double alt_gain[LK_MAX_BREADTH];
+    int num_alt = 0;
+    int count;
+    const neighbor *cand = candidate_neighbors(ls->inst, t2, &count);
+    for (int k = 0; k < count; k++) {
+        int t3 = cand[k].node;
+        double d_23 = ls_cost(ls, t2, t3);
+        if (g - d_23 <= 0) { break; } // The candidates are sorted by distance: no other one has a positive gain
+        if (t3 == t1 || t3 == tour_next(t, t2)) { continue; }
+        int t4 = tour_prev(t, t3);
+        if (lk_added(m, t3, t4)) { continue; }
+        double step_gain = ls_cost(ls, t3, t4) - d_23;
+        if (num_alt == breadth && step_gain <= alt_gain[breadth - 1]) { continue; }
+        int pos = num_alt < breadth ? num_alt++ : breadth - 1;
+        for (; pos > 0 && alt_gain[pos - 1] < step_gain; pos--) {
+            alt[pos] = alt[pos - 1];
+            alt_gain[pos] = alt_gain[pos - 1];
+        }
+        alt[pos] = t3;
+        alt_gain[pos] = step_gain;
+    }
+
+    for (int k = 0; k < num_alt; k++) {
+        int t3 = alt[k];
+        int t4 = tour_prev(t, t3);
+        tour_2opt_move(t, t1, t4); // t1 t2..t4 t3 -> t1 t4..t2 t3
+        m->first[level] = t4;
+        m->last[level] = t2;
+        m->added[level] = t3;
+        m->depth++;
+        double g2 = g + alt_gain[k];
+        double closed = g2 - ls_cost(ls, t4, t1);
+        double deeper = lk_search(ls, t, m, t4, g2);
+        if (deeper > 0 && deeper > closed) { return deeper; }
+        lk_undo(t, m, level + 1);
+        if (closed > -ls->threshold) { return closed; }
+        lk_undo(t, m, level);
+    }
+    return 0;
+}
+
+// Tries the Lin-Kernighan moves which start by removing an edge of node a, in both orientations as in try_3opt.
+// Returns 1 if a move is applied
+static int try_lk(ls_context *ls, array_tour *t, int a, double *obj) {
+    lk_move m;
+    for (int dir = 0; dir < 2; dir++) {
+        if (dir == 1) { t->reversed = !t->reversed; }
+        m.t1 = a;
+        m.depth = 0;
+        int t2 = tour_next(t, a);
+        double gain = lk_search(ls, t, &m, t2, ls_cost(ls, a, t2));
+        if (dir == 1) { t->reversed = !t->reversed; }
+        if (gain > 0) {
+            *obj -= gain;
+            queue_push(&ls->queue, a);
+            queue_push(&ls->queue, t2);
+            for (int k = 0; k < m.depth; k++) {
+                queue_push(&ls->queue, m.first[k]);
+                queue_push(&ls->queue, m.added[k]);
+            }
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Processes the active nodes with the moves until the queue is empty or the time limit is reached
+static int descent(instance *inst, array_tour *t, double *obj, const int *active, int num_active, int time_limit, int moves) {
+    struct timeval start, end;
+    gettimeofday(&start, 0);
+    ls_context ls;
+    ls_init(&ls, inst, t, active, num_active);
+    int status = 0;
+    long processed = 0;
+    while (ls.queue.count > 0) {
+        if (time_limit > 0 && ++processed % LS_TIME_CHECK == 0) {
+            gettimeofday(&end, 0);
+            if (get_elapsed_time(start, end) > time_limit) {
+                status = TIME_LIMIT_EXCEEDED;
+                LOG_I("Local search time exceeded");
+                break;
+            }
+        }
+        int a = queue_pop(&ls.queue);
+        if ((moves & LS_MOVE_2OPT) && try_2opt(&ls, t, a, obj)) { continue; }
+        if ((moves & LS_MOVE_OROPT) && try_oropt(&ls, t, a, obj)) { continue; }
+        if ((moves & LS_MOVE_3OPT) && try_3opt(&ls, t, a, obj)) { continue; }
+        if ((moves & LS_MOVE_LK) && try_lk(&ls, t, a, obj)) { continue; }
+    }
+    ls_free(&ls);
+    return status;
+}
+
+int alg_2opt_cand(instance *inst, array_tour *t, double *obj, const int *active, int num_active, int time_limit) {
+    return descent(inst, t, obj, active, num_active, time_limit, LS_MOVE_2OPT);
+}
+
+int alg_oropt_cand(instance *inst, array_tour *t, double *obj, const int *active, int num_active, int time_limit) {
+    return descent(inst, t, obj, active, num_active, time_limit, LS_MOVE_OROPT);
+}
+
+int alg_2opt_oropt(instance *inst, array_tour *t, double *obj, const int *active, int num_active, int time_limit) {
+    return descent(inst, t, obj, active, num_active, time_limit, LS_MOVE_2OPT | LS_MOVE_OROPT);
+}
+
+int alg_3opt_cand(instance *inst, array_tour *t, double *obj, const int *active, int num_active, int time_limit) {
+    return descent(inst, t, obj, active, num_active, time_limit, LS_MOVE_3OPT);
+}
+
+int alg_lk(instance *inst, array_tour *t, double *obj, const int *active, int num_active, int time_limit) {
+    return descent(inst, t, obj, active, num_active, time_limit, LS_MOVE_OROPT | LS_MOVE_LK);
+}
+
+int refine_solution(instance *inst, const int *active, int num_active) {
+    if (inst->params.refine == REFINE_2OPT || inst->cand.list == NULL) { return alg_2opt(inst); }
+
+    array_tour t;
+    tour_init(&t, inst->num_nodes);
+    tour_from_edges(&t, inst->solution.edges);
+    int status;
+    if (inst->params.refine == REFINE_2OPT_OROPT) {
+        status = alg_2opt_oropt(inst, &t, &inst->solution.obj_best, active, num_active, inst->params.time_limit);
+    } else if (inst->params.refine == REFINE_LK) {
+        status = alg_lk(inst, &t, &inst->solution.obj_best, active, num_active, inst->params.time_limit);
+    } else {
+        status = alg_2opt_cand(inst, &t, &inst->solution.obj_best, active, num_active, inst->params.time_limit);
+    }
+    tour_to_edges(&t, inst->solution.edges);
+    tour_free(&t);
+    return status;
+}
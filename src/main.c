@@ -7,22 +7,37 @@
 #include <cplex.h>
 #include "utility.h"    //Structs and function used globally.
 #include "solver.h"
+#include "distcache.h"
+#include "batch.h"
+#include "generator.h"
 
 // Download instances from here: http://vrp.atd-lab.inf.puc-rio.br/index.php/en/
 int main(int argc, const char *argv[])
 {
     instance inst;                          // create an empty tsp istance
     parse_comand_line(argc, argv, &inst);   // Read the user commands
-    parse_instance(&inst);                  // Read the TSP istance
+    if (inst.params.batch_path != NULL) {   // Solve many instances in the same process
+        int status = solve_batch(&inst);
+        free_instance(&inst);
+        return status;
+    }
+    if (inst.params.gen_output != NULL) {   // Write the generated instance without solving it
+        parse_instance(&inst);
+        write_tsplib(&inst, inst.params.gen_output);
+        free_instance(&inst);
+        return 0;
+    }
+    load_instance(&inst);                   // Read the TSP istance and precompute its data
     
     print_instance(inst);                   // Show the istance
 
-    if (inst.params.method.use_cplex) {     // Solve using cplex
+    if (TSP_cached(&inst)) {                // The same run is in the result cache
+    } else if (inst.params.method.use_cplex) { // Solve using cplex
         TSP_opt(&inst);
     } else {                                // Solve using our heuristic methods
         TSP_heuc(&inst);
     }
-    
+    dist_cache_report(&inst);               // Show how the distance rows cache worked
     
     free_instance(&inst);
     return 0;
@@ -0,0 +1,200 @@
+#include "resultcache.h"
+
+#include "instcache.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Header of the result file. It is followed by the successor of each node (int32, 0-based)
+typedef struct {
+    char magic[8];          // RESULT_CACHE_MAGIC, without the terminating null character
+    uint64_t key;           // The result_cache_key of the run
+    int num_nodes;
+    int time_limit;         // The time limit of the stored run, <= 0 when it had none
+    int optimal;            // 1 when the tour is proven optimal by cplex
+    int status;             // The status returned by the solver
+    double obj;
+    double time;            // The time to solve of the stored run
+} result_header;
+
+// The params of the run which change the tour it finds. Everything is an int, so the struct has no padding
+typedef struct {
+    int num_nodes;
+    int weight_type;
+    int weight_format;
+    int is_vrp;
+    int capacity;
+    int integer_cost;
+    int method;
+    int callback_2opt;
+    int seed;
+    int dist_type;
+    int cand_k;
+    int cand_quadrant;
+    int cand_type;
+    int sparse_model;
+    int refine;
+} result_key_params;
+
+// The data of a node as it is hashed. The struct has no padding
+typedef struct {
+    double x;
+    double y;
+    int demand;
+    int is_depot;
+} result_key_node;
+
+uint64_t result_cache_key(const instance *inst) {
+    result_key_params params = {
+        inst->num_nodes, inst->weight_type, inst->weight_format, inst->is_vrp, inst->capacity,
+        inst->params.integer_cost, inst->params.method.id, inst->params.callback_2opt, inst->params.seed,
+        inst->params.dist_type, inst->params.cand_k, inst->params.cand_quadrant, inst->params.cand_type,
+        inst->params.sparse_model, inst->params.refine
+    };
+    uint64_t parts[3] = {hash_bytes(&params, sizeof(params)), 0, 0};
+
+    if (inst->nodes != NULL) {
+        result_key_node *nodes = MALLOC(inst->num_nodes, result_key_node);
+        for (int i = 0; i < inst->num_nodes; i++) {
+            nodes[i].x = inst->nodes[i].x;
+            nodes[i].y = inst->nodes[i].y;
+            nodes[i].demand = inst->nodes[i].demand;
+            nodes[i].is_depot = inst->nodes[i].is_depot;
+        }
+        parts[1] = hash_bytes(nodes, (size_t) inst->num_nodes * sizeof(result_key_node));
+        FREE(nodes);
+    }
+    // The EXPLICIT instances have no coordinates: their weights are always in the distance matrix
+    if (inst->weight_type == EXPLICIT && inst->dist.data != NULL) {
+        size_t elem_size = inst->dist.type == DIST_MATRIX_INT ? sizeof(int) : sizeof(double);
+        parts[2] = hash_bytes(inst->dist.data, (size_t) inst->dist.size * elem_size);
+    }
+    return hash_bytes(parts, sizeof(parts));
+}
+
+static char *result_path(const char *dir, uint64_t key) {
+    size_t len = strlen(dir) + strlen(RESULT_CACHE_EXT) + 19;
+    char *path = CALLOC(len, char);
+    snprintf(path, len, "%s/%016llx%s", dir, (unsigned long long) key, RESULT_CACHE_EXT);
+    return path;
+}
+
+// Whether the stored run answers a run with the given time limit
+static int covers(const result_header *header, int time_limit) {
+    return header->optimal || header->time_limit <= 0 || (time_limit > 0 && time_limit <= header->time_limit);
+}
+
+// Reads the stored result of the run. The successors are read only if succ is not NULL. Returns 1 if the
+// result is valid, 0 otherwise
+static int read_result(const char *path, uint64_t key, int num_nodes, result_header *header, int *succ) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) { return 0; }
+    struct stat st;
+    size_t succ_size = (size_t) num_nodes * sizeof(int);
+    int valid = read(fd, header, sizeof(*header)) == sizeof(*header) && fstat(fd, &st) == 0 &&
+                memcmp(header->magic, RESULT_CACHE_MAGIC, sizeof(header->magic)) == 0 &&
+                header->key == key && header->num_nodes == num_nodes &&
+                (size_t) st.st_size == sizeof(*header) + succ_size;
+    if (valid && succ != NULL) { valid = read(fd, succ, succ_size) == (ssize_t) succ_size; }
+    close(fd);
+    if (!valid || succ == NULL) { return valid; }
+
+    // The successors must be a single tour of all the nodes
+    bool *visited = CALLOC(num_nodes, bool);
+    int node = 0;
+    for (int k = 0; k < num_nodes && valid; k++) {
+        valid = node >= 0 && node < num_nodes && !visited[node];
+        if (valid) {
+            visited[node] = true;
+            node = succ[node];
+        }
+    }
+    FREE(visited);
+    return valid && node == 0;
+}
+
+int load_cached_result(instance *inst) {
+    const char *dir = inst->params.result_cache;
+    if (dir == NULL) { return 0; }
+    int n = inst->num_nodes;
+    uint64_t key = result_cache_key(inst);
+    char *path = result_path(dir, key);
+    result_header header;
+    int *succ = MALLOC(n, int);
+    int found = read_result(path, key, n, &header, succ);
+    FREE(path);
+    if (!found) {
+        FREE(succ);
+        return 0;
+    }
+
+    if (covers(&header, inst->params.time_limit)) {
+        FREE(inst->solution.edges);
+        inst->solution.edges = CALLOC(n, edge);
+        for (int i = 0; i < n; i++) {
+            inst->solution.edges[i].i = i;
+            inst->solution.edges[i].j = succ[i];
+        }
+        inst->solution.obj_best = header.obj;
+        if (inst->params.verbose >= 3) { LOG_I("Result of the run found in the cache: %f", header.obj); }
+        FREE(succ);
+        return 1;
+    }
+
+    // The stored run had a shorter time limit: its tour is where the longer run starts
+    if (inst->warm_tour == NULL) {
+        inst->warm_tour = MALLOC(n, int);
+        for (int k = 0, node = 0; k < n; k++, node = succ[node]) { inst->warm_tour[k] = node; }
+        if (inst->params.verbose >= 3) { LOG_I("The run starts from the cached result of %ds: %f", header.time_limit, header.obj); }
+    }
+    FREE(succ);
+    return 0;
+}
+
+void store_cached_result(instance *inst, int status, int optimal) {
+    const char *dir = inst->params.result_cache;
+    if (dir == NULL || inst->solution.edges == NULL) { return; }
+    int n = inst->num_nodes;
+    uint64_t key = result_cache_key(inst);
+    char *path = result_path(dir, key);
+
+    result_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, RESULT_CACHE_MAGIC, sizeof(header.magic));
+    header.key = key;
+    header.num_nodes = n;
+    header.time_limit = inst->params.time_limit;
+    header.optimal = optimal;
+    header.status = status;
+    header.obj = inst->solution.obj_best;
+    header.time = inst->solution.time_to_solve;
+
+    // The stored result is kept when it is as good and it answers the runs with this time limit too
+    result_header stored;
+    if (read_result(path, key, n, &stored, NULL) && stored.obj <= header.obj && covers(&stored, header.time_limit) && !header.optimal) {
+        FREE(path);
+        return;
+    }
+
+    int *succ = MALLOC(n, int);
+    for (int k = 0; k < n; k++) { succ[inst->solution.edges[k].i] = inst->solution.edges[k].j; }
+    mkdir(dir, 0777);
+    // Written to a temporary file and renamed, so the concurrent runs never read a partial result
+    size_t tmp_len = strlen(path) + 32;
+    char *tmp_path = CALLOC(tmp_len, char);
+    snprintf(tmp_path, tmp_len, "%s.%ld", path, (long) getpid());
+    FILE *fp = fopen(tmp_path, "wb");
+    int ok = fp != NULL;
+    if (ok) {
+        ok = fwrite(&header, sizeof(header), 1, fp) == 1 && fwrite(succ, sizeof(int), n, fp) == (size_t) n;
+        ok = fclose(fp) == 0 && ok;
+        ok = ok && rename(tmp_path, path) == 0;
+        if (!ok) { remove(tmp_path); }
+    }
+    if (!ok) { LOG_I("Unable to write the result cache %s", path); }
+    FREE(tmp_path);
+    FREE(succ);
+    FREE(path);
+}
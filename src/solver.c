@@ -5,6 +5,7 @@
 #include <sys/stat.h>
 #include <time.h>
 #include "distutil.h"
+#include "candidates.h"
 #include "mtz.h"
 #include "gg.h"
 #include "benders.h"
@@ -15,6 +16,9 @@
 #include "tabusearch.h"
 #include "genetic.h"
 #include "vns.h"
+#include "export.h"
+#include "incumbent.h"
+#include "resultcache.h"
 
 // BEST SOLVER: USER CUT SOLVER
 int configure_opt_best_solver(CPXENVptr env, CPXLPptr lp, instance *inst) {
@@ -68,29 +72,62 @@ static void print_solution(instance *inst) {
     }
 }
 
+// Installs the warm start tour as MIP start. Only the x variables are given: cplex completes the others (i.e. the MTZ and GG ones).
+// The fixing methods don't need it: they start from the heuristic solution, which is the warm start tour when it is given
+static void add_warm_start(CPXENVptr env, CPXLPptr lp, instance *inst) {
+    if (inst->warm_tour == NULL) { return; }
+    int n = inst->num_nodes;
+    int directed = inst->params.method.edge_type == DIR_EDGE;
+    int ncols = directed ? n * n : (int) inst->num_columns; // The x variables are the first columns of the model
+    int *indexes = MALLOC(ncols, int);
+    double *values = CALLOC(ncols, double);
+    for (int k = 0; k < ncols; k++) { indexes[k] = k; }
+    for (int k = 0; k < n; k++) {
+        int i = inst->warm_tour[k];
+        int j = inst->warm_tour[(k + 1) % n];
+        int col = directed ? x_dir_pos(i, j, n) : x_udir_col(inst, i, j);
+        if (col >= 0) { values[col] = 1.0; } // The edges out of the sparse model are left out: cplex repairs the partial start
+    }
+
+    int beg = 0;
+    int level = CPX_MIPSTART_AUTO;
+    int status = CPXaddmipstarts(env, lp, 1, ncols, &beg, indexes, values, &level, NULL);
+    if (status) { LOG_E("CPXaddmipstarts() error code %d", status); }
+    if (inst->params.verbose >= 3) { LOG_I("Warm start tour added as MIP start"); }
+    FREE(indexes);
+    FREE(values);
+}
+
 static int solve_problem(CPXENVptr env, CPXLPptr lp, instance *inst) {
     int status;
     int method = inst->params.method.id;
     if (method == SOLVE_MTZ) {
         add_mtz_constraints(inst, env, lp, 0);
+        add_warm_start(env, lp, inst);
         status = CPXmipopt(env, lp);
     } else if (method == SOLVE_MTZL) {
         add_mtz_lazy_constraints(inst, env, lp, 0);
+        add_warm_start(env, lp, inst);
         status = CPXmipopt(env, lp);
     } else if (method == SOLVE_MTZI) {
         add_mtz_constraints(inst, env, lp, 1);
+        add_warm_start(env, lp, inst);
         status = CPXmipopt(env, lp);
     } else if (method == SOLVE_MTZLI) {
         add_mtz_lazy_constraints(inst, env, lp, 1);
+        add_warm_start(env, lp, inst);
         status = CPXmipopt(env, lp);
     } else if (method == SOLVE_MTZ_IND) {
         add_mtz_indicator_constraints(inst, env, lp);
+        add_warm_start(env, lp, inst);
         status = CPXmipopt(env, lp);
     } else if (method == SOLVE_GG) {
         add_gg_constraints(inst, env, lp);
+        add_warm_start(env, lp, inst);
         status = CPXmipopt(env, lp);
     } else if (method == SOLVE_LOOP) {
         // Solve using benders algorithm
+        add_warm_start(env, lp, inst);
         status = benders_loop(inst, env, lp);
     } else if (method == SOLVE_HARD_FIXING) {
         status = hard_fixing_solver(inst, env, lp);
@@ -106,6 +143,7 @@ static int solve_problem(CPXENVptr env, CPXLPptr lp, instance *inst) {
         status = CPXcallbacksetfunc(env, lp, contextid, SEC_cuts_callback, inst);
         if (status) LOG_E("CPXcallbacksetfunc() error returned status %d", status);
 
+        add_warm_start(env, lp, inst);
         status = CPXmipopt(env, lp);
     }
     return status;
@@ -133,6 +171,18 @@ static int solve_problem_HEUC(instance *inst) {
         status = HEU_2opt_greedy_iter(inst);
     } else if (inst->params.method.id == SOLVE_2OPT_EXTR_MIL) {
         status = HEU_2opt_extramileage(inst);
+    } else if (inst->params.method.id == SOLVE_3OPT_GRASP) {
+        status = HEU_3opt_grasp(inst);
+    } else if (inst->params.method.id == SOLVE_3OPT_GRASP_ITER) {
+        status = HEU_3opt_grasp_iter(inst);
+    } else if (inst->params.method.id == SOLVE_3OPT_GREEDY) {
+        status = HEU_3opt_greedy(inst);
+    } else if (inst->params.method.id == SOLVE_3OPT_GREEDY_ITER) {
+        status = HEU_3opt_greedy_iter(inst);
+    } else if (inst->params.method.id == SOLVE_3OPT_EXTR_MIL) {
+        status = HEU_3opt_extramileage(inst);
+    } else if (inst->params.method.id == SOLVE_LK) {
+        status = HEU_LK(inst);
     } else if (inst->params.method.id == SOLVE_VNS) {
         status = HEU_VNS(inst);
     } else if (inst->params.method.id == SOLVE_TABU_STEP) {
@@ -154,6 +204,25 @@ static int solve_problem_HEUC(instance *inst) {
 int TSP_opt(instance *inst) {
     int error;
     CPXENVptr env = CPXopenCPLEX(&error);       // generate new environment, in err will be saved errors
+    if (env == NULL) { LOG_E("CPXopenCPLEX() error code %d", error); }
+    error = TSP_opt_env(inst, env);
+    CPXcloseCPLEX(&env);
+    if (error == CPXERR_NO_SOLN) { LOG_E("No Solution exists"); }
+    if (error) { LOG_E("Cplex solver encountered an error with error code: %d", error); }
+    return error;
+}
+
+// Releases the model of a solve ended by a cplex error, whose code is returned
+static int end_failed_solve(instance *inst, CPXENVptr env, CPXLPptr lp, int status) {
+    close_incumbent_stream(inst, STREAM_NO_BOUND);
+    CPXfreeprob(env, &lp);
+    free_model_columns(inst);
+    return status;
+}
+
+int TSP_opt_env(instance *inst, CPXENVptr env) {
+    int error;
+    CPXsetdefaults(env);    // The environment may have been used by a previous run
     CPXLPptr lp = CPXcreateprob(env, &error, inst->name);   // create new empty linear programming problem (no variables, no constraints ...)
     // Build the model (add variable and constrains to the empty one)
     build_model(inst, env, lp);
@@ -166,7 +235,7 @@ int TSP_opt(instance *inst) {
 
     
     if (inst->params.seed >= 0) {
-        srandom(inst->params.seed); // Setting the random seed for rand()
+        seed_random(inst->params.seed); // Setting the random seed for URAND()
     }
     long ncols = CPXgetnumcols(env, lp);
     inst->num_columns = ncols; // The callbacks need the number of cols
@@ -174,12 +243,7 @@ int TSP_opt(instance *inst) {
 
     // Setting up indices array. Setting up it here avoids on setting it up everytime the 2-opt callback need it. One time initialization and that's all.
     inst->ind = MALLOC(inst->num_columns, int);
-    int k = 0;
-    for (int i = 0; i < inst->num_nodes - 1; i++) {
-        for (int j = i + 1; j < inst->num_nodes; j++) {
-            inst->ind[k++] = x_udir_pos(i, j, inst->num_nodes);
-        }
-    }
+    for (int k = 0; k < inst->num_columns; k++) { inst->ind[k] = k; }
     // setting up seeds array for multithreading methods
     // As cplex's documentations says, the maximal number of threads used by cplex is 32 if not specified a higher number
     // Check it here: https://www.ibm.com/docs/en/icos/12.8.0.0?topic=parameters-global-thread-count
@@ -191,6 +255,7 @@ int TSP_opt(instance *inst) {
     }
 
     //Start counting time
+    open_incumbent_stream(inst);
     struct timeval start, end;
     gettimeofday(&start, 0);
 
@@ -206,11 +271,12 @@ int TSP_opt(instance *inst) {
         if (status == CPX_STAT_ABORT_TIME_LIM) {
             LOG_I("Time limit exceeded");
         } else {
-            LOG_E("Cplex solver encountered an error with error code: %d", status);
+            return end_failed_solve(inst, env, lp, status); // The caller reports the error: TSP_opt stops, a batch goes on with its next run
         }
     }
     double elapsed = get_elapsed_time(start, end);
     inst->solution.time_to_solve = elapsed;
+    int solve_status = status; // status is reused by CPXgetx
     
     // Use the solution (save it)
     //int ncols = CPXgetnumcols(env, lp);
@@ -222,10 +288,9 @@ int TSP_opt(instance *inst) {
             //int stat = CPXgetstat(env, lp);
             //LOG_I("Status: %d", stat);
             // Cplex error codes: https://www.tu-chemnitz.de/mathematik/discrete/manuals/cplex/doc/refman/html/appendixC2.html
-            if (status == CPXERR_NO_SOLN) {
-                LOG_E("No Solution exists");	
-            }
-            LOG_E("CPXgetx() error code %d", status);	
+            // CPXERR_NO_SOLN when the time limit stops cplex before it finds a tour
+            FREE(xstar);
+            return end_failed_solve(inst, env, lp, status);
         }
         CPXgetobjval(env, lp, &(inst->solution.obj_best));
 
@@ -235,14 +300,28 @@ int TSP_opt(instance *inst) {
     } else {
         save_solution_edges(inst, inst->solution.xbest);
     }
+
+    // The bound of the fixing methods is the one of their last restricted model, which is not a bound of the problem
+    double bound = STREAM_NO_BOUND;
+    int fixing = inst->params.method.id == SOLVE_HARD_FIXING || inst->params.method.id == SOLVE_HARD_FIXING2 || inst->params.method.id == SOLVE_SOFT_FIXING;
+    if (inst->stream != NULL && !fixing) { CPXgetbestobjval(env, lp, &bound); }
+    close_incumbent_stream(inst, bound);
+
+    // CPXmipopt returns 0 also when it stops at the time limit, so the optimality is read from the status of the last solve
+    int mip_status = CPXgetstat(env, lp);
+    int optimal = !fixing && (mip_status == CPXMIP_OPTIMAL || mip_status == CPXMIP_OPTIMAL_TOL);
 	
     export_tour(inst);
+    export_perf_result(inst, solve_status);
+    store_cached_result(inst, solve_status, optimal);
     
     print_solution(inst);
 	
     plot_solution(inst);
 
-    if (inst->params.perf_prof) {
+    if (inst->params.batch) {
+        // The result is written in the batch report
+    } else if (inst->params.perf_prof) {
         if (inst->params.method.id == SOLVE_HARD_FIXING || inst->params.method.id == SOLVE_HARD_FIXING2 || inst->params.method.id == SOLVE_SOFT_FIXING) {
             printf("%0.2f", inst->solution.obj_best);
         } else {
@@ -253,16 +332,16 @@ int TSP_opt(instance *inst) {
         printf("\n\n\nTIME TO SOLVE %0.6fs\n\n\n", elapsed); // Time should be printed only when no errors occur
     }
 
-    //Free the problem and close cplex environment
+    //Free the problem. The environment is closed by the caller
     CPXfreeprob(env, &lp);
-    CPXcloseCPLEX(&env);
+    free_model_columns(inst);
     return error;
 }
 
 int TSP_heuc(instance *inst) {
 
     if (inst->params.seed >= 0) {
-        srandom(inst->params.seed); // Setting the random seed for rand()
+        seed_random(inst->params.seed); // Setting the random seed for URAND()
     }
 
     // In heuristic xbest is not used since it's a quadratic data structure. Since heuristics solves very large problems, the amount of memory required by xbest is very huge
@@ -270,6 +349,7 @@ int TSP_heuc(instance *inst) {
     inst->solution.edges = CALLOC(inst->num_nodes, edge);
 
     //Start counting time
+    open_incumbent_stream(inst);
     struct timeval start, end;
     gettimeofday(&start, 0);
 
@@ -280,15 +360,20 @@ int TSP_heuc(instance *inst) {
     gettimeofday(&end, 0);
     double elapsed = get_elapsed_time(start, end);
     inst->solution.time_to_solve = elapsed;
+    close_incumbent_stream(inst, STREAM_NO_BOUND);
     
 	
     export_tour(inst);
+    export_perf_result(inst, status);
+    store_cached_result(inst, status, 0);
     
     print_solution(inst);
 	
     plot_solution(inst);
 
-    if (inst->params.perf_prof) {
+    if (inst->params.batch) {
+        // The result is written in the batch report
+    } else if (inst->params.perf_prof) {
         printf("%0.2f", inst->solution.obj_best);
         //printf("\n%0.2f", elapsed);
     } else {
@@ -298,14 +383,114 @@ int TSP_heuc(instance *inst) {
     return 0;
 }
 
+int TSP_cached(instance *inst) {
+    struct timeval start, end;
+    gettimeofday(&start, 0);
+    if (!load_cached_result(inst)) { return 0; }
+    gettimeofday(&end, 0);
+    double elapsed = get_elapsed_time(start, end);
+    inst->solution.time_to_solve = elapsed;
+
+    // The cached tour is the only incumbent of the run
+    open_incumbent_stream(inst);
+    close_incumbent_stream(inst, STREAM_NO_BOUND);
+
+    export_tour(inst);
+    export_perf_result(inst, 0);
+
+    print_solution(inst);
+
+    plot_solution(inst);
+
+    if (inst->params.perf_prof) {
+        printf("%0.2f", inst->solution.obj_best);
+    } else {
+        printf("\n\n\nTIME TO SOLVE %0.6fs\n\n\n", elapsed);
+    }
+    return 1;
+}
+
+static int compare_ints(const void *a, const void *b) {
+    int x = *(const int *) a;
+    int y = *(const int *) b;
+    return (x > y) - (x < y);
+}
+
+// Gives a column to each edge of the candidate lists. The columns follow the order of the pairs (i, j) with i < j, like x_udir_pos
+static void build_model_columns(instance *inst) {
+    int n = inst->num_nodes;
+    model_columns *columns = &inst->columns;
+    columns->start = CALLOC(n + 1, int);
+
+    // Each candidate edge is stored with both its nodes. The edges in the candidate lists of both their nodes are repeated and removed later
+    for (int i = 0; i < n; i++) {
+        int count;
+        const neighbor *cand = candidate_neighbors(inst, i, &count);
+        for (int l = 0; l < count; l++) {
+            columns->start[i + 1]++;
+            columns->start[cand[l].node + 1]++;
+        }
+    }
+    for (int i = 0; i < n; i++) { columns->start[i + 1] += columns->start[i]; }
+    columns->adj = MALLOC(columns->start[n], int);
+    int *fill = MALLOC(n, int);
+    memcpy(fill, columns->start, n * sizeof(int));
+    for (int i = 0; i < n; i++) {
+        int count;
+        const neighbor *cand = candidate_neighbors(inst, i, &count);
+        for (int l = 0; l < count; l++) {
+            int j = cand[l].node;
+            columns->adj[fill[i]++] = j;
+            columns->adj[fill[j]++] = i;
+        }
+    }
+    FREE(fill);
+
+    // Sorts the neighbors of each node and compacts them without the repeated ones
+    int size = 0;
+    for (int i = 0; i < n; i++) {
+        int from = columns->start[i];
+        int to = columns->start[i + 1];
+        qsort(columns->adj + from, to - from, sizeof(int), compare_ints);
+        columns->start[i] = size;
+        for (int l = from; l < to; l++) {
+            if (l == from || columns->adj[l] != columns->adj[l - 1]) { columns->adj[size++] = columns->adj[l]; }
+        }
+    }
+    columns->start[n] = size;
+    columns->adj = REALLOC(columns->adj, size, int);
+
+    // The edge (i, j) with i > j has the column given to (j, i), which is found in the sorted neighbors of j
+    columns->col = MALLOC(size, int);
+    columns->num_columns = 0;
+    for (int i = 0; i < n; i++) {
+        for (int l = columns->start[i]; l < columns->start[i + 1]; l++) {
+            int j = columns->adj[l];
+            columns->col[l] = j > i ? (int) columns->num_columns++ : x_udir_col(inst, j, i);
+        }
+    }
+}
+
+static void free_model_columns(instance *inst) {
+    FREE(inst->columns.start);
+    FREE(inst->columns.adj);
+    FREE(inst->columns.col);
+    inst->columns.num_columns = 0;
+}
+
 static void build_udir_model(instance *inst, CPXENVptr env, CPXLPptr lp) {
     char xctype = 'B';  // B=binary variable
     char *names = CALLOC(100, char);
 
+    // The sparse model has only the columns of the candidate edges, see x_udir_col
+    if (inst->params.sparse_model) { build_model_columns(inst); }
+
     // We add one variable at time. We may also add them all in a single shot. i<j
     for (int i = 0; i < inst->num_nodes; i++) {
 
         for (int j = i+1; j < inst->num_nodes; j++) {
+            int col = x_udir_col(inst, i, j);
+            if (col < 0) continue;
             
             sprintf(names, "x(%d,%d)", i+1, j+1);
 
@@ -319,7 +504,7 @@ static void build_udir_model(instance *inst, CPXENVptr env, CPXLPptr lp) {
                 LOG_E("An error occured inserting a new variable");
             }
             int numcols = CPXgetnumcols(env, lp);
-            if (numcols - 1 != x_udir_pos(i, j, inst->num_nodes)) { // numcols -1 because we need the position index of the new variable
+            if (numcols - 1 != col) { // numcols -1 because we need the position index of the new variable
                 LOG_E("Wrong position of variable in build_udri_model");
             }
         }
@@ -337,8 +522,10 @@ static void build_udir_model(instance *inst, CPXENVptr env, CPXLPptr lp) {
 
         for (int i = 0; i < inst->num_nodes; i++) {
             if (i == h) continue;
+            int col = x_udir_col(inst, h, i);
+            if (col < 0) continue;
 
-            status = CPXchgcoef(env, lp, h, x_udir_pos(h, i, inst->num_nodes), 1.0);
+            status = CPXchgcoef(env, lp, h, col, 1.0);
             if (status) {
                 LOG_E("CPXchgcoef() error code %d", status);
             }
@@ -362,6 +549,8 @@ static void build_dir_model(instance *inst, CPXENVptr env, CPXLPptr lp) {
             double obj = i != j ? calc_dist(i, j, inst) : 0.0; 
             double lb = 0.0; 
             double ub = i != j ? 1.0 : 0.0; // if i==j: ub=0 else ub=1
+            // The directed models keep a column for every arc, since the MTZ and GG variables follow them. In the sparse model the arcs out of the candidate lists are fixed to 0
+            if (inst->params.sparse_model && i != j && !is_candidate_edge(inst, i, j)) { ub = 0.0; }
 
             int status = CPXnewcols(env, lp, 1, &obj, &lb, &ub, &xctype, &names); 
             if (status) {
@@ -416,6 +605,10 @@ static void build_dir_model(instance *inst, CPXENVptr env, CPXLPptr lp) {
 
 static void build_model(instance *inst, CPXENVptr env, CPXLPptr lp) {
 
+    if (inst->params.sparse_model && inst->cand.list == NULL) {
+        LOG_E("The sparse model needs the candidate lists");
+    }
+
     // Checks the type of the edge in order to build the correct model
     if (inst->params.method.edge_type == UDIR_EDGE) {
         // Builds naive model for undirected graphs
@@ -424,6 +617,9 @@ static void build_model(instance *inst, CPXENVptr env, CPXLPptr lp) {
         // Builds naive model for directed graphs
         build_dir_model(inst, env, lp);
     }
+    if (inst->params.sparse_model && inst->params.verbose >= 3) {
+        LOG_I("Sparse model: only the edges of the candidate lists can be used, %d columns", CPXgetnumcols(env, lp));
+    }
     
 
     // Saving the model in .lp file
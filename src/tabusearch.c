@@ -2,6 +2,8 @@
 
 #include "heuristics.h"
 #include "distutil.h"
+#include "incumbent.h"
+#include "localsearch.h"
 #include <unistd.h>
 #include <float.h>
 
@@ -97,25 +99,22 @@ int check_tenure(int* edge_val, const int iter, const int tenure) {
  * 
  * @param inst The instance pointer of the problem
  * @param skip_edge The tabu list
- * @param stored_prev An array of the previous node for each node. It is useful for tabu when needs to reverse the path
- * of two swapped nodes outside of this function. This function indeed fullfils the stored_prev array
+ * @param t The tour of the solution, kept by tabu between the calls. The solution's edges are updated from it at the end
  * @param iter The algorithm's current iteration
  * @param tenure The current tenure
  * 
  * @returns The status code 0 when no errors occur
  */ 
-int alg_2opt_tabu(instance *inst, int *skip_edge, int *stored_prev, const int iter, const int tenure) {
+int alg_2opt_tabu(instance *inst, int *skip_edge, array_tour *t, const int iter, const int tenure) {
     struct timeval start, end;
     gettimeofday(&start, 0);
     double mindelta;
     int status = 0;
-    int *prev = MALLOC(inst->num_nodes, int);
-    MEMSET(prev, -1, inst->num_nodes, int);
-    for (int i = 0; i < inst->num_nodes; i++) {
-        prev[inst->solution.edges[i].j] = i;
-    }
+    dist_func dist = get_dist_func(inst); // Chosen once so the loops don't dispatch on the weight type
+    int_dist_func int_dist = get_int_dist_func(inst); // Not NULL with integer costs: the deltas are computed exactly in int64
     int mina = 0;
     int minb = 0;
+    double threshold = int_dist ? 0 : -EPS; // With real costs the rounding errors could give tiny negative deltas
     while(1) {
         gettimeofday(&end, 0);
         double elapsed = get_elapsed_time(start, end);
@@ -124,13 +123,13 @@ int alg_2opt_tabu(instance *inst, int *skip_edge, int *stored_prev, const int it
             LOG_I("2-opt heuristics time exceeded");
             break;
         }
-        mindelta = 0;
+        mindelta = threshold;
         for (int i = 0; i < inst->num_nodes - 1; i++) {
             for (int j = i+1; j < inst->num_nodes; j++) {
                 int a = i;
                 int b = j;
-                int a1 = inst->solution.edges[a].j;
-                int b1 = inst->solution.edges[b].j;
+                int a1 = tour_next(t, a);
+                int b1 = tour_next(t, b);
                 if (b == a1 || b1 == a) {
                     continue;
                 }
@@ -147,7 +146,12 @@ int alg_2opt_tabu(instance *inst, int *skip_edge, int *stored_prev, const int it
                     )) {
                         continue;
                     }
-                double delta = calc_dist(a, b, inst) + calc_dist(a1, b1, inst) - calc_dist(a, a1, inst) - calc_dist(b, b1, inst);
+                double delta;
+                if (int_dist) {
+                    delta = (double) ((long) int_dist(a, b, inst) + int_dist(a1, b1, inst) - int_dist(a, a1, inst) - int_dist(b, b1, inst));
+                } else {
+                    delta = dist(a, b, inst) + dist(a1, b1, inst) - dist(a, a1, inst) - dist(b, b1, inst);
+                }
                 if (delta < mindelta) {
                     mindelta = delta;
                     mina = i;
@@ -155,25 +159,14 @@ int alg_2opt_tabu(instance *inst, int *skip_edge, int *stored_prev, const int it
                 }
             }
         }
-        if (mindelta >= 0) {
+        if (mindelta >= threshold) {
             break;
         }
-        int mina1 = inst->solution.edges[mina].j;
-        int minb1 = inst->solution.edges[minb].j; 
-        inst->solution.edges[mina].j = minb;
-        inst->solution.edges[mina1].j = minb1;
-        reverse_path(inst, minb, mina1, prev);
+        tour_2opt_move(t, mina, minb);
         
     }
-    inst->solution.obj_best = 0.0;
-    for (int i = 0; i < inst->num_nodes; i++) {
-        edge e = inst->solution.edges[i];
-        inst->solution.obj_best += calc_dist(e.i, e.j, inst);
-    }
-    if(stored_prev) {
-        memcpy(stored_prev, prev, sizeof(int) * inst->num_nodes);
-    }
-    FREE(prev);
+    tour_to_edges(t, inst->solution.edges);
+    inst->solution.obj_best = calc_tour_cost(inst, inst->solution.edges);
     return status;
 }
 
@@ -193,7 +186,6 @@ static int tabu(instance *inst, void (*policy_ptr)(tenure_policy*, int)) {
     gettimeofday(&start, 0);
 
     int *tabu_edge = CALLOC(inst->num_columns, int);
-    int *prev = CALLOC(inst->num_nodes, int);
 
     //Compute initial solution
     //int grasp_time_lim = inst->params.time_limit / 5;
@@ -207,6 +199,10 @@ static int tabu(instance *inst, void (*policy_ptr)(tenure_policy*, int)) {
 
     plot_solution(inst);
 
+    array_tour t;
+    tour_init(&t, inst->num_nodes);
+    tour_from_edges(&t, inst->solution.edges);
+
     double best_obj = DBL_MAX;
     edge *best_sol = CALLOC(inst->num_nodes, edge);
     tenure_policy tenure_policy;
@@ -235,12 +231,13 @@ static int tabu(instance *inst, void (*policy_ptr)(tenure_policy*, int)) {
         }
 
         //Optimize
-        status = alg_2opt_tabu(inst, tabu_edge, prev, iter, tenure_policy.current_tenure);
+        status = alg_2opt_tabu(inst, tabu_edge, &t, iter, tenure_policy.current_tenure);
 
         //Update the best solution
         if (inst->solution.obj_best < best_obj) {
             best_obj = inst->solution.obj_best;
             memcpy(best_sol, inst->solution.edges, inst->num_nodes * sizeof(edge));
+            stream_incumbent(inst, best_obj, STREAM_NO_BOUND, best_sol);
             if (inst->params.verbose >= 3) {
                 LOG_I("Updated incumbent: %f", best_obj);
             }
@@ -263,8 +260,8 @@ static int tabu(instance *inst, void (*policy_ptr)(tenure_policy*, int)) {
             a = rand_choice(0, inst->num_nodes);
             b = rand_choice(0, inst->num_nodes);
 
-            a1 = inst->solution.edges[a].j;
-            b1 = inst->solution.edges[b].j;
+            a1 = tour_next(&t, a);
+            b1 = tour_next(&t, b);
 
             // Don't want the same node for a and b and don't want contiguous edges
             if (a == b || a1 == b || b1 == a) {
@@ -290,9 +287,7 @@ static int tabu(instance *inst, void (*policy_ptr)(tenure_policy*, int)) {
                 break;
             }
         }
-        inst->solution.edges[a].j = b;
-        inst->solution.edges[a1].j = b1;
-        reverse_path(inst, b, a1, prev);
+        tour_2opt_move(&t, a, b);
 
         (*policy_ptr)(&tenure_policy, iter);
 
@@ -313,8 +308,13 @@ static int tabu(instance *inst, void (*policy_ptr)(tenure_policy*, int)) {
 
     inst->solution.obj_best = best_obj;
     memcpy(inst->solution.edges, best_sol, inst->num_nodes * sizeof(edge));
+    // The tabu moves are 2-opt only: the best solution may still be improved by the other moves of the refinement
+    if (inst->params.refine != REFINE_2OPT && inst->params.refine != REFINE_2OPT_CAND) {
+        refine_solution(inst, NULL, 0);
+        if (inst->params.verbose >= 3) { LOG_I("Refined incumbent: %f", inst->solution.obj_best); }
+    }
     FREE(tabu_edge);
-    FREE(prev);
+    tour_free(&t);
     FREE(best_sol);
     return status;
 }
@@ -0,0 +1,72 @@
+#include "tour.h"
+
+void tour_init(array_tour *t, int n) {
+    t->order = MALLOC(n, int);
+    t->pos = MALLOC(n, int);
+    t->n = n;
+    t->reversed = false;
+}
+
+void tour_free(array_tour *t) {
+    FREE(t->order);
+    FREE(t->pos);
+}
+
+void tour_from_edges(array_tour *t, const edge *edges) {
+    for (int k = 0, node = 0; k < t->n; k++, node = edges[node].j) {
+        t->order[k] = node;
+        t->pos[node] = k;
+    }
+    t->reversed = false;
+}
+
+void tour_from_order(array_tour *t, const int *order) {
+    memcpy(t->order, order, t->n * sizeof(int));
+    for (int k = 0; k < t->n; k++) { t->pos[order[k]] = k; }
+    t->reversed = false;
+}
+
+void tour_to_edges(const array_tour *t, edge *edges) {
+    for (int i = 0; i < t->n; i++) {
+        edges[i].i = i;
+        edges[i].j = tour_next(t, i);
+    }
+}
+
+void tour_to_order(const array_tour *t, int *order) {
+    for (int k = 0, node = 0; k < t->n; k++, node = tour_next(t, node)) { order[k] = node; }
+}
+
+void order_to_edges(const int *order, int n, edge *edges) {
+    for (int k = 0; k < n; k++) {
+        int node = order[k];
+        edges[node].i = node;
+        edges[node].j = order[k + 1 < n ? k + 1 : 0];
+    }
+}
+
+void tour_reverse(array_tour *t, int a, int b) {
+    int n = t->n;
+    // The positions of the path in order, from i forward to j
+    int i = t->reversed ? t->pos[b] : t->pos[a];
+    int j = t->reversed ? t->pos[a] : t->pos[b];
+    int len = (j - i + n) % n + 1;
+    if (2 * len > n) {
+        // The rest of the tour is shorter: reversing it gives the same cycle visited backwards
+        int first = j + 1 == n ? 0 : j + 1;
+        j = i == 0 ? n - 1 : i - 1;
+        i = first;
+        len = n - len;
+        t->reversed = !t->reversed;
+    }
+    for (int k = 0; k < len / 2; k++) {
+        int u = t->order[i];
+        int v = t->order[j];
+        t->order[i] = v;
+        t->pos[v] = i;
+        t->order[j] = u;
+        t->pos[u] = j;
+        i = i + 1 == n ? 0 : i + 1;
+        j = j == 0 ? n - 1 : j - 1;
+    }
+}
@@ -0,0 +1,353 @@
+#include "tsplib.h"
+
+#include "compression.h"
+#include "distfile.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define MAX_EXACT_MANTISSA (1ULL << 53) // Integers up to this value are exact doubles
+
+// Powers of ten which are exact doubles
+static const double exact_pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline int is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static inline int is_space(char c) {
+    return is_blank(c) || c == '\n';
+}
+
+static inline int is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static inline void skip_spaces(tsplib_reader *reader) {
+    while (reader->cur < reader->end && is_space(*reader->cur)) { reader->cur++; }
+}
+
+static inline void skip_line(tsplib_reader *reader) {
+    while (reader->cur < reader->end && *reader->cur != '\n') { reader->cur++; }
+}
+
+// Converts the characters [begin, end) with strtod. Used for the numbers which the fast path can't convert exactly
+static double slow_parse(const char *begin, const char *end) {
+    char buffer[128];
+    size_t len = end - begin;
+    char *text = len < sizeof(buffer) ? buffer : MALLOC(len + 1, char);
+    memcpy(text, begin, len);
+    text[len] = '\0';
+    double value = strtod(text, NULL);
+    if (text != buffer) { FREE(text); }
+    return value;
+}
+
+int tsplib_read_number(tsplib_reader *reader, double *value) {
+    skip_spaces(reader);
+    const char *p = reader->cur;
+    const char *end = reader->end;
+    int negative = 0;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+
+    // The significant digits are accumulated in the mantissa as long as they fit, the others
+    // only make the conversion inexact
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    int num_digits = 0;
+    int exact = 1;
+    while (p < end && is_digit(*p)) {
+        if (mantissa < MAX_EXACT_MANTISSA) { mantissa = mantissa * 10 + (*p - '0'); }
+        else { exponent++; exact = 0; }
+        num_digits++;
+        p++;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && is_digit(*p)) {
+            if (mantissa < MAX_EXACT_MANTISSA) {
+                mantissa = mantissa * 10 + (*p - '0');
+                exponent--;
+            } else {
+                exact = 0;
+            }
+            num_digits++;
+            p++;
+        }
+    }
+    if (num_digits == 0) { return 0; }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        // As in strtod the exponent is taken only if it has digits
+        const char *q = p + 1;
+        int exp_negative = 0;
+        if (q < end && (*q == '-' || *q == '+')) {
+            exp_negative = *q == '-';
+            q++;
+        }
+        if (q < end && is_digit(*q)) {
+            int exp_value = 0;
+            while (q < end && is_digit(*q)) {
+                if (exp_value < 100000) { exp_value = exp_value * 10 + (*q - '0'); }
+                q++;
+            }
+            exponent += exp_negative ? -exp_value : exp_value;
+            p = q;
+        }
+    }
+
+    // Both the mantissa and the power of ten are exact, so the result is rounded once as in strtod
+    double result;
+    if (exact && mantissa <= MAX_EXACT_MANTISSA && exponent >= -22 && exponent <= 22) {
+        result = (double) mantissa;
+        result = exponent < 0 ? result / exact_pow10[-exponent] : result * exact_pow10[exponent];
+        if (negative) { result = -result; }
+    } else {
+        result = slow_parse(reader->cur, p);
+    }
+    *value = result;
+    reader->cur = p;
+    return 1;
+}
+
+// Reads the next token of the line, which ends at a blank, at a colon or at the end of the line
+static int read_token(tsplib_reader *reader, char *token, size_t size) {
+    while (reader->cur < reader->end && (is_blank(*reader->cur) || *reader->cur == ':')) { reader->cur++; }
+    size_t len = 0;
+    while (reader->cur < reader->end && !is_space(*reader->cur) && *reader->cur != ':') {
+        if (len < size - 1) { token[len++] = *reader->cur; }
+        reader->cur++;
+    }
+    token[len] = '\0';
+    return len > 0;
+}
+
+static int read_int(tsplib_reader *reader, const char *section) {
+    double value;
+    if (!tsplib_read_number(reader, &value)) { LOG_E("Missing number in %s", section); }
+    return (int) value;
+}
+
+// Parses the lines "index x y" of NODE_COORD_SECTION and DISPLAY_DATA_SECTION until the next keyword
+static void parse_coords(instance *inst, tsplib_reader *reader) {
+    double index;
+    while (tsplib_read_number(reader, &index)) {
+        int i = (int) index - 1; // Nodes in problem's file start from index 1
+        if (i < 0 || i >= inst->num_nodes) { LOG_E(" ... unknown node in NODE_COORD_SECTION or DISPLAY_DATA_SECTION"); }
+        node p = {0, 0, 0, false};
+        if (!tsplib_read_number(reader, &p.x) || !tsplib_read_number(reader, &p.y)) { LOG_E("Missing coordinates of node %d", i + 1); }
+        inst->nodes[i] = p;
+    }
+}
+
+// Parses the lines "index demand" of DEMAND_SECTION until the next keyword
+static void parse_demands(instance *inst, tsplib_reader *reader) {
+    double index;
+    while (tsplib_read_number(reader, &index)) {
+        int i = (int) index - 1; // Nodes in problem's file start from index 1
+        if (i < 0 || i >= inst->num_nodes) { LOG_E(" ... unknown node in DEMAND_SECTION"); }
+        inst->nodes[i].demand = read_int(reader, "DEMAND_SECTION");
+    }
+}
+
+// Parses the depots of DEPOT_SECTION, terminated by -1
+static void parse_depots(instance *inst, tsplib_reader *reader) {
+    double index;
+    while (tsplib_read_number(reader, &index)) {
+        int i = (int) index - 1; // Nodes in problem's file start from index 1
+        if (i == -2) { break; }
+        if (i < 0 || i >= inst->num_nodes) { LOG_E(" ... unknown node in DEPOT_SECTION"); }
+        inst->nodes[i].is_depot = true;
+    }
+}
+
+void parse_tsplib(instance *inst, const char *data, size_t len, const struct stat *source) {
+    compression_type compression = detect_compression(data, len);
+    if (compression != COMPRESSION_NONE) {
+        struct timeval start, end;
+        gettimeofday(&start, 0);
+        size_t text_len;
+        char *text = decompress_buffer(data, len, compression, &text_len);
+        gettimeofday(&end, 0);
+        if (inst->params.verbose >= 3) {
+            LOG_I("Instance decompressed: %zu bytes to %zu bytes in %0.3f seconds", len, text_len, get_elapsed_time(start, end));
+        }
+        parse_tsplib(inst, text, text_len, source);
+        FREE(text);
+        return;
+    }
+
+    tsplib_reader reader = {data, data, data + len};
+    char keyword[64];
+    char value[256];
+
+    while (1) {
+        skip_spaces(&reader);
+        if (reader.cur >= reader.end) { break; }
+        if (!read_token(&reader, keyword, sizeof(keyword))) { // A line starting with a colon
+            skip_line(&reader);
+            continue;
+        }
+
+        if (strcmp(keyword, "EOF") == 0) { break; }
+
+        if (strcmp(keyword, "NODE_COORD_SECTION") == 0 || strcmp(keyword, "DISPLAY_DATA_SECTION") == 0) {
+            // The display coordinates of the EXPLICIT instances are used only for plotting
+            if (inst->nodes == NULL) { LOG_E("DIMENSION must be given before %s", keyword); }
+            parse_coords(inst, &reader);
+            continue;
+        }
+        if (strcmp(keyword, "EDGE_WEIGHT_SECTION") == 0) {
+            if (inst->weight_type != EXPLICIT) { LOG_E("EDGE_WEIGHT_SECTION is supported only with the EXPLICIT edge weight type"); }
+            load_edge_weights(inst, &reader, source);
+            continue;
+        }
+        if (strcmp(keyword, "DEMAND_SECTION") == 0) {
+            if (inst->nodes == NULL) { LOG_E("DIMENSION must be given before DEMAND_SECTION"); }
+            parse_demands(inst, &reader);
+            continue;
+        }
+        if (strcmp(keyword, "DEPOT_SECTION") == 0) {
+            if (inst->nodes == NULL) { LOG_E("DIMENSION must be given before DEPOT_SECTION"); }
+            parse_depots(inst, &reader);
+            continue;
+        }
+
+        // Specification keywords: "KEYWORD : value"
+        read_token(&reader, value, sizeof(value));
+        if (strcmp(keyword, "NAME") == 0) {
+            FREE(inst->name);
+            inst->name = CALLOC(strlen(value) + 1, char);
+            memcpy(inst->name, value, strlen(value));
+        } else if (strcmp(keyword, "TYPE") == 0) {
+            if (strncmp(value, "CVRP", 4) == 0) { inst->is_vrp = true; }
+        } else if (strcmp(keyword, "DIMENSION") == 0) {
+            inst->num_nodes = atoi(value);
+            if (inst->num_nodes <= 0) { LOG_E("Wrong DIMENSION: %s", value); }
+            FREE(inst->nodes);
+            inst->nodes = CALLOC(inst->num_nodes, node);
+        } else if (strcmp(keyword, "CAPACITY") == 0) {
+            inst->capacity = atoi(value);
+        } else if (strcmp(keyword, "EDGE_WEIGHT_TYPE") == 0) {
+            if (strcmp(value, "EUC_2D") == 0) inst->weight_type = EUC_2D;
+            if (strcmp(value, "MAX_2D") == 0) inst->weight_type = MAX_2D;
+            if (strcmp(value, "MAN_2D") == 0) inst->weight_type = MAN_2D;
+            if (strcmp(value, "CEIL_2D") == 0) inst->weight_type = CEIL_2D;
+            if (strcmp(value, "GEO") == 0) inst->weight_type = GEO;
+            if (strcmp(value, "ATT") == 0) inst->weight_type = ATT;
+            if (strcmp(value, "EXPLICIT") == 0) inst->weight_type = EXPLICIT;
+        } else if (strcmp(keyword, "EDGE_WEIGHT_FORMAT") == 0) {
+            if (strcmp(value, "FULL_MATRIX") == 0) inst->weight_format = FULL_MATRIX;
+            if (strcmp(value, "UPPER_ROW") == 0) inst->weight_format = UPPER_ROW;
+            if (strcmp(value, "LOWER_ROW") == 0) inst->weight_format = LOWER_ROW;
+            if (strcmp(value, "UPPER_DIAG_ROW") == 0) inst->weight_format = UPPER_DIAG_ROW;
+            if (strcmp(value, "LOWER_DIAG_ROW") == 0) inst->weight_format = LOWER_DIAG_ROW;
+            // The weights are symmetric, so the column formats list the same sequence of the transposed row formats
+            if (strcmp(value, "LOWER_COL") == 0) inst->weight_format = UPPER_ROW;
+            if (strcmp(value, "UPPER_COL") == 0) inst->weight_format = LOWER_ROW;
+            if (strcmp(value, "LOWER_DIAG_COL") == 0) inst->weight_format = UPPER_DIAG_ROW;
+            if (strcmp(value, "UPPER_DIAG_COL") == 0) inst->weight_format = LOWER_DIAG_ROW;
+        }
+        // The other keywords (e.g. COMMENT) are not used
+        skip_line(&reader);
+    }
+}
+
+// Maps the file in memory. Returns NULL for an empty file
+static char *map_file(const char *path, struct stat *st) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) { LOG_E("Unable to open the file %s", path); }
+    if (fstat(fd, st) != 0) { LOG_E("Unable to read the status of the file %s", path); }
+    if (st->st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    char *data = mmap(NULL, st->st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping stays valid after closing the file
+    if (data == MAP_FAILED) { LOG_E("Unable to map the file %s", path); }
+    madvise(data, st->st_size, MADV_SEQUENTIAL);
+    return data;
+}
+
+void parse_tsplib_file(instance *inst, const char *path) {
+    struct stat source;
+    char *data = map_file(path, &source);
+    parse_tsplib(inst, data != NULL ? data : "", source.st_size, &source);
+    if (data != NULL) { munmap(data, source.st_size); }
+}
+
+// Parses the nodes of TOUR_SECTION, terminated by -1, in inst->warm_tour
+static void parse_tour_nodes(instance *inst, tsplib_reader *reader, const char *path) {
+    int n = inst->num_nodes;
+    int *tour = MALLOC(n, int);
+    bool *visited = CALLOC(n, bool);
+    int count = 0;
+    double index;
+    while (tsplib_read_number(reader, &index)) {
+        int node = (int) index - 1; // Nodes in tour's file start from index 1
+        if (node == -2) { break; }
+        if (node < 0 || node >= n) { LOG_E("Unknown node %d in the tour %s", node + 1, path); }
+        if (visited[node] || count == n) { LOG_E("The node %d is visited twice in the tour %s", node + 1, path); }
+        visited[node] = true;
+        tour[count++] = node;
+    }
+    if (count != n) { LOG_E("The tour %s visits %d nodes instead of %d", path, count, n); }
+    FREE(visited);
+    FREE(inst->warm_tour);
+    inst->warm_tour = tour;
+}
+
+void parse_tour_file(instance *inst, const char *path) {
+    if (inst->num_nodes <= 0) { LOG_E("The instance must be parsed before the tour %s", path); }
+    struct stat st;
+    char *data = map_file(path, &st);
+    size_t len = st.st_size;
+    const char *text = data;
+    char *decoded = NULL;
+    compression_type compression = detect_compression(data, len);
+    if (compression != COMPRESSION_NONE) {
+        decoded = decompress_buffer(data, len, compression, &len);
+        text = decoded;
+    }
+
+    tsplib_reader reader = {text, text, text + len};
+    char keyword[64];
+    char value[256];
+    int mismatch = 0; // 1 when the DIMENSION of the tour is not the one of the instance
+    while (1) {
+        skip_spaces(&reader);
+        if (reader.cur >= reader.end) { break; }
+        if (!read_token(&reader, keyword, sizeof(keyword))) {
+            skip_line(&reader);
+            continue;
+        }
+        if (strcmp(keyword, "EOF") == 0) { break; }
+        if (strcmp(keyword, "TOUR_SECTION") == 0) {
+            parse_tour_nodes(inst, &reader, path);
+            continue;
+        }
+        read_token(&reader, value, sizeof(value));
+        if (strcmp(keyword, "DIMENSION") == 0 && atoi(value) != inst->num_nodes) {
+            if (!inst->params.batch) { LOG_E("The tour %s has %s nodes but the instance has %d nodes", path, value, inst->num_nodes); }
+            // The warm start tour of a batch fits only some of its instances: the others are solved without it
+            if (inst->params.verbose >= 3) { LOG_I("The tour %s has %s nodes but the instance has %d nodes: no warm start", path, value, inst->num_nodes); }
+            mismatch = 1;
+            break;
+        }
+        // The other keywords (e.g. NAME, TYPE and OBJECTIVE) are not used
+        skip_line(&reader);
+    }
+    if (inst->warm_tour == NULL && !mismatch) { LOG_E("Missing TOUR_SECTION in the tour %s", path); }
+
+    FREE(decoded);
+    if (data != NULL) { munmap(data, st.st_size); }
+    if (!mismatch && inst->params.verbose >= 3) { LOG_I("Warm start tour read from %s", path); }
+}
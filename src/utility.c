@@ -7,13 +7,35 @@
 #include <sys/stat.h>
 #include <math.h>
 #include <time.h>
+#include <stdint.h>
 
 #include "plot.h"
+#include "distutil.h"
+#include "distfile.h"
+#include "tsplib.h"
+#include "instcache.h"
+#include "distkernels.h"
+#include "distcache.h"
+#include "kdtree.h"
+#include "candidates.h"
+#include "generator.h"
+#include "export.h"
 
 double dmax(double d1, double d2) {
     return d1 > d2 ? d1 : d2;
 }
 
+double dmin(double d1, double d2) {
+    return d1 < d2 ? d1 : d2;
+}
+
+_Thread_local jmp_buf *error_jump = NULL;
+
+void exit_on_error(void) {
+    if (error_jump != NULL) { longjmp(*error_jump, 1); }
+    exit(1);
+}
+
 int x_udir_pos(int i, int j, int num_nodes) {
     if (i == j) { 
         LOG_E("Indexes passed are equal!"); 
@@ -29,6 +51,18 @@ int x_udir_pos(int i, int j, int num_nodes) {
     return i * num_nodes + j - ((i + 1) * (i + 2)) / 2;
 }
 
+int x_udir_col(const instance *inst, int i, int j) {
+    const model_columns *columns = &inst->columns;
+    if (columns->start == NULL) { return x_udir_pos(i, j, inst->num_nodes); }
+    int lo = columns->start[i];
+    int hi = columns->start[i + 1];
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (columns->adj[mid] < j) { lo = mid + 1; } else { hi = mid; }
+    }
+    return lo < columns->start[i + 1] && columns->adj[lo] == j ? columns->col[lo] : -1;
+}
+
 int x_dir_pos(int i, int j, int num_nodes) {
     if (i > num_nodes - 1 || j > num_nodes -1 ) {
         LOG_E("Indexes passed greater than the number of nodes");
@@ -44,6 +78,232 @@ static int check_input_index_validity(int index, int argc, int *need_help) {
     return 0;
 }
 
+int parse_method(const char *name, instance_params *params) {
+    sol_method parsed = {SOLVE_DEFAULT, DEFAULT_EDGE, NULL, 0};
+    int callback_2opt = 0;
+
+    // Directed graph methods
+    if (strncmp(name, "MTZ", 3) == 0) {
+        parsed.id = SOLVE_MTZ;
+        parsed.edge_type = DIR_EDGE;
+        parsed.name = "MTZ Static";
+        parsed.use_cplex = 1;
+    }
+    if (strncmp(name, "MTZL", 4) == 0) {
+        parsed.id = SOLVE_MTZL;
+        parsed.edge_type = DIR_EDGE;
+        parsed.name = "MTZ Lazy";
+        parsed.use_cplex = 1;
+    }
+    if (strncmp(name, "MTZI", 4) == 0) {
+        parsed.id = SOLVE_MTZI;
+        parsed.edge_type = DIR_EDGE;
+        parsed.name = "MTZ with SEC of degree 2";
+        parsed.use_cplex = 1;
+    }
+    if (strncmp(name, "MTZLI", 5) == 0) {
+        parsed.id = SOLVE_MTZLI;
+        parsed.edge_type = DIR_EDGE;
+        parsed.name = "MTZ lazy with SEC of degree 2";
+        parsed.use_cplex = 1;
+    }
+    if (strncmp(name, "MTZ_IND", 5) == 0) {
+        parsed.id = SOLVE_MTZ_IND;
+        parsed.edge_type = DIR_EDGE;
+        parsed.name = "MTZ with indicator constraints";
+        parsed.use_cplex = 1;
+    }
+    if (strncmp(name, "GG", 2) == 0) {
+        parsed.id = SOLVE_GG;
+        parsed.edge_type = DIR_EDGE;
+        parsed.name = "GG";
+        parsed.use_cplex = 1;
+    }
+
+    // Undirected graph methods
+    if (strncmp(name, "LOOP", 4) == 0) {
+        parsed.id = SOLVE_LOOP;
+        parsed.edge_type = UDIR_EDGE;
+        parsed.name = "BENDERS' LOOP";
+        parsed.use_cplex = 1;
+    }
+    if (strncmp(name, "CALLBACK", 8) == 0) {
+        parsed.id = SOLVE_CALLBACK;
+        parsed.edge_type = UDIR_EDGE;
+        parsed.name = "INCUBEMENT CALLBACK";
+        parsed.use_cplex = 1;
+    }
+    if (strncmp(name, "USER_CUT", 9) == 0) {
+        parsed.id = SOLVE_UCUT;
+        parsed.edge_type = UDIR_EDGE;
+        parsed.name = "USER CUT CALLBACK";
+        parsed.use_cplex = 1;
+    }
+    if (strncmp(name, "CALLBACK_2OPT", 14) == 0) {
+        parsed.id = SOLVE_CALLBACK;
+        parsed.edge_type = UDIR_EDGE;
+        parsed.name = "INCUBEMENT CALLBACK WITH 2OPT";
+        parsed.use_cplex = 1;
+        callback_2opt = 1;
+    }
+    if (strncmp(name, "USER_CUT_2OPT", 13) == 0) {
+        parsed.id = SOLVE_UCUT;
+        parsed.edge_type = UDIR_EDGE;
+        parsed.name = "USER CUT CALLBACK WITH 2OPT";
+        parsed.use_cplex = 1;
+        callback_2opt = 1;
+    }
+    if (strncmp(name, "HARD_FIX", 8) == 0) {
+        parsed.id = SOLVE_HARD_FIXING;
+        parsed.edge_type = UDIR_EDGE;
+        parsed.name = "HARD FIXING HEURISTIC FIXED PROB";
+        parsed.use_cplex = 1;
+    }
+    if (strncmp(name, "HARD_FIX2", 9) == 0) {
+        parsed.id = SOLVE_HARD_FIXING2;
+        parsed.edge_type = UDIR_EDGE;
+        parsed.name = "HARD FIXING HEURISTIC VARIABLE PROB";
+        parsed.use_cplex = 1;
+    }
+    if (strncmp(name, "SOFT_FIX", 8) == 0) {
+        parsed.id = SOLVE_SOFT_FIXING;
+        parsed.edge_type = UDIR_EDGE;
+        parsed.name = "SOFT FIXING HEURISTIC";
+        parsed.use_cplex = 1;
+    }
+    if (strncmp(name, "GREEDY", 6) == 0) {
+        parsed.id = SOLVE_GREEDY;
+        parsed.edge_type = UDIR_EDGE;
+        parsed.name = "GREEDY HEURISTIC";
+        parsed.use_cplex = 0;
+    }
+    if (strncmp(name, "GREEDY_ITER", 11) == 0) {
+        parsed.id = SOLVE_GREEDY_ITER;
+        parsed.edge_type = UDIR_EDGE;
+        parsed.name = "GREEDY ITERATIVE HEURISTIC";
+        parsed.use_cplex = 0;
+    }
+    if (strncmp(name, "EXTR_MIL", 6) == 0) {
+        parsed.id = SOLVE_EXTR_MIL;
+        parsed.edge_type = UDIR_EDGE;
+        parsed.name = "EXTRA MILEAGE HEURISTIC";
+        parsed.use_cplex = 0;
+    }
+    if (strncmp(name, "GRASP", 5) == 0) {
+        parsed.id = SOLVE_GRASP;
+        parsed.edge_type = UDIR_EDGE;
+        parsed.name = "GRASP HEURISTIC";
+        parsed.use_cplex = 0;
+    }
+    if (strncmp(name, "GRASP_ITER", 10) == 0) {
+        parsed.id = SOLVE_GRASP_ITER;
+        parsed.edge_type = UDIR_EDGE;
+        parsed.name = "GRASP ITERATIVE HEURISTIC";
+        parsed.use_cplex = 0;
+    }
+    if (strncmp(name, "2OPT_GRASP", 9) == 0) {
+        parsed.id = SOLVE_2OPT_GRASP;
+        parsed.edge_type = UDIR_EDGE;
+        parsed.name = "2-OPT HEURISTIC WITH GRASP INITIALIZATION";
+        parsed.use_cplex = 0;
+    }
+    if (strncmp(name, "2OPT_GRASP_ITER", 15) == 0) {
+        parsed.id = SOLVE_2OPT_GRASP_ITER;
+        parsed.edge_type = UDIR_EDGE;
+        parsed.name = "2-OPT HEURISTIC WITH ITERATIVE GRASP INITIALIZATION";
+        parsed.use_cplex = 0;
+    }
+    if (strncmp(name, "2OPT_GREEDY", 11) == 0) {
+        parsed.id = SOLVE_2OPT_GREEDY;
+        parsed.edge_type = UDIR_EDGE;
+        parsed.name = "2-OPT HEURISTIC WITH GREEDY INITIALIZATION";
+        parsed.use_cplex = 0;
+    }
+    if (strncmp(name, "2OPT_GREEDY_ITER", 16) == 0) {
+        parsed.id = SOLVE_2OPT_GREEDY_ITER;
+        parsed.edge_type = UDIR_EDGE;
+        parsed.name = "2-OPT HEURISTIC WITH ITERATIVE GREEDY INITIALIZATION";
+        parsed.use_cplex = 0;
+    }
+    if (strncmp(name, "2OPT_EXTR_MIL", 13) == 0) {
+        parsed.id = SOLVE_2OPT_EXTR_MIL;
+        parsed.edge_type = UDIR_EDGE;
+        parsed.name = "2-OPT HEURISTIC WITH EXTRA MILEAGE INITIALIZATION";
+        parsed.use_cplex = 0;
+    }
+    if (strncmp(name, "3OPT_GRASP", 10) == 0) {
+        parsed.id = SOLVE_3OPT_GRASP;
+        parsed.edge_type = UDIR_EDGE;
+        parsed.name = "3-OPT HEURISTIC WITH GRASP INITIALIZATION";
+        parsed.use_cplex = 0;
+    }
+    if (strncmp(name, "3OPT_GRASP_ITER", 15) == 0) {
+        parsed.id = SOLVE_3OPT_GRASP_ITER;
+        parsed.edge_type = UDIR_EDGE;
+        parsed.name = "3-OPT HEURISTIC WITH ITERATIVE GRASP INITIALIZATION";
+        parsed.use_cplex = 0;
+    }
+    if (strncmp(name, "3OPT_GREEDY", 11) == 0) {
+        parsed.id = SOLVE_3OPT_GREEDY;
+        parsed.edge_type = UDIR_EDGE;
+        parsed.name = "3-OPT HEURISTIC WITH GREEDY INITIALIZATION";
+        parsed.use_cplex = 0;
+    }
+    if (strncmp(name, "3OPT_GREEDY_ITER", 16) == 0) {
+        parsed.id = SOLVE_3OPT_GREEDY_ITER;
+        parsed.edge_type = UDIR_EDGE;
+        parsed.name = "3-OPT HEURISTIC WITH ITERATIVE GREEDY INITIALIZATION";
+        parsed.use_cplex = 0;
+    }
+    if (strncmp(name, "3OPT_EXTR_MIL", 13) == 0) {
+        parsed.id = SOLVE_3OPT_EXTR_MIL;
+        parsed.edge_type = UDIR_EDGE;
+        parsed.name = "3-OPT HEURISTIC WITH EXTRA MILEAGE INITIALIZATION";
+        parsed.use_cplex = 0;
+    }
+    if (strncmp(name, "LK", 2) == 0) {
+        parsed.id = SOLVE_LK;
+        parsed.edge_type = UDIR_EDGE;
+        parsed.name = "LIN-KERNIGHAN HEURISTIC WITH GREEDY INITIALIZATION";
+        parsed.use_cplex = 0;
+    }
+    if (strncmp(name, "VNS", 3) == 0) {
+        parsed.id = SOLVE_VNS;
+        parsed.edge_type = UDIR_EDGE;
+        parsed.name = "VNS META-HEURISTIC";
+        parsed.use_cplex = 0;
+    }
+    if (strncmp(name, "TABU_STEP", 9) == 0) {
+        parsed.id = SOLVE_TABU_STEP;
+        parsed.edge_type = UDIR_EDGE;
+        parsed.name = "TABU SEARCH META-HEURISTIC WITH STEP POLICY";
+        parsed.use_cplex = 0;
+    }
+    if (strncmp(name, "TABU_LIN", 8) == 0) {
+        parsed.id = SOLVE_TABU_LIN;
+        parsed.edge_type = UDIR_EDGE;
+        parsed.name = "TABU SEARCH META-HEURISTIC WITH LINEAR POLICY";
+        parsed.use_cplex = 0;
+    }
+    if (strncmp(name, "TABU_RAND", 9) == 0) {
+        parsed.id = SOLVE_TABU_RAND;
+        parsed.edge_type = UDIR_EDGE;
+        parsed.name = "TABU SEARCH META-HEURISTIC WITH RANDOM POLICY";
+        parsed.use_cplex = 0;
+    }
+    if (strncmp(name, "GENETIC", 7) == 0) {
+        parsed.id = SOLVE_GENETIC;
+        parsed.edge_type = UDIR_EDGE;
+        parsed.name = "GENETIC ALGORITHM META-HEURISTIC";
+        parsed.use_cplex = 0;
+    }
+
+    if (parsed.name == NULL) { return 0; } // Unknown method
+    params->method = parsed;
+    params->callback_2opt = callback_2opt;
+    return 1;
+}
+
 void parse_comand_line(int argc, const char *argv[], instance *inst) {
 
     if (argc <= 1) {
@@ -62,6 +322,32 @@ void parse_comand_line(int argc, const char *argv[], instance *inst) {
     inst->params.seed = time(NULL); // We want to specify the random seed as the current time in order to have a real randomness when user doesn't explicitly choose the seed
     inst->params.perf_prof = 0;
     inst->params.callback_2opt = 0;
+    inst->params.dist_type = DIST_MATRIX_AUTO;
+    inst->params.dist_mem_limit = DEFAULT_DIST_MEM_LIMIT;
+    inst->params.dist_cache_mem = -1;
+    inst->params.cand_k = DEFAULT_CAND_K;
+    inst->params.cand_quadrant = 0;
+    inst->params.cand_type = CAND_KNN;
+    inst->params.refine = REFINE_2OPT;
+    inst->params.sparse_model = 0;
+    inst->params.inst_cache = 0;
+    inst->params.batch_path = NULL;
+    inst->params.batch_output = NULL;
+    inst->params.batch_jobs = 1;
+    inst->params.batch = 0;
+    inst->params.warmstart_path = NULL;
+    inst->params.gen_type = GEN_NONE;
+    inst->params.gen_nodes = DEFAULT_GEN_NODES;
+    inst->params.gen_weight = EUC_2D;
+    inst->params.gen_capacity = -1;
+    inst->params.gen_output = NULL;
+    inst->params.export_format = EXPORT_AUTO;
+    inst->params.export_path = NULL;
+    inst->params.export_async = 0;
+    inst->params.stream_path = NULL;
+    inst->params.stream_tour = 0;
+    inst->params.perf_csv = NULL;
+    inst->params.result_cache = NULL;
     inst->name = NULL;
     inst->comment = NULL;
     inst->nodes = NULL;
@@ -69,6 +355,38 @@ void parse_comand_line(int argc, const char *argv[], instance *inst) {
     inst->thread_seeds = NULL;
     inst->solution.edges = NULL;
     inst->solution.xbest = NULL;
+    inst->dist.data = NULL;
+    inst->dist.size = 0;
+    inst->dist.map = NULL;
+    inst->dist.map_size = 0;
+    inst->xcoord = NULL;
+    inst->ycoord = NULL;
+    inst->geo = NULL;
+    inst->cache.rows = NULL;
+    inst->cache.slot_of = NULL;
+    inst->cache.owner = NULL;
+    inst->cache.ref = NULL;
+    inst->cache.miss_count = NULL;
+    inst->cache.miss_epoch = NULL;
+    inst->tree.idx = NULL;
+    inst->tree.pos = NULL;
+    inst->tree.axis = NULL;
+    inst->tree.size = NULL;
+    inst->delaunay.start = NULL;
+    inst->delaunay.adj = NULL;
+    inst->cand.list = NULL;
+    inst->cand.start = NULL;
+    inst->cand.k = 0;
+    inst->columns.start = NULL;
+    inst->columns.adj = NULL;
+    inst->columns.col = NULL;
+    inst->columns.num_columns = 0;
+    inst->warm_tour = NULL;
+    inst->export_job = NULL;
+    inst->stream = NULL;
+    inst->dist_fn = NULL;
+    inst->int_dist_fn = NULL;
+    inst->is_copy = false;
     inst->is_vrp = false;
     inst->num_vehicles = 1; // At least one vehicle
     int need_help = 0;
@@ -78,7 +396,7 @@ void parse_comand_line(int argc, const char *argv[], instance *inst) {
         if (strcmp("-f", argv[i]) == 0) { 
             if (check_input_index_validity(i, argc, &need_help)) continue;
             const char* path = argv[++i];
-            inst->params.file_path = CALLOC(strlen(path), char);
+            inst->params.file_path = CALLOC(strlen(path) + 1, char);
             strncpy(inst->params.file_path, path, strlen(path)); 
             continue; 
         } // Input file
@@ -105,192 +423,190 @@ void parse_comand_line(int argc, const char *argv[], instance *inst) {
         }
         if (strcmp("-method", argv[i]) == 0) {
             if (check_input_index_validity(i, argc, &need_help)) continue;
-            const char* method = argv[++i];
-            
-            // Directed graph methods
-            if (strncmp(method, "MTZ", 3) == 0) {
-                inst->params.method.id = SOLVE_MTZ;
-                inst->params.method.edge_type = DIR_EDGE;
-                inst->params.method.name = "MTZ Static";
-                inst->params.method.use_cplex = 1;
-            }
-            if (strncmp(method, "MTZL", 4) == 0) {
-                inst->params.method.id = SOLVE_MTZL;
-                inst->params.method.edge_type = DIR_EDGE;
-                inst->params.method.name = "MTZ Lazy";
-                inst->params.method.use_cplex = 1;
-            }
-            if (strncmp(method, "MTZI", 4) == 0) {
-                inst->params.method.id = SOLVE_MTZI;
-                inst->params.method.edge_type = DIR_EDGE;
-                inst->params.method.name = "MTZ with SEC of degree 2";
-                inst->params.method.use_cplex = 1;
-            }
-            if (strncmp(method, "MTZLI", 5) == 0) {
-                inst->params.method.id = SOLVE_MTZLI;
-                inst->params.method.edge_type = DIR_EDGE;
-                inst->params.method.name = "MTZ lazy with SEC of degree 2";
-                inst->params.method.use_cplex = 1;
-            }
-            if (strncmp(method, "MTZ_IND", 5) == 0) {
-                inst->params.method.id = SOLVE_MTZ_IND;
-                inst->params.method.edge_type = DIR_EDGE;
-                inst->params.method.name = "MTZ with indicator constraints";
-                inst->params.method.use_cplex = 1;
-            }
-            if (strncmp(method, "GG", 2) == 0) {
-                inst->params.method.id = SOLVE_GG;
-                inst->params.method.edge_type = DIR_EDGE;
-                inst->params.method.name = "GG";
-                inst->params.method.use_cplex = 1;
-            }
-
-            // Undirected graph methods
-            if (strncmp(method, "LOOP", 4) == 0) {
-                inst->params.method.id = SOLVE_LOOP;
-                inst->params.method.edge_type = UDIR_EDGE;
-                inst->params.method.name = "BENDERS' LOOP";
-                inst->params.method.use_cplex = 1;
-            }
-            if (strncmp(method, "CALLBACK", 8) == 0) {
-                inst->params.method.id = SOLVE_CALLBACK;
-                inst->params.method.edge_type = UDIR_EDGE;
-                inst->params.method.name = "INCUBEMENT CALLBACK";
-                inst->params.method.use_cplex = 1;
-            }
-            if (strncmp(method, "USER_CUT", 9) == 0) {
-                inst->params.method.id = SOLVE_UCUT;
-                inst->params.method.edge_type = UDIR_EDGE;
-                inst->params.method.name = "USER CUT CALLBACK";
-                inst->params.method.use_cplex = 1;
-            }
-            if (strncmp(method, "CALLBACK_2OPT", 14) == 0) {
-                inst->params.method.id = SOLVE_CALLBACK;
-                inst->params.method.edge_type = UDIR_EDGE;
-                inst->params.method.name = "INCUBEMENT CALLBACK WITH 2OPT";
-                inst->params.method.use_cplex = 1;
-                inst->params.callback_2opt = 1;
-            }
-            if (strncmp(method, "USER_CUT_2OPT", 13) == 0) {
-                inst->params.method.id = SOLVE_UCUT;
-                inst->params.method.edge_type = UDIR_EDGE;
-                inst->params.method.name = "USER CUT CALLBACK WITH 2OPT";
-                inst->params.method.use_cplex = 1;
-                inst->params.callback_2opt = 1;
-            }
-            if (strncmp(method, "HARD_FIX", 8) == 0) {
-                inst->params.method.id = SOLVE_HARD_FIXING;
-                inst->params.method.edge_type = UDIR_EDGE;
-                inst->params.method.name = "HARD FIXING HEURISTIC FIXED PROB";
-                inst->params.method.use_cplex = 1;
-            }
-            if (strncmp(method, "HARD_FIX2", 9) == 0) {
-                inst->params.method.id = SOLVE_HARD_FIXING2;
-                inst->params.method.edge_type = UDIR_EDGE;
-                inst->params.method.name = "HARD FIXING HEURISTIC VARIABLE PROB";
-                inst->params.method.use_cplex = 1;
-            }
-            if (strncmp(method, "SOFT_FIX", 8) == 0) {
-                inst->params.method.id = SOLVE_SOFT_FIXING;
-                inst->params.method.edge_type = UDIR_EDGE;
-                inst->params.method.name = "SOFT FIXING HEURISTIC";
-                inst->params.method.use_cplex = 1;
-            }
-            if (strncmp(method, "GREEDY", 6) == 0) {
-                inst->params.method.id = SOLVE_GREEDY;
-                inst->params.method.edge_type = UDIR_EDGE;
-                inst->params.method.name = "GREEDY HEURISTIC";
-                inst->params.method.use_cplex = 0;
-            }
-            if (strncmp(method, "GREEDY_ITER", 11) == 0) {
-                inst->params.method.id = SOLVE_GREEDY_ITER;
-                inst->params.method.edge_type = UDIR_EDGE;
-                inst->params.method.name = "GREEDY ITERATIVE HEURISTIC";
-                inst->params.method.use_cplex = 0;
-            }
-            if (strncmp(method, "EXTR_MIL", 6) == 0) {
-                inst->params.method.id = SOLVE_EXTR_MIL;
-                inst->params.method.edge_type = UDIR_EDGE;
-                inst->params.method.name = "EXTRA MILEAGE HEURISTIC";
-                inst->params.method.use_cplex = 0;
-            }
-            if (strncmp(method, "GRASP", 5) == 0) {
-                inst->params.method.id = SOLVE_GRASP;
-                inst->params.method.edge_type = UDIR_EDGE;
-                inst->params.method.name = "GRASP HEURISTIC";
-                inst->params.method.use_cplex = 0;
-            }
-            if (strncmp(method, "GRASP_ITER", 10) == 0) {
-                inst->params.method.id = SOLVE_GRASP_ITER;
-                inst->params.method.edge_type = UDIR_EDGE;
-                inst->params.method.name = "GRASP ITERATIVE HEURISTIC";
-                inst->params.method.use_cplex = 0;
-            }
-            if (strncmp(method, "2OPT_GRASP", 9) == 0) {
-                inst->params.method.id = SOLVE_2OPT_GRASP;
-                inst->params.method.edge_type = UDIR_EDGE;
-                inst->params.method.name = "2-OPT HEURISTIC WITH GRASP INITIALIZATION";
-                inst->params.method.use_cplex = 0;
-            }
-            if (strncmp(method, "2OPT_GRASP_ITER", 15) == 0) {
-                inst->params.method.id = SOLVE_2OPT_GRASP_ITER;
-                inst->params.method.edge_type = UDIR_EDGE;
-                inst->params.method.name = "2-OPT HEURISTIC WITH ITERATIVE GRASP INITIALIZATION";
-                inst->params.method.use_cplex = 0;
-            }
-            if (strncmp(method, "2OPT_GREEDY", 11) == 0) {
-                inst->params.method.id = SOLVE_2OPT_GREEDY;
-                inst->params.method.edge_type = UDIR_EDGE;
-                inst->params.method.name = "2-OPT HEURISTIC WITH GREEDY INITIALIZATION";
-                inst->params.method.use_cplex = 0;
-            }
-            if (strncmp(method, "2OPT_GREEDY_ITER", 16) == 0) {
-                inst->params.method.id = SOLVE_2OPT_GREEDY_ITER;
-                inst->params.method.edge_type = UDIR_EDGE;
-                inst->params.method.name = "2-OPT HEURISTIC WITH ITERATIVE GREEDY INITIALIZATION";
-                inst->params.method.use_cplex = 0;
-            }
-            if (strncmp(method, "2OPT_EXTR_MIL", 13) == 0) {
-                inst->params.method.id = SOLVE_2OPT_EXTR_MIL;
-                inst->params.method.edge_type = UDIR_EDGE;
-                inst->params.method.name = "2-OPT HEURISTIC WITH EXTRA MILEAGE INITIALIZATION";
-                inst->params.method.use_cplex = 0;
-            }
-            if (strncmp(method, "VNS", 3) == 0) {
-                inst->params.method.id = SOLVE_VNS;
-                inst->params.method.edge_type = UDIR_EDGE;
-                inst->params.method.name = "VNS META-HEURISTIC";
-                inst->params.method.use_cplex = 0;
-            }
-            if (strncmp(method, "TABU_STEP", 9) == 0) {
-                inst->params.method.id = SOLVE_TABU_STEP;
-                inst->params.method.edge_type = UDIR_EDGE;
-                inst->params.method.name = "TABU SEARCH META-HEURISTIC WITH STEP POLICY";
-                inst->params.method.use_cplex = 0;
+            parse_method(argv[++i], &inst->params);
+            continue;
+        }
+        if (strcmp("-seed", argv[i]) == 0) {
+            if (check_input_index_validity(i, argc, &need_help)) continue;
+            inst->params.seed = atoi(argv[++i]);
+            continue;
+        }
+        if (strcmp("-distmat", argv[i]) == 0) {
+            if (check_input_index_validity(i, argc, &need_help)) continue;
+            const char* type = argv[++i];
+            if (strcmp(type, "OFF") == 0) { inst->params.dist_type = DIST_MATRIX_OFF; }
+            else if (strcmp(type, "AUTO") == 0) { inst->params.dist_type = DIST_MATRIX_AUTO; }
+            else if (strcmp(type, "DOUBLE") == 0) { inst->params.dist_type = DIST_MATRIX_DOUBLE; }
+            else if (strcmp(type, "FLOAT") == 0) { inst->params.dist_type = DIST_MATRIX_FLOAT; }
+            else if (strcmp(type, "INT") == 0) { inst->params.dist_type = DIST_MATRIX_INT; }
+            else { need_help = 1; }
+            continue;
+        }
+        if (strcmp("-distmem", argv[i]) == 0) {
+            if (check_input_index_validity(i, argc, &need_help)) continue;
+            inst->params.dist_mem_limit = atol(argv[++i]);
+            continue;
+        }
+        if (strcmp("-distcache", argv[i]) == 0) {
+            if (check_input_index_validity(i, argc, &need_help)) continue;
+            inst->params.dist_cache_mem = atol(argv[++i]);
+            continue;
+        }
+        if (strcmp("-cand", argv[i]) == 0) {
+            if (check_input_index_validity(i, argc, &need_help)) continue;
+            int cand_k = atoi(argv[++i]);
+            if (cand_k < 0) {
+                LOG_E("The number of candidate neighbors must be at least 0");
             }
-            if (strncmp(method, "TABU_LIN", 8) == 0) {
-                inst->params.method.id = SOLVE_TABU_LIN;
-                inst->params.method.edge_type = UDIR_EDGE;
-                inst->params.method.name = "TABU SEARCH META-HEURISTIC WITH LINEAR POLICY";
-                inst->params.method.use_cplex = 0;
+            inst->params.cand_k = cand_k;
+            continue;
+        }
+        if (strcmp("--candquad", argv[i]) == 0) { inst->params.cand_quadrant = 1; continue; }
+        if (strcmp("-candtype", argv[i]) == 0) {
+            if (check_input_index_validity(i, argc, &need_help)) continue;
+            const char* type = argv[++i];
+            if (strcmp(type, "KNN") == 0) { inst->params.cand_type = CAND_KNN; }
+            else if (strcmp(type, "DELAUNAY") == 0) { inst->params.cand_type = CAND_DELAUNAY; }
+            else if (strcmp(type, "UNION") == 0) { inst->params.cand_type = CAND_UNION; }
+            else { need_help = 1; }
+            continue;
+        }
+        if (strcmp("--sparse", argv[i]) == 0) { inst->params.sparse_model = 1; continue; }
+        if (strcmp("--cache", argv[i]) == 0) { inst->params.inst_cache = 1; continue; }
+        if (strcmp("-batch", argv[i]) == 0) {
+            if (check_input_index_validity(i, argc, &need_help)) continue;
+            const char* path = argv[++i];
+            FREE(inst->params.batch_path);
+            inst->params.batch_path = CALLOC(strlen(path) + 1, char);
+            memcpy(inst->params.batch_path, path, strlen(path));
+            continue;
+        }
+        if (strcmp("-batchout", argv[i]) == 0) {
+            if (check_input_index_validity(i, argc, &need_help)) continue;
+            const char* path = argv[++i];
+            FREE(inst->params.batch_output);
+            inst->params.batch_output = CALLOC(strlen(path) + 1, char);
+            memcpy(inst->params.batch_output, path, strlen(path));
+            continue;
+        }
+        if (strcmp("-warmstart", argv[i]) == 0) {
+            if (check_input_index_validity(i, argc, &need_help)) continue;
+            const char* path = argv[++i];
+            FREE(inst->params.warmstart_path);
+            inst->params.warmstart_path = CALLOC(strlen(path) + 1, char);
+            memcpy(inst->params.warmstart_path, path, strlen(path));
+            continue;
+        }
+        if (strcmp("-jobs", argv[i]) == 0) {
+            if (check_input_index_validity(i, argc, &need_help)) continue;
+            int jobs = atoi(argv[++i]);
+            if (jobs < 1) {
+                LOG_E("The number of concurrent runs must be at least 1");
             }
-            if (strncmp(method, "TABU_RAND", 9) == 0) {
-                inst->params.method.id = SOLVE_TABU_RAND;
-                inst->params.method.edge_type = UDIR_EDGE;
-                inst->params.method.name = "TABU SEARCH META-HEURISTIC WITH RANDOM POLICY";
-                inst->params.method.use_cplex = 0;
+            inst->params.batch_jobs = jobs;
+            continue;
+        }
+        if (strcmp("-gen", argv[i]) == 0) {
+            if (check_input_index_validity(i, argc, &need_help)) continue;
+            const char* type = argv[++i];
+            if (strcmp(type, "UNIFORM") == 0) { inst->params.gen_type = GEN_UNIFORM; }
+            else if (strcmp(type, "CLUSTERED") == 0) { inst->params.gen_type = GEN_CLUSTERED; }
+            else if (strcmp(type, "GRID") == 0) { inst->params.gen_type = GEN_GRID; }
+            else { need_help = 1; }
+            continue;
+        }
+        if (strcmp("-gennodes", argv[i]) == 0) {
+            if (check_input_index_validity(i, argc, &need_help)) continue;
+            int nodes = atoi(argv[++i]);
+            if (nodes < 1) {
+                LOG_E("The generated instance must have at least one node");
             }
-            if (strncmp(method, "GENETIC", 7) == 0) {
-                inst->params.method.id = SOLVE_GENETIC;
-                inst->params.method.edge_type = UDIR_EDGE;
-                inst->params.method.name = "GENETIC ALGORITHM META-HEURISTIC";
-                inst->params.method.use_cplex = 0;
+            inst->params.gen_nodes = nodes;
+            continue;
+        }
+        if (strcmp("-genweight", argv[i]) == 0) {
+            if (check_input_index_validity(i, argc, &need_help)) continue;
+            const char* type = argv[++i];
+            if (strcmp(type, "EUC_2D") == 0) { inst->params.gen_weight = EUC_2D; }
+            else if (strcmp(type, "MAX_2D") == 0) { inst->params.gen_weight = MAX_2D; }
+            else if (strcmp(type, "MAN_2D") == 0) { inst->params.gen_weight = MAN_2D; }
+            else if (strcmp(type, "CEIL_2D") == 0) { inst->params.gen_weight = CEIL_2D; }
+            else if (strcmp(type, "GEO") == 0) { inst->params.gen_weight = GEO; }
+            else if (strcmp(type, "ATT") == 0) { inst->params.gen_weight = ATT; }
+            else if (strcmp(type, "EXPLICIT") == 0) { inst->params.gen_weight = EXPLICIT; }
+            else { need_help = 1; }
+            continue;
+        }
+        if (strcmp("-genvrp", argv[i]) == 0) {
+            if (check_input_index_validity(i, argc, &need_help)) continue;
+            int capacity = atoi(argv[++i]);
+            if (capacity < 0) {
+                LOG_E("The vehicle capacity must be at least 0");
             }
+            inst->params.gen_capacity = capacity;
             continue;
         }
-        if (strcmp("-seed", argv[i]) == 0) {
+        if (strcmp("-genout", argv[i]) == 0) {
             if (check_input_index_validity(i, argc, &need_help)) continue;
-            inst->params.seed = atoi(argv[++i]);
+            const char* path = argv[++i];
+            FREE(inst->params.gen_output);
+            inst->params.gen_output = CALLOC(strlen(path) + 1, char);
+            memcpy(inst->params.gen_output, path, strlen(path));
+            continue;
+        }
+        if (strcmp("-export", argv[i]) == 0) {
+            if (check_input_index_validity(i, argc, &need_help)) continue;
+            const char* path = argv[++i];
+            FREE(inst->params.export_path);
+            inst->params.export_path = CALLOC(strlen(path) + 1, char);
+            memcpy(inst->params.export_path, path, strlen(path));
+            continue;
+        }
+        if (strcmp("-refine", argv[i]) == 0) {
+            if (check_input_index_validity(i, argc, &need_help)) continue;
+            const char* type = argv[++i];
+            if (strcmp(type, "2OPT") == 0) { inst->params.refine = REFINE_2OPT; }
+            else if (strcmp(type, "2OPT_CAND") == 0) { inst->params.refine = REFINE_2OPT_CAND; }
+            else if (strcmp(type, "2OPT_OROPT") == 0) { inst->params.refine = REFINE_2OPT_OROPT; }
+            else if (strcmp(type, "LK") == 0) { inst->params.refine = REFINE_LK; }
+            else { need_help = 1; }
+            continue;
+        }
+        if (strcmp("-exportfmt", argv[i]) == 0) {
+            if (check_input_index_validity(i, argc, &need_help)) continue;
+            const char* type = argv[++i];
+            if (strcmp(type, "AUTO") == 0) { inst->params.export_format = EXPORT_AUTO; }
+            else if (strcmp(type, "NONE") == 0) { inst->params.export_format = EXPORT_NONE; }
+            else if (strcmp(type, "TOUR") == 0) { inst->params.export_format = EXPORT_TOUR; }
+            else if (strcmp(type, "BINARY") == 0) { inst->params.export_format = EXPORT_BINARY; }
+            else if (strcmp(type, "JSON") == 0) { inst->params.export_format = EXPORT_JSON; }
+            else { need_help = 1; }
+            continue;
+        }
+        if (strcmp("--asyncexport", argv[i]) == 0) { inst->params.export_async = 1; continue; }
+        if (strcmp("-stream", argv[i]) == 0) {
+            if (check_input_index_validity(i, argc, &need_help)) continue;
+            const char* path = argv[++i];
+            FREE(inst->params.stream_path);
+            inst->params.stream_path = CALLOC(strlen(path) + 1, char);
+            memcpy(inst->params.stream_path, path, strlen(path));
+            continue;
+        }
+        if (strcmp("--streamtour", argv[i]) == 0) { inst->params.stream_tour = 1; continue; }
+        if (strcmp("-perfcsv", argv[i]) == 0) {
+            if (check_input_index_validity(i, argc, &need_help)) continue;
+            const char* path = argv[++i];
+            FREE(inst->params.perf_csv);
+            inst->params.perf_csv = CALLOC(strlen(path) + 1, char);
+            memcpy(inst->params.perf_csv, path, strlen(path));
+            continue;
+        }
+        if (strcmp("-resultcache", argv[i]) == 0) {
+            if (check_input_index_validity(i, argc, &need_help)) continue;
+            const char* path = argv[++i];
+            FREE(inst->params.result_cache);
+            inst->params.result_cache = CALLOC(strlen(path) + 1, char);
+            memcpy(inst->params.result_cache, path, strlen(path));
             continue;
         }
         if (strcmp("--fcost", argv[i]) == 0) { inst->params.integer_cost = 0; continue; }
@@ -301,6 +617,15 @@ void parse_comand_line(int argc, const char *argv[], instance *inst) {
         need_help = 1;
     }
 
+    // The runs of a batch write their results only in the batch report
+    if (inst->params.batch_path != NULL) {
+        const char *option = inst->params.export_path != NULL ? "-export" :
+                             inst->params.stream_path != NULL ? "-stream" :
+                             inst->params.perf_csv != NULL ? "-perfcsv" :
+                             inst->params.result_cache != NULL ? "-resultcache" : NULL;
+        if (option != NULL) { LOG_E("%s is not supported with -batch: the results of the runs are written in the report of -batchout", option); }
+    }
+
     if (show_methods) {
         printf("MTZ                MTZ with static constraints\n");
         printf("MTZL               MTZ with lazy constraints\n");
@@ -326,6 +651,12 @@ void parse_comand_line(int argc, const char *argv[], instance *inst) {
         printf("2OPT_GREEDY        2-OPT with Greedy initialization\n");
         printf("2OPT_GREEDY_ITER   2-OPT with iterative Greedy initialization\n");
         printf("2OPT_EXTR_MIL      2-OPT with extra mileage initialization\n");
+        printf("3OPT_GRASP         3-OPT on the candidate lists with GRASP initialization\n");
+        printf("3OPT_GRASP_ITER    3-OPT on the candidate lists with iterative GRASP initialization\n");
+        printf("3OPT_GREEDY        3-OPT on the candidate lists with Greedy initialization\n");
+        printf("3OPT_GREEDY_ITER   3-OPT on the candidate lists with iterative Greedy initialization\n");
+        printf("3OPT_EXTR_MIL      3-OPT on the candidate lists with extra mileage initialization\n");
+        printf("LK                 Lin-Kernighan style local search on the candidate lists with Greedy initialization\n");
         printf("VNS                VNS method\n");
         printf("TABU_STEP          TABU Search method with step policy\n");
         printf("TABU_LIN           TABU Search method with linear policy\n");
@@ -343,6 +674,31 @@ void parse_comand_line(int argc, const char *argv[], instance *inst) {
         printf("-verbose <level>          The verbosity level of the debugging printing\n");
         printf("-method <type>            The method used to solve the problem. Use \"--methods\" to see the list of available methods\n");
         printf("-seed <seed>              The seed for random generation\n");
+        printf("-distmat <type>           The distance matrix type: AUTO, DOUBLE, FLOAT, INT or OFF. Default AUTO\n");
+        printf("-distmem <MB>             The max memory in MB used by the distance matrix. Default %d\n", DEFAULT_DIST_MEM_LIMIT);
+        printf("-distcache <MB>           The max memory in MB used by the distance rows cache when the matrix is not built. 0 disables it. By default %d MB for ATT and GEO instances only\n", DEFAULT_DIST_CACHE_MEM);
+        printf("-cand <k>                 The number of neighbors in the candidate lists. 0 disables them. Default %d\n", DEFAULT_CAND_K);
+        printf("--candquad                Balance the candidate lists between the four quadrants around each node\n");
+        printf("-candtype <type>          The neighbors in the candidate lists: KNN, DELAUNAY or UNION. Default KNN\n");
+        printf("-refine <type>            The local search of the 2OPT methods, VNS and the 2-opt callbacks: 2OPT (every pair of edges), 2OPT_CAND (candidate lists) or 2OPT_OROPT (2-opt and Or-opt on the candidate lists) or LK (Lin-Kernighan style moves on the candidate lists). The last two are also applied to the tabu result. Default 2OPT\n");
+        printf("--sparse                  Use only the edges of the candidate lists in the cplex models. The undirected models get only their columns, the directed ones (MTZ, GG) fix the other arcs to 0\n");
+        printf("--cache                   Load the instance from its binary cache, written next to the instance file at the first run\n");
+        printf("-batch <dir or manifest>  Solve the instances of a directory, or the \"instance [method] [seed]\" lines of a manifest, in one process. It can't be used with -export, -stream, -perfcsv and -resultcache\n");
+        printf("-batchout <file>          The report of the batch: JSON lines if the file ends with .jsonl, CSV otherwise. Default CSV on the standard output\n");
+        printf("-warmstart <file.tour>    Start from the tour of the file instead of building the initial solution. It is the MIP start of the cplex methods\n");
+        printf("-jobs <num runs>          The number of runs of the batch solved concurrently. Each run uses at most \"-threads\" threads. Default 1\n");
+        printf("-gen <type>               Generate the instance instead of reading it: UNIFORM, CLUSTERED or GRID. The seed gives the instance\n");
+        printf("-gennodes <num nodes>     The number of nodes of the generated instance. Default %d\n", DEFAULT_GEN_NODES);
+        printf("-genweight <type>         The weight type of the generated instance: EUC_2D, MAX_2D, MAN_2D, CEIL_2D, GEO, ATT or EXPLICIT. Default EUC_2D\n");
+        printf("-genvrp <capacity>        Generate a CVRP instance with the given vehicle capacity. 0 chooses it for routes of about %d customers\n", GEN_ROUTE_SIZE);
+        printf("-genout <file>            Write the generated instance in a TSPLIB file, and its binary cache with \"--cache\", instead of solving it\n");
+        printf("-export <file>            The path of the exported tour. Default %s/<instance name> with the extension of the format\n", EXPORT_DIR);
+        printf("-exportfmt <format>       The format of the exported tour: TOUR, BINARY (successor array), JSON or NONE. By default chosen from the extension (.succ, .json), TOUR otherwise\n");
+        printf("--asyncexport             Export the tour in background while the program goes on\n");
+        printf("-stream <file or fd:N>    Append a JSON line to the file, named pipe or file descriptor each time the incumbent improves\n");
+        printf("--streamtour              Add the successor of each node to the streamed incumbents\n");
+        printf("-perfcsv <file>           Append the result of the run (instance, method, time, objective, status, seed) to a CSV file shared by parallel runs\n");
+        printf("-resultcache <dir>        Return the stored result of the same run, or start from it when the time limit is longer. The results are stored in dir\n");
         printf("--fcost                   Whether you want float costs in the problem\n");
         printf("--v, --version            Software's current version\n");
         exit(0);
@@ -350,7 +706,16 @@ void parse_comand_line(int argc, const char *argv[], instance *inst) {
 }
 
 void free_instance(instance *inst) {
+    wait_export_tour(inst);
     FREE(inst->params.file_path);
+    FREE(inst->params.batch_path);
+    FREE(inst->params.batch_output);
+    FREE(inst->params.warmstart_path);
+    FREE(inst->params.gen_output);
+    FREE(inst->params.export_path);
+    FREE(inst->params.stream_path);
+    FREE(inst->params.perf_csv);
+    FREE(inst->params.result_cache);
     FREE(inst->name);
     FREE(inst->comment);
     FREE(inst->nodes);
@@ -358,149 +723,58 @@ void free_instance(instance *inst) {
     FREE(inst->thread_seeds);
     FREE(inst->solution.edges);
     FREE(inst->solution.xbest);
+    if (!inst->is_copy) {
+        free_dist_matrix(inst);
+        FREE(inst->xcoord);
+        FREE(inst->ycoord);
+        FREE(inst->geo);
+        FREE(inst->cache.rows);
+        FREE(inst->cache.slot_of);
+        FREE(inst->cache.owner);
+        FREE(inst->cache.ref);
+        FREE(inst->cache.miss_count);
+        FREE(inst->cache.miss_epoch);
+        FREE(inst->tree.idx);
+        FREE(inst->tree.pos);
+        FREE(inst->tree.axis);
+        FREE(inst->tree.size);
+        FREE(inst->delaunay.start);
+        FREE(inst->delaunay.adj);
+        FREE(inst->cand.list);
+        FREE(inst->cand.start);
+        FREE(inst->warm_tour);
+    }
 }
 
 void parse_instance(instance *inst) {
-    if (inst->params.file_path == NULL) { LOG_E("You didn't pass any file!"); }
+    if (inst->params.file_path == NULL && inst->params.gen_type == GEN_NONE) { LOG_E("You didn't pass any file!"); }
 
     //Default values
     inst->num_nodes = -1;
     inst->weight_type = -1;
+    inst->weight_format = -1;
     inst->num_columns = -1;
 
-    // Open file
-    FILE *fp = fopen(inst->params.file_path, "r");
-    if(fp == NULL) { LOG_E("Unable to open file!"); }
-   
-    char line[128];          // 1 line of the file
-    char *par_name;          // name of the parameter in the readed line
-    char *token1;            // value of the parameter in the readed line
-    char *token2;            // second value of the parameter in the readed line (used for reading coordinates)
-    active_section active_section = PARAM_SECTION; 
-    char sep[] = " :\n\t\r"; // separator for parsing
-
-    // Read the file line by line
-    while(fgets(line, sizeof(line), fp) != NULL) {
-        if (strlen(line) <= 1 ) continue; // skip empty lines
-        par_name = strtok(line, sep);
-
-        if(strncmp(par_name, "NAME", 4) == 0){
-			active_section = PARAM_SECTION;
-            token1 = strtok(NULL, sep);
-            inst->name = CALLOC(strlen(token1), char);   
-            strncpy(inst->name, token1, strlen(token1));
-			continue;
-		}
-
-		if(strncmp(par_name, "COMMENT", 7) == 0){
-			active_section = PARAM_SECTION;   
-            inst->comment = NULL; // Need to set this null in order to avoid crashes in free_instance function
-            //We don't do anything with this parameter because we don't care about the comment  
-			continue;
-		}   
-
-        if(strncmp(par_name, "TYPE", 4) == 0){
-            token1 = strtok(NULL, sep);  
-            if(strncmp(token1, "CVRP", 4) == 0) { 
-                inst->is_vrp = true; 
-            };
-            active_section = PARAM_SECTION;
-            continue;
-		}
-
-        if(strncmp(par_name, "DIMENSION", 9) == 0 ){
-            token1 = strtok(NULL, sep);
-            inst->num_nodes = atoi(token1);
-            inst->nodes = CALLOC(inst->num_nodes, node);
-            active_section = PARAM_SECTION;  
-            continue;
-		}
-
-        if(strncmp(par_name, "CAPACITY", 8) == 0 ){
-            token1 = strtok(NULL, sep);
-            inst->capacity = atoi(token1);
-            active_section = PARAM_SECTION;  
-            continue;
-		}
-
-        if(strncmp(par_name, "EOF", 3) == 0 ){
-			active_section = PARAM_SECTION;
-			break;
-		}
-
-        if(strncmp(par_name, "EDGE_WEIGHT_TYPE", 16) == 0 ){
-            token1 = strtok(NULL, sep);
-            if (strncmp(token1, "EUC_2D", 6) == 0) inst->weight_type = EUC_2D;
-            if (strncmp(token1, "MAX_2D", 6) == 0) inst->weight_type = MAX_2D;
-            if (strncmp(token1, "MAN_2D", 6) == 0) inst->weight_type = MAN_2D;
-            if (strncmp(token1, "CEIL_2D", 7) == 0) inst->weight_type = CEIL_2D;
-            if (strncmp(token1, "GEO", 3) == 0) inst->weight_type = GEO;
-            if (strncmp(token1, "ATT", 3) == 0) inst->weight_type = ATT;
-            if (strncmp(token1, "EXPLICIT", 8) == 0) LOG_E("Wrong edge weight type, this program resolve only 2D TSP case with coordinate type.");
-            active_section = PARAM_SECTION;  
-            continue;
-		}
-
-        if (strncmp(par_name, "NODE_COORD_SECTION", 18) == 0){
-            active_section = NODE_COORD_SECTION;
-            continue;
-        }
-
-        if (strncmp(par_name, "EDGE_WEIGHT_SECTION", 19) == 0){
-            active_section = EDGE_WEIGHT_SECTION;
-            continue;
-        }
-
-        if (strncmp(par_name, "DEMAND_SECTION", 14) == 0){
-            active_section = DEMAND_SECTION;
-            continue;
-        }
-
-        if (strncmp(par_name, "DEPOT_SECTION", 13) == 0){
-            active_section = DEPOT_SECTION;
-            continue;
-        }
-
-        // NODE_COORD_SECTION
-        if(active_section == NODE_COORD_SECTION){ 
-            int i = atoi(par_name) - 1; // Nodes in problem's file start from index 1
-			if ( i < 0 || i >= inst->num_nodes) LOG_E(" ... unknown node in NODE_COORD_SECTION");     
-			token1 = strtok(NULL, sep);
-			token2 = strtok(NULL, sep);
-            node p = {atof(token1), atof(token2), 0, false};
-			inst->nodes[i] = p;
-            continue;
-        }
-        
-        // EDGE_WEIGHT_SECTION
-        if (active_section == EDGE_WEIGHT_SECTION) { // Are we going to use this??
+    if (inst->params.gen_type != GEN_NONE) {
+        generate_instance(inst);
+    } else if (inst->params.inst_cache) {
+        parse_tsplib_cached(inst, inst->params.file_path);
+    } else {
+        parse_tsplib_file(inst, inst->params.file_path);
+    }
 
-            continue;
-        }
+    precompute_geo_coords(inst);
 
-        if (active_section == DEMAND_SECTION) {
-            int i = atoi(par_name) - 1; // Nodes in problem's file start from index 1
-			if ( i < 0 || i >= inst->num_nodes) LOG_E(" ... unknown node in DEMAND_SECTION"); 
-            token1 = strtok(NULL, sep);
-			token2 = strtok(NULL, sep);
-            //int node_idx = atoi(token1);
-            int demand = atoi(token1);
-            inst->nodes[i].demand = demand;
-            continue;
-        }
-
-        if (active_section == DEPOT_SECTION) {
-            int i = atoi(par_name) - 1; // Nodes in problem's file start from index 1
-            if (i >= inst->num_nodes) LOG_E(" ... unknown node in DEPOT_SECTION"); 
-            if (i == -1) { continue; }
-            inst->nodes[i].is_depot = true;
-            continue;
-        }
-        
-    }
+    if (inst->params.warmstart_path != NULL) { parse_tour_file(inst, inst->params.warmstart_path); }
+}
 
-    // close file
-    fclose(fp);
+void load_instance(instance *inst) {
+    parse_instance(inst);           // Read the TSP istance
+    build_dist_matrix(inst);        // Precompute the distances when they fit in memory
+    init_dist_kernels(inst);        // Prepare the vectorized distance kernels
+    build_dist_cache(inst);         // Cache the distance rows when the matrix is not built
+    build_kdtree(inst);             // Build the spatial index of the nodes
+    build_candidate_lists(inst);    // Find the nearest neighbors of each node
 }
 
 void print_instance(instance inst) {
@@ -525,7 +799,7 @@ void print_instance(instance inst) {
             if (inst.params.seed >= 0) printf("Seed: %d\n", inst.params.seed);
             printf("Cost: %s\n", inst.params.integer_cost ? "Integer" : "Floating point");
             printf("Verbose: %d\n", inst.params.verbose);
-            printf("File path: %s\n", inst.params.file_path);
+            if (inst.params.file_path != NULL) printf("File path: %s\n", inst.params.file_path);
             printf("\n");
         }
         
@@ -554,6 +828,9 @@ void print_instance(instance inst) {
         case ATT:
             weight = "ATT";
             break;
+        case EXPLICIT:
+            weight = "EXPLICIT";
+            break;
         default:
             weight = "UNKNOWN";
             break;
@@ -571,40 +848,6 @@ void print_instance(instance inst) {
     }
 }
 
-void export_tour(instance *inst) {
-    if (inst->params.perf_prof) return;
-    const char *dir = "../tour";
-    mkdir(dir, 0777);
-
-    char path[1024];
-    sprintf(path, "%s/%s.tour", dir, inst->name);
-    FILE* tour = fopen(path, "w"); 
-    if (tour == NULL) {
-        printf("Unable to save the tour file\n");
-        return;
-    }
-    
-    fprintf(tour, "NAME : %s.tour\n", inst->name);
-    fprintf(tour, "TYPE : TOUR\n");
-    fprintf(tour, "DIMENSION : %d\n", inst->num_nodes);
-    fprintf(tour, "OBJECTIVE : %f\n", inst->solution.obj_best);
-    fprintf(tour, "TIME : %f\n", inst->solution.time_to_solve);
-    fprintf(tour, "TOUR_SECTION\n");
-
-    edge e = inst->solution.edges[0]; // Starting node
-    
-    for (int i = 0; i < inst->num_nodes; i++) { // The tour is composed by the number of nodes
-        fprintf(tour, "%d\n", e.i + 1);
-        e = inst->solution.edges[e.j];
-    }
-    
-    fprintf(tour, "-1\n");
-    fprintf(tour, "EOF");
-
-    fflush(tour);
-    fclose(tour);
-}
-
 int count_components(instance *inst, double* xstar, int* successors, int* comp) {
     return count_components_adv(inst, xstar, successors, comp, NULL, NULL);
 }
@@ -626,7 +869,8 @@ int count_components_adv(instance *inst, double* xstar, int* successors, int* co
 			visit_comp = 1; // We set the flag visited to true until we find the successor
 			for ( int j = 0; j < inst->num_nodes; j++ ) {
                 if (current_node == j || comp[j] >= 0) continue;
-				if (fabs(xstar[x_udir_pos(current_node,j,inst->num_nodes)]) >= EPS ) {
+				int col = x_udir_col(inst, current_node, j);
+				if (col >= 0 && fabs(xstar[col]) >= EPS ) {
 					successors[current_node] = j;
 					current_node = j;
 					visit_comp = 0;
@@ -729,7 +973,8 @@ int prepare_SEC(instance *inst, int tour, int *comp, char *sense, int *indexes,
 
         for (int j = i+1; j < inst->num_nodes; j++) {
             if (comp[j] != tour) continue;
-            indexes[nnz] = x_udir_pos(i, j, inst->num_nodes);
+            indexes[nnz] = x_udir_col(inst, i, j);
+            if (indexes[nnz] < 0) continue; // The edge is not in the sparse model
             values[nnz] = 1.0;
             nnz++;
         }
@@ -756,26 +1001,20 @@ double get_elapsed_time(struct timeval start, struct timeval end) {
     return elapsed;
 }
 
-void reverse_path(instance *inst, int start_node, int end_node, int *prev) {
-    int currnode = start_node;
-    while (1) {
-        int node = prev[currnode];
-        inst->solution.edges[currnode].j = node;
-        currnode = node;
-        if (node == end_node) {
-            break;
-        }
-    }
-
-    for (int k = 0; k < inst->num_nodes; k++) {
-        prev[inst->solution.edges[k].j] = k;
-    }
-}
-
 void copy_instance(instance *dst, instance *src) {
     memcpy(dst, src, sizeof(instance));
     dst->name = NULL;
     dst->params.file_path = NULL;
+    dst->params.batch_path = NULL;
+    dst->params.batch_output = NULL;
+    dst->params.warmstart_path = NULL;
+    dst->params.gen_output = NULL;
+    dst->params.export_path = NULL;
+    dst->export_job = NULL;
+    dst->params.stream_path = NULL;
+    dst->stream = NULL;
+    dst->params.perf_csv = NULL;
+    dst->params.result_cache = NULL;
     dst->comment = NULL;
     dst->params.method.name = NULL;
     if (src->nodes) {
@@ -791,6 +1030,29 @@ void copy_instance(instance *dst, instance *src) {
         memcpy(dst->solution.edges, src->solution.edges, sizeof(edge) * src->num_nodes);
     }
     dst->thread_seeds = NULL;
+    dst->is_copy = true; // The precomputed data (distances, coordinates, k-d tree, graphs and candidate lists) is read only so it is shared with the copy
+    select_dist_func(dst); // The distance rows cache is not thread safe, so the copies don't use it
+}
+
+// Returns a copy of the string allocated with MALLOC, or NULL for NULL
+static char *copy_param_string(const char *str) {
+    if (str == NULL) { return NULL; }
+    char *copy = MALLOC(strlen(str) + 1, char);
+    strcpy(copy, str);
+    return copy;
+}
+
+void copy_params(instance_params *dst, const instance_params *src) {
+    memcpy(dst, src, sizeof(instance_params));
+    dst->file_path = copy_param_string(src->file_path);
+    dst->batch_path = copy_param_string(src->batch_path);
+    dst->batch_output = copy_param_string(src->batch_output);
+    dst->warmstart_path = copy_param_string(src->warmstart_path);
+    dst->gen_output = copy_param_string(src->gen_output);
+    dst->export_path = copy_param_string(src->export_path);
+    dst->stream_path = copy_param_string(src->stream_path);
+    dst->perf_csv = copy_param_string(src->perf_csv);
+    dst->result_cache = copy_param_string(src->result_cache);
 }
 
 /**
@@ -802,4 +1064,32 @@ void copy_instance(instance *dst, instance *src) {
  */
 int rand_choice(int from, int to) {
     return from + ((int) (URAND() * (to - from)));
+}
+
+#ifdef __GLIBC__
+// random_r with a state of 128 bytes is the generator used by random
+static __thread struct random_data rng_data;
+static __thread char rng_state[128];
+static __thread int rng_seeded = 0;
+#endif
+
+void seed_random(unsigned int seed) {
+#ifdef __GLIBC__
+    memset(&rng_data, 0, sizeof(rng_data));
+    initstate_r(seed, rng_state, sizeof(rng_state), &rng_data);
+    rng_seeded = 1;
+#else
+    srandom(seed); // A single generator shared by the threads
+#endif
+}
+
+long next_random(void) {
+#ifdef __GLIBC__
+    if (!rng_seeded) { seed_random(1); }
+    int32_t value;
+    random_r(&rng_data, &value);
+    return value;
+#else
+    return random();
+#endif
 }
\ No newline at end of file
@@ -2,24 +2,22 @@
 
 #include "heuristics.h"
 #include "distutil.h"
+#include "incumbent.h"
+#include "localsearch.h"
 
 #include <float.h>
 
 
 
-//Function that change randomly some edges in the current solution
-int kick(instance *inst){
+//Function that change randomly some edges in the current solution. The 6 endpoints of the changed edges are stored in kicked
+int kick(instance *inst, int *kicked){
     int status = 0;
 
     //From list of successor to Tour
-    int* tour = CALLOC(inst->num_nodes, int);
-    int node=0;
-    int idx=0;
-    while(idx<inst->num_nodes){
-        tour[idx]=node;
-        idx+=1;
-        node=inst->solution.edges[node].j;
-    }
+    array_tour t;
+    tour_init(&t, inst->num_nodes);
+    tour_from_edges(&t, inst->solution.edges);
+    int *tour = t.order; // Not reversed yet: the positions are the visiting order from node 0
 
     //Remove 3 random edges and reconnect them
     int idx1=rand_choice(0,inst->num_nodes);
@@ -55,47 +53,33 @@ int kick(instance *inst){
     int c=tour[idx2];
     int d=tour[idx2+1];
     int e=tour[idx3];
-    int f=tour[idx3+1];
-    inst->solution.edges[a].j =d;   //new successor of a is d
-    inst->solution.edges[e].j =b;   //new successor of e is b
-    inst->solution.edges[c].j =f;   //new successor of c is f
-
-    //From list of successor to Tour (AGAIN TO COMPUTE THE COST)
-    node=0;
-    idx=0;
-    while(idx<inst->num_nodes){
-        tour[idx]=node;
-        idx+=1;
-        node=inst->solution.edges[node].j;
-    }
+    int f=tour[(idx3+1) % inst->num_nodes];    // idx3 may be the last position: its edge closes the tour
+
+    //The tour a->b..c->d..e->f becomes a->d..e->b..c->f: the two segments are swapped by three reversals
+    tour_reverse(&t, b, c);
+    tour_reverse(&t, d, e);
+    tour_reverse(&t, c, d);
+
+    kicked[0] = a; kicked[1] = b; kicked[2] = c;
+    kicked[3] = d; kicked[4] = e; kicked[5] = f;
 
     //Remove 4 random eges and reconnect them
     //TODO...
 
-    
-
-    //Compute new tour cost
-    int prev_node = tour[0];
-    double tour_costs = 0;
-    for (int i = 1; i < inst->num_nodes; i++) {
-        int node = tour[i];
-        tour_costs += calc_dist(prev_node, node, inst);
-        prev_node = node;
+    //The cost changes only on the three replaced edges
+    int_dist_func int_dist = get_int_dist_func(inst);
+    if (int_dist) {
+        inst->solution.obj_best += (double) ((long) int_dist(a, d, inst) + int_dist(e, b, inst) + int_dist(c, f, inst)
+                                             - int_dist(a, b, inst) - int_dist(c, d, inst) - int_dist(e, f, inst));
+    } else {
+        dist_func dist = get_dist_func(inst);
+        inst->solution.obj_best += dist(a, d, inst) + dist(e, b, inst) + dist(c, f, inst) - dist(a, b, inst) - dist(c, d, inst) - dist(e, f, inst);
     }
-    tour_costs += calc_dist(prev_node, tour[0], inst);
-    inst->solution.obj_best=tour_costs;
 
     //From tour to list of successor
-    for (int i = 0; i < inst->num_nodes - 1; i++) {
-        int index = tour[i];
-        inst->solution.edges[index].i = tour[i];
-        inst->solution.edges[index].j = tour[i + 1];
-    }
-    int index = tour[inst->num_nodes - 1];
-    inst->solution.edges[index].i = tour[inst->num_nodes - 1];
-    inst->solution.edges[index].j = tour[0];
+    tour_to_edges(&t, inst->solution.edges);
 
-    FREE(tour);
+    tour_free(&t);
     return status;
 }
 
@@ -113,7 +97,9 @@ int HEU_VNS(instance *inst){
 
     //Compute initial solution
     //status=greedy(inst, 0);
-    status=HEU_2opt_greedy_iter(inst);
+    //The multistart greedy runs a greedy from every node: on large instances it takes all the time. The local searches
+    //on the candidate lists refine a single greedy tour instead
+    status = inst->params.refine == REFINE_2OPT ? HEU_2opt_greedy_iter(inst) : HEU_2opt_greedy(inst);
     
     double best_obj=inst->solution.obj_best;  //best solution cost
     edge *best_sol = CALLOC(inst->num_nodes, edge);
@@ -135,12 +121,13 @@ int HEU_VNS(instance *inst){
 
         //The current solution is the best seen so far
         //Modify current solution to a random point in the neighboorhood
-        kick(inst);
+        int kicked[6];
+        kick(inst, kicked);
         //plot_solution(inst);
 
-        //Optimize with 2OPT
+        //Optimize with 2OPT. The local searches on the candidate lists start only from the kicked nodes
         //inst.params.time_limit = 5;
-        status=alg_2opt(inst);
+        status=refine_solution(inst, kicked, 6);
         if (inst->params.verbose >= 4) {LOG_I("Current: %0.0f", inst->solution.obj_best);}
 
 
@@ -148,6 +135,7 @@ int HEU_VNS(instance *inst){
         if (inst->solution.obj_best < best_obj) {
             best_obj = inst->solution.obj_best;
             memcpy(best_sol, inst->solution.edges, inst->num_nodes * sizeof(edge));
+            stream_incumbent(inst, best_obj, STREAM_NO_BOUND, best_sol);
             
             if (inst->params.verbose >= 3) {LOG_I("Updated incumbent: %0.0f", best_obj);}
             plot_solution(inst);
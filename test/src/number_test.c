@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "utility.h"
+#include "tsplib.h"
+
+#define NUM_RANDOM 200000 // Random numbers compared with strtod
+
+// Numbers whose conversion is easy to get wrong: signs, long mantissas, exponents, rounding ties and limits
+static const char *numbers[] = {
+    "0", "-0", "+0", "0.0", "-0.0", "00012", "7", "-7", "+7", ".5", "5.", "-.5", "+.5",
+    "6734 ", "1453\n", "2233\t", "3.14159", "-2.5e3", "2.5E-3", "1e0", "1e+2", "1e-2", "1E22", "1e23", "1e-22", "1e-23",
+    "1e", "1e+", "1e-", "1ex", "2.5e", "-3E+", // The exponent without digits is not part of the number
+    "123456789012345678", "1234567890123456789", "12345678901234567890", "123456789012345678901234567890",
+    "9007199254740992", "9007199254740993", "9007199254740993.0000000001", "18446744073709551615", "18446744073709551616",
+    "0.1", "0.2", "0.3", "0.30000000000000004", "0.1000000000000000055511151231257827021181583404541015625",
+    "3.141592653589793238462643383279502884197169399375105820974944592307816406286",
+    "0.000000000000000000000000000000000000000000001", "100000000000000000000000000000000000000000000",
+    "2.2250738585072011e-308", "2.2250738585072014e-308", "4.9406564584124654e-324", "2.4703282292062327e-324",
+    "1.7976931348623157e308", "1.7976931348623159e308", "1e400", "-1e400", "1e-400", "1e99999999", "1e-99999999",
+    "123.456e-7", "-98765.4321E+12", "5e-1", "0.0000000001e10", "00000000000000000000000000000001",
+};
+
+// Not numbers: tsplib_read_number returns 0
+static const char *not_numbers[] = {"", " ", "\n", "-", "+", ".", "-.", "+.e1", "e5", "E", "abc", "EOF", "NODE_COORD_SECTION", ":"};
+
+// Reads the text, which is not terminated by a null character, and compares the number and its length with strtod
+static int check_number(const char *text, size_t len) {
+    char *buffer = MALLOC(len > 0 ? len : 1, char); // Exactly len bytes, so a read past the end is caught by the sanitizers
+    memcpy(buffer, text, len);
+    tsplib_reader reader = {buffer, buffer, buffer + len};
+    double value;
+    int read = tsplib_read_number(&reader, &value);
+    FREE(buffer);
+
+    char *copy = CALLOC(len + 1, char);
+    memcpy(copy, text, len);
+    char *stop;
+    double expected = strtod(copy, &stop);
+    int parsed = stop != copy;
+    int errors = 0;
+    if (read != parsed) {
+        printf("\"%s\": read %d, strtod %d\n", copy, read, parsed);
+        errors++;
+    } else if (read && (memcmp(&value, &expected, sizeof(double)) != 0 || reader.cur - reader.begin != stop - copy)) {
+        printf("\"%s\": %a and %ld characters, strtod %a and %ld characters\n", copy, value, (long) (reader.cur - reader.begin),
+               expected, (long) (stop - copy));
+        errors++;
+    }
+    FREE(copy);
+    return errors;
+}
+
+// Writes a random number with up to 25 digits, maybe a point, a sign and an exponent
+static size_t random_number(char *text) {
+    size_t len = 0;
+    if (rand() % 4 == 0) { text[len++] = rand() % 2 ? '-' : '+'; }
+    int num_digits = 1 + rand() % 25;
+    int point = rand() % 3 == 0 ? -1 : rand() % (num_digits + 1);
+    for (int d = 0; d < num_digits; d++) {
+        if (d == point) { text[len++] = '.'; }
+        text[len++] = '0' + rand() % 10;
+    }
+    if (point == num_digits) { text[len++] = '.'; }
+    if (rand() % 3 == 0) {
+        text[len++] = rand() % 2 ? 'e' : 'E';
+        if (rand() % 2) { text[len++] = rand() % 2 ? '-' : '+'; }
+        len += sprintf(text + len, "%d", rand() % 330);
+    }
+    return len;
+}
+
+int main(void) {
+    int errors = 0;
+    for (size_t k = 0; k < sizeof(numbers) / sizeof(numbers[0]); k++) {
+        errors += check_number(numbers[k], strlen(numbers[k]));
+        // The same number after blanks and with a leading minus sign
+        char text[256];
+        snprintf(text, sizeof(text), " \n\t%s", numbers[k]);
+        errors += check_number(text, strlen(text));
+        if (numbers[k][0] != '-' && numbers[k][0] != '+') {
+            snprintf(text, sizeof(text), "-%s", numbers[k]);
+            errors += check_number(text, strlen(text));
+        }
+    }
+    for (size_t k = 0; k < sizeof(not_numbers) / sizeof(not_numbers[0]); k++) {
+        errors += check_number(not_numbers[k], strlen(not_numbers[k]));
+    }
+
+    // The numbers of a line are read one after the other, the last one ending the buffer without a newline
+    const char *line = "12 -3.5e2\t7.25 1e-3";
+    const double values[] = {12, -350, 7.25, 1e-3};
+    tsplib_reader reader = {line, line, line + strlen(line)};
+    for (int k = 0; k < 4; k++) {
+        double value;
+        if (!tsplib_read_number(&reader, &value) || value != values[k]) {
+            printf("Wrong number %d of the line \"%s\"\n", k + 1, line);
+            errors++;
+        }
+    }
+    double value;
+    if (tsplib_read_number(&reader, &value) || reader.cur != reader.end) {
+        printf("A number is read after the end of the line \"%s\"\n", line);
+        errors++;
+    }
+
+    srand(1);
+    for (int k = 0; k < NUM_RANDOM && errors < 10; k++) {
+        char text[64];
+        size_t len = random_number(text);
+        errors += check_number(text, len);
+    }
+    printf("%d errors\n", errors);
+    return errors > 0;
+}
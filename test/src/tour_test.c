@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <math.h>
+#include "utility.h"
+#include "distutil.h"
+#include "tour.h"
+#include "localsearch.h"
+
+#define NUM_MOVES 2000 // Random reversals compared with the plain order
+#define NUM_STARTS 5   // Random tours descended by each local search
+
+// Reverses the path from node a to node b of the plain visiting order
+static void reverse_order(int *order, int n, int a, int b) {
+    int pa = 0, pb = 0;
+    for (int k = 0; k < n; k++) {
+        if (order[k] == a) { pa = k; }
+        if (order[k] == b) { pb = k; }
+    }
+    for (int len = (pb - pa + n) % n + 1; len > 1; len -= 2) {
+        int tmp = order[pa];
+        order[pa] = order[pb];
+        order[pb] = tmp;
+        pa = (pa + 1) % n;
+        pb = (pb - 1 + n) % n;
+    }
+}
+
+// Checks that the array tour visits the nodes in the plain order
+static int same_tour(const array_tour *t, const int *order, int n) {
+    for (int k = 0; k < n; k++) {
+        if (t->order[t->pos[order[k]]] != order[k]) { return 0; }
+        if (tour_next(t, order[k]) != order[(k + 1) % n]) { return 0; }
+        if (tour_prev(t, order[(k + 1) % n]) != order[k]) { return 0; }
+    }
+    return 1;
+}
+
+// Reverses random paths of the array tour and of a plain order, and checks that they stay the same tour
+static int check_reverse(int n) {
+    int *order = MALLOC(n, int);
+    int *pos = MALLOC(n, int);
+    for (int k = 0; k < n; k++) { order[k] = k; }
+    array_tour t;
+    tour_init(&t, n);
+    tour_from_order(&t, order);
+
+    int errors = 0, flips = 0;
+    for (int m = 0; m < NUM_MOVES && !errors; m++) {
+        int a = rand() % n, b = rand() % n;
+        bool reversed = t.reversed;
+        tour_reverse(&t, a, b);
+        reverse_order(order, n, a, b);
+        if (t.reversed != reversed) { flips++; }
+        if (!same_tour(&t, order, n)) {
+            printf("Wrong tour after the reversal of the path from %d to %d\n", a, b);
+            errors++;
+        }
+        for (int k = 0; k < n; k++) { pos[order[k]] = k; }
+        int c = rand() % n;
+        bool between = (pos[b] - pos[a] + n) % n <= (pos[c] - pos[a] + n) % n;
+        if (tour_between(&t, a, b, c) != between) {
+            printf("Wrong tour_between(%d, %d, %d)\n", a, b, c);
+            errors++;
+        }
+    }
+    if (flips == 0) {
+        printf("No reversal changed the orientation of the tour\n");
+        errors++;
+    }
+    tour_free(&t);
+    FREE(order);
+    FREE(pos);
+    return errors;
+}
+
+// Descends from random tours with a local search and checks the tour and its incremental cost
+static int check_descent(instance *inst, const char *name,
+                         int (*search)(instance *, array_tour *, double *, const int *, int, int)) {
+    int n = inst->num_nodes;
+    int *order = MALLOC(n, int);
+    edge *edges = MALLOC(n, edge);
+    int *seen = CALLOC(n, int);
+    array_tour t;
+    tour_init(&t, n);
+
+    int errors = 0;
+    for (int s = 0; s < NUM_STARTS && !errors; s++) {
+        for (int k = 0; k < n; k++) { order[k] = k; }
+        for (int k = n - 1; k > 0; k--) {
+            int r = rand() % (k + 1);
+            int tmp = order[k];
+            order[k] = order[r];
+            order[r] = tmp;
+        }
+        tour_from_order(&t, order);
+        if (s % 2 == 1) { tour_reverse(&t, 0, tour_prev(&t, 0)); } // Start from the other orientation
+        tour_to_edges(&t, edges);
+        double obj = calc_tour_cost(inst, edges);
+        double start = obj;
+
+        search(inst, &t, &obj, NULL, 0, 0);
+
+        tour_to_order(&t, order);
+        for (int k = 0; k < n; k++) { seen[k] = 0; }
+        for (int k = 0; k < n; k++) { seen[order[k]]++; }
+        for (int k = 0; k < n; k++) {
+            if (seen[k] != 1) {
+                printf("%s: node %d is visited %d times\n", name, k, seen[k]);
+                errors++;
+                break;
+            }
+        }
+        tour_to_edges(&t, edges);
+        double cost = calc_tour_cost(inst, edges);
+        if (fabs(cost - obj) > 1e-6 * fmax(1.0, cost)) {
+            printf("%s: the tour costs %f, the incremental cost is %f\n", name, cost, obj);
+            errors++;
+        }
+        if (obj > start) {
+            printf("%s: the descent went from %f to %f\n", name, start, obj);
+            errors++;
+        }
+        printf("%s: %0.0f -> %0.0f\n", name, start, cost);
+    }
+    tour_free(&t);
+    FREE(order);
+    FREE(edges);
+    FREE(seen);
+    return errors;
+}
+
+int main(int argc, const char *argv[]) {
+    instance inst;
+    parse_comand_line(argc, argv, &inst);
+    load_instance(&inst);
+    if (inst.cand.list == NULL) { LOG_E("The local searches need the candidate lists"); }
+    srand(inst.params.seed);
+
+    int errors = check_reverse(inst.num_nodes);
+    errors += check_descent(&inst, "2OPT_CAND", alg_2opt_cand);
+    errors += check_descent(&inst, "OROPT", alg_oropt_cand);
+    errors += check_descent(&inst, "2OPT_OROPT", alg_2opt_oropt);
+    errors += check_descent(&inst, "3OPT", alg_3opt_cand);
+    errors += check_descent(&inst, "LK", alg_lk);
+
+    free_instance(&inst);
+    return errors > 0;
+}